@@ -25,6 +25,7 @@
 
 #include <pstreams/pstream.h>
 
+#include "utils/StreamingActivity.hpp"
 #include "AvTypes.hpp"
 
 namespace Av {
@@ -70,6 +71,7 @@ class Transcoder
 		std::size_t		_total {};
 		const std::size_t	_id {};
 		std::string		_outputMimeType;
+		StreamingActivity::ScopedStream	_streamingActivity;
 };
 
 } // namespace Av
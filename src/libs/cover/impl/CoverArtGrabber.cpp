@@ -19,12 +19,17 @@
 
 #include "CoverArtGrabber.hpp"
 
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+
 #include "av/AvInfo.hpp"
 
 #include "database/Release.hpp"
 #include "database/Session.hpp"
 #include "database/Track.hpp"
 
+#include "utils/DirectoryWalker.hpp"
 #include "utils/Logger.hpp"
 #include "utils/Random.hpp"
 
@@ -36,6 +41,35 @@ isFileSupported(const std::filesystem::path& file, const std::vector<std::filesy
 	return (std::find(std::cbegin(extensions), std::cend(extensions), file.extension()) != std::cend(extensions));
 }
 
+std::optional<std::vector<unsigned char>>
+readFileRange(const std::filesystem::path& p, std::uint64_t offset, std::size_t size)
+{
+	const int fd {::open(p.c_str(), O_RDONLY | O_CLOEXEC)};
+	if (fd < 0)
+		return std::nullopt;
+
+	std::vector<unsigned char> data(size);
+
+	std::size_t readSize {};
+	while (readSize < size)
+	{
+		const ssize_t res {::pread(fd, data.data() + readSize, size - readSize, static_cast<off_t>(offset + readSize))};
+		if (res < 0 && errno == EINTR)
+			continue;
+		if (res <= 0)
+			break;
+
+		readSize += static_cast<std::size_t>(res);
+	}
+
+	::close(fd);
+
+	if (readSize != size)
+		return std::nullopt;
+
+	return data;
+}
+
 } // namespace
 
 namespace CoverArt {
@@ -129,24 +163,29 @@ std::multimap<std::string, std::filesystem::path>
 Grabber::getCoverPaths(const std::filesystem::path& directoryPath) const
 {
 	std::multimap<std::string, std::filesystem::path> res;
-	std::error_code ec;
 
-	std::filesystem::directory_iterator itPath(directoryPath, ec);
-	std::filesystem::directory_iterator itEnd;
-	while (!ec && itPath != itEnd)
+	const DirectoryWalker::DirectoryEntries entries {DirectoryWalker::listDirectory(directoryPath)};
+	for (const DirectoryWalker::Error& error : entries.errors)
+		LMS_LOG(COVER, ERROR) << "Cannot process entry '" << error.path.string() << "': " << error.ec.message();
+
+	for (const std::string& fileName : entries.fileNames)
 	{
-		const std::filesystem::path path {*itPath};
-		itPath.increment(ec);
+		const std::filesystem::path path {directoryPath / fileName};
 
-		if (!std::filesystem::is_regular_file(path))
+		if (!isFileSupported(path, _fileExtensions))
 			continue;
 
-		if (!isFileSupported(path, _fileExtensions))
+		std::error_code ec;
+		const std::uintmax_t fileSize {std::filesystem::file_size(path, ec)};
+		if (ec)
+		{
+			LMS_LOG(COVER, ERROR) << "Cannot get size of cover file '" << path.string() << "': " << ec.message();
 			continue;
+		}
 
-		if (std::filesystem::file_size(path) > _maxFileSize)
+		if (fileSize > _maxFileSize)
 		{
-			LMS_LOG(COVER, INFO) << "Cover file '" << path.string() << " is too big (" << std::filesystem::file_size(path) << "), limit is " << _maxFileSize;
+			LMS_LOG(COVER, INFO) << "Cover file '" << path.string() << " is too big (" << fileSize << "), limit is " << _maxFileSize;
 			continue;
 		}
 
@@ -156,6 +195,30 @@ Grabber::getCoverPaths(const std::filesystem::path& directoryPath) const
 	return res;
 }
 
+std::optional<Image>
+Grabber::getFromEmbeddedCover(const std::filesystem::path& p, const Database::Track::EmbeddedCover& embeddedCover) const
+{
+	if (embeddedCover.size == 0 || embeddedCover.size > _maxFileSize)
+		return std::nullopt;
+
+	const std::optional<std::vector<unsigned char>> data {readFileRange(p, embeddedCover.offset, embeddedCover.size)};
+	if (!data)
+	{
+		LMS_LOG(COVER, ERROR) << "Cannot read embedded cover in '" << p.string() << "'";
+		return std::nullopt;
+	}
+
+	Image image;
+	if (!image.load(*data))
+	{
+		// The file may have changed since the last scan
+		LMS_LOG(COVER, DEBUG) << "Cannot load embedded cover in '" << p.string() << "' using its recorded location";
+		return std::nullopt;
+	}
+
+	return image;
+}
+
 std::optional<Image>
 Grabber::getFromTrack(const std::filesystem::path& p) const
 {
@@ -184,6 +247,7 @@ Grabber::getFromTrack(Database::Session& dbSession, Database::IdType trackId, st
 		return *cover;
 
 	bool hasCover {};
+	std::optional<Track::EmbeddedCover> embeddedCover;
 	bool isMultiDisc {};
 	std::filesystem::path trackPath;
 
@@ -194,6 +258,7 @@ Grabber::getFromTrack(Database::Session& dbSession, Database::IdType trackId, st
 		if (track)
 		{
 			hasCover = track->hasCover();
+			embeddedCover = track->getEmbeddedCover();
 			trackPath = track->getPath();
 
 			auto release {track->getRelease()};
@@ -202,7 +267,10 @@ Grabber::getFromTrack(Database::Session& dbSession, Database::IdType trackId, st
 		}
 	}
 
-	if (hasCover)
+	if (hasCover && embeddedCover)
+		cover = getFromEmbeddedCover(trackPath, *embeddedCover);
+
+	if (hasCover && !cover)
 		cover = getFromTrack(trackPath);
 
 	if (!cover)
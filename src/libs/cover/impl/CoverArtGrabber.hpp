@@ -28,6 +28,7 @@
 #include <vector>
 
 #include "cover/ICoverArtGrabber.hpp"
+#include "database/Track.hpp"
 #include "database/Types.hpp"
 #include "Image.hpp"
 
@@ -102,6 +103,7 @@ namespace CoverArt
 			Image					getFromTrack(Database::Session& dbSession, Database::IdType trackId, std::size_t size);
 			Image					getFromRelease(Database::Session& dbSession, Database::IdType releaseId, std::size_t size);
 
+			std::optional<Image>			getFromEmbeddedCover(const std::filesystem::path& path, const Database::Track::EmbeddedCover& embeddedCover) const;
 			std::optional<Image>			getFromTrack(const std::filesystem::path& path) const;
 			std::multimap<std::string, std::filesystem::path>	getCoverPaths(const std::filesystem::path& directoryPath) const;
 			std::optional<Image>			getFromDirectory(const std::filesystem::path& path, std::string_view preferredFileName) const;
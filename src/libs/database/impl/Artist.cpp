@@ -26,6 +26,7 @@
 #include "database/Track.hpp"
 #include "database/User.hpp"
 #include "utils/Logger.hpp"
+#include "FullTextSearch.hpp"
 #include "SqlQuery.hpp"
 
 
@@ -92,7 +93,12 @@ createQuery(Session& session,
 	if (linkType)
 		query.where("t_a_l.type = ?").bind(*linkType);
 
-	if (!keywords.empty())
+	if (const std::optional<std::string> fullTextSearchMatch {getFullTextSearchMatch(session, keywords)})
+	{
+		query.join("artist_fts ON artist_fts.rowid = a.id");
+		query.where("artist_fts MATCH ?").bind(*fullTextSearchMatch);
+	}
+	else if (!keywords.empty())
 	{
 		std::vector<std::string> clauses;
 		std::vector<std::string> sortClauses;
@@ -160,6 +166,7 @@ Artist::getAll(Session& session, SortMethod sortMethod)
 			query.orderBy("name COLLATE NOCASE");
 			break;
 		case Artist::SortMethod::BySortName:
+		case Artist::SortMethod::ByRelevance:	// no keyword
 			query.orderBy("sort_name COLLATE NOCASE");
 			break;
 	}
@@ -184,6 +191,7 @@ Artist::getAll(Session& session, SortMethod sortMethod, std::optional<Range> ran
 			query.orderBy("a.name COLLATE NOCASE");
 			break;
 		case Artist::SortMethod::BySortName:
+		case Artist::SortMethod::ByRelevance:	// no keyword
 			query.orderBy("a.sort_name COLLATE NOCASE");
 			break;
 	}
@@ -232,11 +240,26 @@ std::vector<Artist::pointer>
 Artist::getAllOrphans(Session& session)
 {
 	session.checkSharedLocked();
-	Wt::Dbo::collection<Wt::Dbo::ptr<Artist>> res {session.getDboSession().query<Wt::Dbo::ptr<Artist>>("SELECT DISTINCT a FROM artist a WHERE NOT EXISTS(SELECT 1 FROM track t INNER JOIN track_artist_link t_a_l ON t_a_l.artist_id = a.id WHERE t.id = t_a_l.track_id)")};
+	Wt::Dbo::collection<Wt::Dbo::ptr<Artist>> res {session.getDboSession().query<Wt::Dbo::ptr<Artist>>("SELECT a FROM artist a WHERE NOT EXISTS(SELECT 1 FROM track_artist_link t_a_l WHERE t_a_l.artist_id = a.id)")};
 
 	return std::vector<pointer>(res.begin(), res.end());
 }
 
+std::size_t
+Artist::removeAllOrphans(Session& session)
+{
+	session.checkUniqueLocked();
+
+	// Links are removed along with their track
+	const std::string orphanClause {"NOT EXISTS (SELECT 1 FROM track_artist_link t_a_l WHERE t_a_l.artist_id = artist.id)"};
+
+	const int count {session.getDboSession().query<int>("SELECT COUNT(*) FROM artist WHERE " + orphanClause)};
+	if (count > 0)
+		session.getDboSession().execute("DELETE FROM artist WHERE " + orphanClause);
+
+	return count;
+}
+
 std::vector<IdType>
 Artist::getAllIdsWithClusters(Session& session, std::optional<std::size_t> limit)
 {
@@ -273,21 +296,44 @@ Artist::getByFilter(Session& session,
 	session.checkSharedLocked();
 
 	auto query {createQuery<Artist::pointer>(session, "SELECT DISTINCT a from artist a", clusters, keywords, linkType)};
+
+	// Only sorts on a unique key can be resumed from a given artist
+	std::optional<std::string> keysetField;
 	switch (sortMethod)
 	{
 		case Artist::SortMethod::None:
 			break;
 		case Artist::SortMethod::ByName:
-			query.orderBy("a.name COLLATE NOCASE");
+			keysetField = "name";
 			break;
 		case Artist::SortMethod::BySortName:
-			query.orderBy("a.sort_name COLLATE NOCASE");
+			keysetField = "sort_name";
+			break;
+		case Artist::SortMethod::ByRelevance:
+			if (getFullTextSearchMatch(session, keywords))
+				query.orderBy("artist_fts.rank, a.sort_name COLLATE NOCASE");
+			else
+				keysetField = "sort_name";
 			break;
 	}
 
+	bool useKeyset {};
+	if (keysetField)
+	{
+		query.orderBy("a." + *keysetField + " COLLATE NOCASE, a.id");
+
+		useKeyset = range && range->after && getById(session, *range->after);
+		if (useKeyset)
+		{
+			// The first condition is redundant but lets the index be searched
+			query.where("a." + *keysetField + " COLLATE NOCASE >= (SELECT " + *keysetField + " FROM artist WHERE id = ?)").bind(*range->after);
+			query.where("(a." + *keysetField + " COLLATE NOCASE, a.id) > (SELECT " + *keysetField + ", id FROM artist WHERE id = ?)").bind(*range->after);
+		}
+	}
+
 	Wt::Dbo::collection<Artist::pointer> collection = query
 		.limit(range ? static_cast<int>(range->limit) + 1 : -1)
-		.offset(range ? static_cast<int>(range->offset) : -1);
+		.offset(range && !useKeyset ? static_cast<int>(range->offset) : -1);
 
 	auto res {std::vector<pointer>(collection.begin(), collection.end())};
 
@@ -364,6 +410,7 @@ Artist::getStarred(Session& session,
 			query.orderBy("name COLLATE NOCASE");
 			break;
 		case Artist::SortMethod::BySortName:
+		case Artist::SortMethod::ByRelevance:	// no keyword
 			query.orderBy("sort_name COLLATE NOCASE");
 			break;
 	}
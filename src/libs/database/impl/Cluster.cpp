@@ -68,6 +68,20 @@ Cluster::getAllOrphans(Session& session)
 	return std::vector<Cluster::pointer>(res.begin(), res.end());
 }
 
+std::size_t
+Cluster::removeAllOrphans(Session& session)
+{
+	session.checkUniqueLocked();
+
+	const std::string orphanClause {"NOT EXISTS (SELECT 1 FROM track_cluster t_c WHERE t_c.cluster_id = cluster.id)"};
+
+	const int count {session.getDboSession().query<int>("SELECT COUNT(*) FROM cluster WHERE " + orphanClause)};
+	if (count > 0)
+		session.getDboSession().execute("DELETE FROM cluster WHERE " + orphanClause);
+
+	return count;
+}
+
 Cluster::pointer
 Cluster::getById(Session& session, IdType id)
 {
@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2020 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "Connection.hpp"
+
+#include <chrono>
+
+namespace Database {
+
+Connection::Connection(const std::filesystem::path& dbPath, const Db::Parameters& parameters, StatementCacheCounters& statementCacheCounters)
+: Wt::Dbo::backend::Sqlite3 {dbPath.string()}
+, _parameters {parameters}
+, _statementCacheCounters {statementCacheCounters}
+{
+	configure();
+}
+
+Connection::Connection(const Connection& other)
+: Wt::Dbo::backend::Sqlite3 {other}
+, _parameters {other._parameters}
+, _statementCacheCounters {other._statementCacheCounters}
+{
+	configure();
+}
+
+Connection::~Connection() = default;
+
+std::unique_ptr<Wt::Dbo::SqlConnection>
+Connection::clone() const
+{
+	return std::unique_ptr<Wt::Dbo::SqlConnection> {new Connection {*this}};
+}
+
+Wt::Dbo::SqlStatement*
+Connection::getStatement(const std::string& id)
+{
+	Wt::Dbo::SqlStatement* statement {Wt::Dbo::backend::Sqlite3::getStatement(id)};
+	if (statement)
+		_statementCacheCounters.hits++;
+	else
+		_statementCacheCounters.misses++; // will be prepared and saved by the caller
+
+	return statement;
+}
+
+void
+Connection::configure()
+{
+	// These settings only apply to the current connection
+	executeSql("pragma synchronous=normal");
+	executeSql("pragma busy_timeout=" + std::to_string(std::chrono::milliseconds {_parameters.connectionTimeout}.count()));
+	executeSql("pragma mmap_size=" + std::to_string(_parameters.mmapSize));
+	executeSql("pragma cache_size=-" + std::to_string(_parameters.cacheSize));
+
+	switch (_parameters.tempStore)
+	{
+		case Db::TempStore::Default:	executeSql("pragma temp_store=default"); break;
+		case Db::TempStore::File:	executeSql("pragma temp_store=file"); break;
+		case Db::TempStore::Memory:	executeSql("pragma temp_store=memory"); break;
+	}
+}
+
+} // namespace Database
+
@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2020 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <atomic>
+#include <filesystem>
+#include <memory>
+#include <string>
+
+#include <Wt/Dbo/backend/Sqlite3.h>
+
+#include "database/Db.hpp"
+
+namespace Database {
+
+// Shared by all the connections of a database
+struct StatementCacheCounters
+{
+	std::atomic<std::size_t>	hits {};
+	std::atomic<std::size_t>	misses {};
+};
+
+// SQLite connection set up using the database parameters, clones included
+// Wt::Dbo keeps the prepared statements of each connection, keyed by their SQL text: reuses are counted here
+class Connection final : public Wt::Dbo::backend::Sqlite3
+{
+	public:
+		Connection(const std::filesystem::path& dbPath, const Db::Parameters& parameters, StatementCacheCounters& statementCacheCounters);
+		~Connection();
+
+		Connection(Connection&&) = delete;
+		Connection& operator=(const Connection&) = delete;
+		Connection& operator=(Connection&&) = delete;
+
+		std::unique_ptr<Wt::Dbo::SqlConnection> clone() const override;
+		Wt::Dbo::SqlStatement* getStatement(const std::string& id) override;
+
+	private:
+		Connection(const Connection& other);
+
+		void configure();
+
+		const Db::Parameters	_parameters;
+		StatementCacheCounters&	_statementCacheCounters;
+};
+
+} // namespace Database
+
@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2020 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "ConnectionPool.hpp"
+
+#include <cassert>
+
+#include <Wt/Dbo/Exception.h>
+
+#include "utils/Logger.hpp"
+
+namespace Database {
+
+static thread_local bool useWriterConnection {};
+
+bool
+ConnectionPool::setUseWriterConnection(bool value)
+{
+	const bool previousValue {useWriterConnection};
+	useWriterConnection = value;
+
+	return previousValue;
+}
+
+ConnectionPool::ConnectionPool(std::unique_ptr<Wt::Dbo::SqlConnection> writerConnection, std::vector<std::unique_ptr<Wt::Dbo::SqlConnection>> readerConnections, std::chrono::milliseconds readerTimeout)
+: _readerTimeout {readerTimeout}
+, _writerConnectionPtr {writerConnection.get()}
+, _writerConnection {std::move(writerConnection)}
+, _readerConnections {std::move(readerConnections)}
+{
+	assert(_writerConnection);
+	assert(!_readerConnections.empty());
+}
+
+ConnectionPool::~ConnectionPool() = default;
+
+std::unique_ptr<Wt::Dbo::SqlConnection>
+ConnectionPool::getConnection()
+{
+	std::unique_lock lock {_mutex};
+
+	if (useWriterConnection)
+	{
+		// Writers are serialized here, no timeout as they used to wait for the exclusive lock
+		_writerAvailable.wait(lock, [this] { return _writerConnection != nullptr; });
+		return std::move(_writerConnection);
+	}
+
+	if (!_readerAvailable.wait_for(lock, _readerTimeout, [this] { return !_readerConnections.empty(); }))
+	{
+		LMS_LOG(DB, ERROR) << "Timeout while waiting for a reader connection";
+		throw Wt::Dbo::Exception {"Timeout: couldn't get database connection"};
+	}
+
+	std::unique_ptr<Wt::Dbo::SqlConnection> connection {std::move(_readerConnections.back())};
+	_readerConnections.pop_back();
+
+	return connection;
+}
+
+void
+ConnectionPool::returnConnection(std::unique_ptr<Wt::Dbo::SqlConnection> connection)
+{
+	const bool isWriterConnection {connection.get() == _writerConnectionPtr};
+
+	{
+		std::unique_lock lock {_mutex};
+
+		if (isWriterConnection)
+		{
+			assert(!_writerConnection);
+			_writerConnection = std::move(connection);
+		}
+		else
+			_readerConnections.push_back(std::move(connection));
+	}
+
+	if (isWriterConnection)
+		_writerAvailable.notify_one();
+	else
+		_readerAvailable.notify_one();
+}
+
+void
+ConnectionPool::prepareForDropTables() const
+{
+	std::unique_lock lock {_mutex};
+
+	if (_writerConnection)
+		_writerConnection->prepareForDropTables();
+
+	for (const std::unique_ptr<Wt::Dbo::SqlConnection>& connection : _readerConnections)
+		connection->prepareForDropTables();
+}
+
+} // namespace Database
+
@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2020 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <Wt/Dbo/SqlConnectionPool.h>
+
+namespace Database {
+
+// Connection pool used when the readers run concurrently with the writers
+// Connections are handed out to the calling thread either from the reader pool or as the single writer connection,
+// depending on whether the thread opens a write transaction (see setUseWriterConnection)
+// SQLite in WAL mode gives each reader a snapshot of the database, while the writers are serialized by the writer connection
+class ConnectionPool final : public Wt::Dbo::SqlConnectionPool
+{
+	public:
+		ConnectionPool(std::unique_ptr<Wt::Dbo::SqlConnection> writerConnection, std::vector<std::unique_ptr<Wt::Dbo::SqlConnection>> readerConnections, std::chrono::milliseconds readerTimeout);
+		~ConnectionPool();
+
+		ConnectionPool(const ConnectionPool&) = delete;
+		ConnectionPool(ConnectionPool&&) = delete;
+		ConnectionPool& operator=(const ConnectionPool&) = delete;
+		ConnectionPool& operator=(ConnectionPool&&) = delete;
+
+		// Select the connections given to the calling thread, returns the previous setting
+		static bool setUseWriterConnection(bool useWriterConnection);
+
+	private:
+		std::unique_ptr<Wt::Dbo::SqlConnection> getConnection() override;
+		void returnConnection(std::unique_ptr<Wt::Dbo::SqlConnection> connection) override;
+		void prepareForDropTables() const override;
+
+		const std::chrono::milliseconds				_readerTimeout;
+		const Wt::Dbo::SqlConnection*				_writerConnectionPtr;	// to identify the returned connection
+
+		mutable std::mutex					_mutex;
+		std::condition_variable					_writerAvailable;
+		std::condition_variable					_readerAvailable;
+		std::unique_ptr<Wt::Dbo::SqlConnection>			_writerConnection;	// not set if in use
+		std::vector<std::unique_ptr<Wt::Dbo::SqlConnection>>	_readerConnections;	// free ones
+};
+
+} // namespace Database
+
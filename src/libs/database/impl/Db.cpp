@@ -20,27 +20,50 @@
 #include "database/Db.hpp"
 
 #include <Wt/Dbo/FixedSqlConnectionPool.h>
-#include <Wt/Dbo/backend/Sqlite3.h>
 
 #include "database/User.hpp"
+#include "utils/Exception.hpp"
 #include "utils/Logger.hpp"
+#include "Connection.hpp"
+#include "ConnectionPool.hpp"
 
 namespace Database {
 
-// Session living class handling the database and the login
 Db::Db(const std::filesystem::path& dbPath)
+: Db {dbPath, Parameters {}}
+{
+}
+
+// Session living class handling the database and the login
+Db::Db(const std::filesystem::path& dbPath, const Parameters& parameters)
+: _concurrencyMode {parameters.concurrencyMode}
+, _statementCacheCounters {std::make_unique<StatementCacheCounters>()}
 {
-	LMS_LOG(DB, INFO) << "Creating connection pool on file " << dbPath.string();
+	if (parameters.connectionCount == 0)
+		throw LmsException {"Invalid database connection count"};
 
-	std::unique_ptr<Wt::Dbo::backend::Sqlite3> connection {std::make_unique<Wt::Dbo::backend::Sqlite3>(dbPath.string())};
+	LMS_LOG(DB, INFO) << "Creating connection pool on file " << dbPath.string() << " (" << parameters.connectionCount << " connections" << (hasConcurrentReaders() ? ", concurrent readers" : "") << ")";
+
+	// Each connection, clones included, is set up using the parameters
+	std::unique_ptr<Connection> connection {std::make_unique<Connection>(dbPath, parameters, *_statementCacheCounters)};
 //	connection->setProperty("show-queries", "true");
 	connection->executeSql("pragma journal_mode=WAL");
-	connection->executeSql("pragma synchronous=normal");
 
-	auto connectionPool = std::make_unique<Wt::Dbo::FixedSqlConnectionPool>(std::move(connection), 10);
-	connectionPool->setTimeout(std::chrono::seconds(10));
+	if (!hasConcurrentReaders())
+	{
+		auto connectionPool = std::make_unique<Wt::Dbo::FixedSqlConnectionPool>(std::move(connection), parameters.connectionCount);
+		connectionPool->setTimeout(parameters.connectionTimeout);
+
+		_connectionPool = std::move(connectionPool);
+		return;
+	}
 
-	_connectionPool = std::move(connectionPool);
+	// Each reader connection works on its own snapshot of the database (WAL mode)
+	std::vector<std::unique_ptr<Wt::Dbo::SqlConnection>> readerConnections;
+	for (std::size_t i {}; i < parameters.connectionCount; ++i)
+		readerConnections.push_back(connection->clone());
+
+	_connectionPool = std::make_unique<ConnectionPool>(std::move(connection), std::move(readerConnections), parameters.connectionTimeout);
 }
 
 Db::~Db()
@@ -48,15 +71,35 @@ Db::~Db()
 	LMS_LOG(DB, DEBUG) << "Optimizing db...";
 	executeSql("pragma optimize");
 	LMS_LOG(DB, DEBUG) << "Optimizing db DONE";
+
+	const StatementCacheStats stats {getStatementCacheStats()};
+	LMS_LOG(DB, INFO) << "Prepared statement cache: " << stats.hits << " hits, " << stats.misses << " misses";
+}
+
+Db::StatementCacheStats
+Db::getStatementCacheStats() const
+{
+	return StatementCacheStats {_statementCacheCounters->hits, _statementCacheCounters->misses};
 }
 
 void
 Db::executeSql(const std::string& sql)
 {
+	ScopedWriterConnection writerConnection;
 	ScopedConnection connection {*_connectionPool};
 	connection->executeSql(sql);
 }
 
+Db::ScopedWriterConnection::ScopedWriterConnection()
+: _previousValue {ConnectionPool::setUseWriterConnection(true)}
+{
+}
+
+Db::ScopedWriterConnection::~ScopedWriterConnection()
+{
+	ConnectionPool::setUseWriterConnection(_previousValue);
+}
+
 
 Db::ScopedConnection::ScopedConnection(Wt::Dbo::SqlConnectionPool& pool)
 : _connectionPool {pool}
@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2020 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "database/Directory.hpp"
+
+#include "database/Session.hpp"
+
+namespace Database {
+
+Directory::Directory(const std::filesystem::path& p)
+: _path {p.string()}
+{
+}
+
+Directory::pointer
+Directory::create(Session& session, const std::filesystem::path& p)
+{
+	session.checkUniqueLocked();
+
+	return session.getDboSession().add(std::make_unique<Directory>(p));
+}
+
+Directory::pointer
+Directory::getById(Session& session, IdType id)
+{
+	session.checkSharedLocked();
+
+	return session.getDboSession().find<Directory>()
+		.where("id = ?").bind(id);
+}
+
+Directory::pointer
+Directory::getByPath(Session& session, const std::filesystem::path& p)
+{
+	session.checkSharedLocked();
+
+	return session.getDboSession().find<Directory>()
+		.where("path = ?").bind(p.string());
+}
+
+std::vector<Directory::pointer>
+Directory::getAll(Session& session)
+{
+	session.checkSharedLocked();
+
+	Wt::Dbo::collection<Directory::pointer> res {session.getDboSession().find<Directory>()};
+
+	return std::vector<Directory::pointer>(std::cbegin(res), std::cend(res));
+}
+
+} // namespace Database
+
@@ -0,0 +1,139 @@
+/*
+ * Copyright (C) 2020 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "FullTextSearch.hpp"
+
+#include <algorithm>
+#include <cctype>
+
+#include "database/Session.hpp"
+#include "utils/Logger.hpp"
+#include "utils/String.hpp"
+
+namespace Database {
+
+namespace {
+
+	struct IndexedTable
+	{
+		std::string			name;
+		std::vector<std::string>	columns;
+	};
+
+	const std::vector<IndexedTable> indexedTables
+	{
+		{"artist",	{"name", "sort_name"}},
+		{"release",	{"name"}},
+		{"track",	{"name"}},
+	};
+
+	std::string
+	prefixColumns(const std::string& prefix, const std::vector<std::string>& columns)
+	{
+		std::vector<std::string> prefixedColumns;
+		for (const std::string& column : columns)
+			prefixedColumns.push_back(prefix + column);
+
+		return StringUtils::joinStrings(prefixedColumns, ", ");
+	}
+
+	bool
+	isIndexComplete(Wt::Dbo::Session& session, const IndexedTable& table)
+	{
+		const std::string ftsTable {table.name + "_fts"};
+
+		const int count {session.query<int>("SELECT COUNT(*) FROM sqlite_master WHERE name IN (?, ?, ?, ?)")
+			.bind(ftsTable)
+			.bind(ftsTable + "_insert")
+			.bind(ftsTable + "_delete")
+			.bind(ftsTable + "_update")};
+
+		return count == 4;
+	}
+
+	void
+	createIndex(Wt::Dbo::Session& session, const IndexedTable& table)
+	{
+		const std::string ftsTable {table.name + "_fts"};
+		const std::string columns {StringUtils::joinStrings(table.columns, ", ")};
+		const std::string insertNew {"INSERT INTO " + ftsTable + "(rowid, " + columns + ") VALUES (new.id, " + prefixColumns("new.", table.columns) + ");"};
+		const std::string deleteOld {"INSERT INTO " + ftsTable + "(" + ftsTable + ", rowid, " + columns + ") VALUES ('delete', old.id, " + prefixColumns("old.", table.columns) + ");"};
+
+		// External content table: only the index is stored
+		session.execute("CREATE VIRTUAL TABLE IF NOT EXISTS " + ftsTable + " USING fts5(" + columns + ", content='" + table.name + "', content_rowid='id', tokenize='unicode61 remove_diacritics 2', prefix='2 3')");
+		session.execute("CREATE TRIGGER IF NOT EXISTS " + ftsTable + "_insert AFTER INSERT ON " + table.name + " BEGIN " + insertNew + " END");
+		session.execute("CREATE TRIGGER IF NOT EXISTS " + ftsTable + "_delete AFTER DELETE ON " + table.name + " BEGIN " + deleteOld + " END");
+		session.execute("CREATE TRIGGER IF NOT EXISTS " + ftsTable + "_update AFTER UPDATE OF " + columns + " ON " + table.name + " BEGIN " + deleteOld + " " + insertNew + " END");
+
+		session.execute("INSERT INTO " + ftsTable + "(" + ftsTable + ") VALUES ('rebuild')");
+	}
+
+	bool
+	hasIndexableCharacter(const std::string& keyword)
+	{
+		// non ASCII characters may be letters
+		return std::any_of(std::cbegin(keyword), std::cend(keyword), [](char c) { return static_cast<unsigned char>(c) >= 0x80 || std::isalnum(static_cast<unsigned char>(c)); });
+	}
+}
+
+void
+createFullTextSearchTables(Wt::Dbo::Session& session)
+{
+	for (const IndexedTable& table : indexedTables)
+	{
+		if (isIndexComplete(session, table))
+			continue;
+
+		LMS_LOG(DB, INFO) << "Building full text search index for table '" << table.name << "'...";
+		createIndex(session, table);
+	}
+}
+
+std::optional<std::string>
+getFullTextSearchMatch(Session& session, const std::vector<std::string>& keywords)
+{
+	if (keywords.empty() || !session.hasFullTextSearch())
+		return std::nullopt;
+
+	std::string match;
+	for (const std::string& keyword : keywords)
+	{
+		// LIKE also matches punctuation, that is not indexed
+		if (!hasIndexableCharacter(keyword))
+			return std::nullopt;
+
+		std::string quotedKeyword;
+		for (char c : keyword)
+		{
+			if (c == '"')
+				quotedKeyword += '"';
+			quotedKeyword += c;
+		}
+
+		if (!match.empty())
+			match += " AND ";
+		match += "\"" + quotedKeyword + "\"*";
+	}
+
+	return match;
+}
+
+} // namespace Database
+
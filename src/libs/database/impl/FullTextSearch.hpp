@@ -0,0 +1,45 @@
+/*
+ * Copyright (C) 2020 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <Wt/Dbo/Dbo.h>
+
+namespace Database {
+
+class Session;
+
+// Keyword search on the artist, release and track names, using SQLite FTS5 tables (<table>_fts)
+// The indexes are kept up to date by triggers, so that any write (mostly done by the scanner) updates them
+
+// Creates the missing tables and triggers, and (re)builds the indexes that need it
+// Must be called in a unique transaction, throws if FTS5 is not available
+void createFullTextSearchTables(Wt::Dbo::Session& session);
+
+// FTS5 expression matching all the keywords, as word prefixes, ignoring case and diacritics
+// Not set if full text search is not available or cannot be used for these keywords (LIKE must be used then)
+std::optional<std::string> getFullTextSearchMatch(Session& session, const std::vector<std::string>& keywords);
+
+} // namespace Database
+
@@ -19,6 +19,9 @@
 
 #include "database/Release.hpp"
 
+#include <algorithm>
+#include <set>
+
 #include "utils/Logger.hpp"
 
 #include "database/Artist.hpp"
@@ -26,6 +29,7 @@
 #include "database/Session.hpp"
 #include "database/Track.hpp"
 #include "database/User.hpp"
+#include "FullTextSearch.hpp"
 #include "SqlQuery.hpp"
 
 namespace Database
@@ -43,8 +47,16 @@ createQuery(Session& session,
 	auto query {session.getDboSession().query<T>(queryStr)};
 	query.join("track t ON t.release_id = r.id");
 
-	for (const std::string& keyword : keywords)
-		query.where("r.name LIKE ?").bind("%%" + keyword + "%%");
+	if (const std::optional<std::string> fullTextSearchMatch {getFullTextSearchMatch(session, keywords)})
+	{
+		query.join("release_fts ON release_fts.rowid = r.id");
+		query.where("release_fts MATCH ?").bind(*fullTextSearchMatch);
+	}
+	else
+	{
+		for (const std::string& keyword : keywords)
+			query.where("r.name LIKE ?").bind("%%" + keyword + "%%");
+	}
 
 	if (!clusterIds.empty())
 	{
@@ -70,6 +82,35 @@ createQuery(Session& session,
 	return query;
 }
 
+// Single value shared by all the tracks of the release (default value if various)
+template <typename T>
+static
+T
+getUniqueTrackValue(Wt::Dbo::Session& session, IdType releaseId, const std::string& field)
+{
+	Wt::Dbo::collection<T> res = session.query<T>("SELECT t." + field + " FROM track t")
+		.where("t.release_id = ?").bind(releaseId)
+		.groupBy("t." + field)
+		.limit(2);
+
+	const std::vector<T> values(std::cbegin(res), std::cend(res));
+	if (values.size() != 1)
+		return T {};
+
+	return values.front();
+}
+
+template <typename T>
+static
+T
+getTrackAggregate(Wt::Dbo::Session& session, IdType releaseId, const std::string& expression)
+{
+	Wt::Dbo::Query<T> query {session.query<T>("SELECT " + expression + " FROM track t")
+		.where("t.release_id = ?").bind(releaseId)};
+
+	return query.resultValue();
+}
+
 Release::Release(const std::string& name, const std::optional<UUID>& MBID)
 : _name {std::string(name, 0 , _maxNameLength)},
 _MBID {MBID ? MBID->getAsString() : ""}
@@ -200,6 +241,20 @@ Release::getAllOrphans(Session& session)
 	return std::vector<pointer>(res.begin(), res.end());
 }
 
+std::size_t
+Release::removeAllOrphans(Session& session)
+{
+	session.checkUniqueLocked();
+
+	const std::string orphanClause {"id NOT IN (SELECT release_id FROM track WHERE release_id IS NOT NULL)"};
+
+	const int count {session.getDboSession().query<int>("SELECT COUNT(*) FROM release WHERE " + orphanClause)};
+	if (count > 0)
+		session.getDboSession().execute("DELETE FROM release WHERE " + orphanClause);
+
+	return count;
+}
+
 std::vector<Release::pointer>
 Release::getLastWritten(Session& session,
 		std::optional<Wt::WDateTime> after,
@@ -211,12 +266,20 @@ Release::getLastWritten(Session& session,
 
 	auto query {createQuery<Release::pointer>(session, "SELECT r from release r", clusterIds, {})};
 	if (after)
-		query.where("t.file_last_write > ?").bind(after);
+		query.where("r.last_written > ?").bind(after);
+
+	const bool useKeyset {range && range->after && getById(session, *range->after)};
+	if (useKeyset)
+	{
+		// The first condition is redundant but lets the index be searched
+		query.where("r.last_written <= (SELECT last_written FROM release WHERE id = ?)").bind(*range->after);
+		query.where("(r.last_written, r.id) < (SELECT last_written, id FROM release WHERE id = ?)").bind(*range->after);
+	}
 
 	Wt::Dbo::collection<Release::pointer> collection = query
-		.orderBy("t.file_last_write DESC")
+		.orderBy("r.last_written DESC, r.id DESC")
 		.groupBy("r.id")
-		.offset(range ? static_cast<int>(range->offset) : -1)
+		.offset(range && !useKeyset ? static_cast<int>(range->offset) : -1)
 		.limit(range ? static_cast<int>(range->limit) + 1: -1);
 
 	auto res {std::vector<pointer>(collection.begin(), collection.end())};
@@ -305,11 +368,22 @@ Release::getByFilter(Session& session,
 {
 	session.checkSharedLocked();
 
-	Wt::Dbo::collection<pointer> collection = createQuery<Release::pointer>(session, "SELECT r from release r", clusterIds, keywords)
+	auto query {createQuery<Release::pointer>(session, "SELECT r from release r", clusterIds, keywords)};
+
+	// Ranked results cannot be resumed from a given release
+	const bool rankedByRelevance {getFullTextSearchMatch(session, keywords).has_value()};
+	const bool useKeyset {range && range->after && !rankedByRelevance && getById(session, *range->after)};
+	if (useKeyset)
+	{
+		query.where("r.name COLLATE NOCASE >= (SELECT name FROM release WHERE id = ?)").bind(*range->after);
+		query.where("(r.name COLLATE NOCASE, r.id) > (SELECT name, id FROM release WHERE id = ?)").bind(*range->after);
+	}
+
+	Wt::Dbo::collection<pointer> collection = query
 		.groupBy("r.id")
-		.orderBy("r.name COLLATE NOCASE")
+		.orderBy(rankedByRelevance ? "release_fts.rank, r.name COLLATE NOCASE" : "r.name COLLATE NOCASE, r.id")
 		.limit(range ? static_cast<int>(range->limit) + 1 : -1)
-		.offset(range ? static_cast<int>(range->offset) : -1);
+		.offset(range && !useKeyset ? static_cast<int>(range->offset) : -1);
 
 	auto res {std::vector<pointer>(collection.begin(), collection.end())};
 
@@ -339,95 +413,94 @@ Release::getAllIdsWithClusters(Session& session, std::optional<std::size_t> limi
 }
 
 
-std::optional<std::size_t>
-Release::getTotalTrack(void) const
+std::vector<IdType>
+Release::getIdsByTracks(Session& session, const std::vector<IdType>& trackIds)
 {
-	assert(session());
-	assert(IdIsValid(self()->id()));
+	// Keep well below the max number of bound parameters
+	static constexpr std::size_t maxIdsPerStatement {500};
 
-	int res = session()->query<int>("SELECT COALESCE(MAX(total_track),0) FROM track t INNER JOIN release r ON r.id = t.release_id")
-		.where("r.id = ?")
-		.bind(this->id());
+	session.checkSharedLocked();
 
-	return (res > 0) ? std::make_optional<std::size_t>(res) : std::nullopt;
-}
+	std::set<IdType> releaseIds;
+	for (std::size_t offset {}; offset < trackIds.size(); offset += maxIdsPerStatement)
+	{
+		const std::size_t count {std::min(maxIdsPerStatement, trackIds.size() - offset)};
 
-std::optional<std::size_t>
-Release::getTotalDisc(void) const
-{
-	assert(session());
-	assert(IdIsValid(self()->id()));
+		std::string sql {"SELECT DISTINCT t.release_id FROM track t WHERE t.release_id IS NOT NULL AND t.id IN ("};
+		for (std::size_t i {}; i < count; ++i)
+			sql += (i == 0 ? "?" : ",?");
+		sql += ")";
 
-	int res = session()->query<int>("SELECT COALESCE(MAX(total_disc),0) FROM track t INNER JOIN release r ON r.id = t.release_id")
-		.where("r.id = ?")
-		.bind(this->id());
+		auto query {session.getDboSession().query<IdType>(sql)};
+		for (std::size_t i {}; i < count; ++i)
+			query.bind(trackIds[offset + i]);
 
-	return (res > 0) ? std::make_optional<std::size_t>(res) : std::nullopt;
+		Wt::Dbo::collection<IdType> res = query;
+		releaseIds.insert(std::cbegin(res), std::cend(res));
+	}
+
+	return std::vector<IdType>(std::cbegin(releaseIds), std::cend(releaseIds));
 }
 
-std::optional<int>
-Release::getReleaseYear(bool original) const
+void
+Release::updateAggregates()
 {
+	assert(self());
 	assert(session());
 
-	const std::string field {original ? "original_year" : "year"};
+	Wt::Dbo::Session& session {*this->session()};
 
-	Wt::Dbo::collection<int> dates = session()->query<int>(
-			std::string {"SELECT "} + "t." + field + " FROM track t INNER JOIN release r ON r.id = t.release_id")
-		.where("r.id = ?")
-		.groupBy(field)
-		.bind(this->id());
+	// The release may have been created in the current transaction
+	session.flush();
+	assert(IdIsValid(self()->id()));
 
-	// various dates => no date
-	if (dates.empty() || dates.size() > 1)
-		return std::nullopt;
+	const IdType releaseId {self()->id()};
 
-	auto date {dates.front()};
+	using milli = std::chrono::duration<int, std::milli>;
 
-	if (date > 0)
-		return date;
-	else
-		return std::nullopt;
-}
+	_trackCount = getTrackAggregate<int>(session, releaseId, "COUNT(*)");
+	_duration = getTrackAggregate<milli>(session, releaseId, "COALESCE(SUM(t.duration), 0)");
+	_lastWritten = getTrackAggregate<Wt::WDateTime>(session, releaseId, "COALESCE(MAX(t.file_last_write), '1970-01-01T00:00:00')");
+	_totalTrack = getTrackAggregate<int>(session, releaseId, "COALESCE(MAX(t.total_track), 0)");
+	_totalDisc = getTrackAggregate<int>(session, releaseId, "COALESCE(MAX(t.total_disc), 0)");
+	_year = getUniqueTrackValue<int>(session, releaseId, "year");
+	_originalYear = getUniqueTrackValue<int>(session, releaseId, "original_year");
+	_copyright = getUniqueTrackValue<std::string>(session, releaseId, "copyright");
+	_copyrightURL = getUniqueTrackValue<std::string>(session, releaseId, "copyright_url");
 
-std::optional<std::string>
-Release::getCopyright() const
-{
-	assert(session());
+	std::vector<Artist::pointer> primaryArtists {getReleaseArtists()};
+	if (primaryArtists.empty())
+		primaryArtists = getArtists();
 
-	Wt::Dbo::collection<std::string> copyrights = session()->query<std::string>
-		("SELECT copyright FROM track t INNER JOIN release r ON r.id = t.release_id")
-		.where("r.id = ?")
-		.groupBy("copyright")
-		.bind(this->id());
+	_primaryArtistCount = primaryArtists.size();
+	_primaryArtist = (primaryArtists.size() == 1 ? primaryArtists.front() : Artist::pointer {});
+}
 
-	std::vector<std::string> values(copyrights.begin(), copyrights.end());
+std::optional<int>
+Release::getReleaseYear(bool original) const
+{
+	const int year {original ? _originalYear : _year};
 
-	// various copyrights => no copyright
-	if (values.empty() || values.size() > 1 || values.front().empty())
+	if (year > 0)
+		return year;
+	else
 		return std::nullopt;
-
-	return values.front();
 }
 
-std::optional<std::string>
-Release::getCopyrightURL() const
+std::vector<Artist::pointer>
+Release::getPrimaryArtists() const
 {
-	assert(session());
+	if (_primaryArtistCount == 0)
+		return {};
 
-	Wt::Dbo::collection<std::string> copyrights = session()->query<std::string>
-		("SELECT copyright_url FROM track t INNER JOIN release r ON r.id = t.release_id")
-		.where("r.id = ?")
-		.groupBy("copyright_url")
-		.bind(this->id());
+	if (_primaryArtistCount == 1 && _primaryArtist)
+		return {_primaryArtist};
 
-	std::vector<std::string> values(copyrights.begin(), copyrights.end());
-
-	// various copyright URLs => no copyright URL
-	if (values.empty() || values.size() > 1 || values.front().empty())
-		return std::nullopt;
+	std::vector<Artist::pointer> artists {getReleaseArtists()};
+	if (artists.empty())
+		artists = getArtists();
 
-	return values.front();
+	return artists;
 }
 
 std::vector<Wt::Dbo::ptr<Artist>>
@@ -526,40 +599,6 @@ Release::getTracks(const std::set<IdType>& clusterIds) const
 	return std::vector< Wt::Dbo::ptr<Track> > (res.begin(), res.end());
 }
 
-std::size_t
-Release::getTracksCount() const
-{
-	return _tracks.size();
-}
-
-std::chrono::milliseconds
-Release::getDuration() const
-{
-	assert(self());
-	assert(self()->id() != Wt::Dbo::dbo_traits<Artist>::invalidId());
-	assert(session());
-
-	using milli = std::chrono::duration<int, std::milli>;
-
-	Wt::Dbo::Query<milli> query {session()->query<milli>("SELECT COALESCE(SUM(duration), 0) FROM track t INNER JOIN release r ON t.release_id = r.id")
-			.where("r.id = ?").bind(self()->id())};
-
-	return query.resultValue();
-}
-
-Wt::WDateTime
-Release::getLastWritten() const
-{
-	assert(self());
-	assert(self()->id() != Wt::Dbo::dbo_traits<Artist>::invalidId());
-	assert(session());
-
-	Wt::Dbo::Query<Wt::WDateTime> query {session()->query<Wt::WDateTime>("SELECT COALESCE(MAX(file_last_write), '1970-01-01T00:00:00') FROM track t INNER JOIN release r ON t.release_id = r.id")
-			.where("r.id = ?").bind(self()->id())};
-
-	return query.resultValue();
-}
-
 std::vector<std::vector<Wt::Dbo::ptr<Cluster>>>
 Release::getClusterGroups(std::vector<ClusterType::pointer> clusterTypes, std::size_t size) const
 {
@@ -29,7 +29,9 @@
 #include "database/Artist.hpp"
 #include "database/Cluster.hpp"
 #include "database/Db.hpp"
+#include "database/Directory.hpp"
 #include "database/Release.hpp"
+#include "database/ScanCheckpoint.hpp"
 #include "database/ScanSettings.hpp"
 #include "database/Track.hpp"
 #include "database/TrackBookmark.hpp"
@@ -37,10 +39,11 @@
 #include "database/TrackList.hpp"
 #include "database/TrackFeatures.hpp"
 #include "database/User.hpp"
+#include "FullTextSearch.hpp"
 
 namespace Database {
 
-#define LMS_DATABASE_VERSION	26
+#define LMS_DATABASE_VERSION	36
 
 using Version = std::size_t;
 
@@ -278,6 +281,98 @@ CREATE TABLE "user_backup" (
 			// Just increment the scan version of the settings to make the next scheduled scan rescan everything
 			ScanSettings::get(*this).modify()->incScanVersion();
 		}
+		else if (version == 26)
+		{
+			// Scanner writes files by batches
+			_session.execute("ALTER TABLE scan_settings ADD write_batch_size INTEGER NOT NULL DEFAULT(" + std::to_string(ScanSettings::defaultWriteBatchSize) + ")");
+			_session.execute("ALTER TABLE scan_settings ADD write_batch_max_duration INTEGER NOT NULL DEFAULT(" + std::to_string(ScanSettings::defaultWriteBatchMaxDuration.count()) + ")");
+		}
+		else if (version == 27)
+		{
+			// Directory fingerprints, to skip unchanged directories
+			_session.execute(R"(
+CREATE TABLE IF NOT EXISTS "directory" (
+  "id" integer primary key autoincrement,
+  "version" integer not null,
+  "path" text not null,
+  "last_write" text,
+  "entry_count" integer not null,
+  "children_hash" bigint not null,
+  "scan_version" integer not null
+))");
+		}
+		else if (version == 28)
+		{
+			// Scan checkpoint, to resume aborted scans
+			_session.execute(R"(
+CREATE TABLE IF NOT EXISTS "scan_checkpoint" (
+  "id" integer primary key autoincrement,
+  "version" integer not null,
+  "scan_version" integer not null,
+  "media_directory" text not null,
+  "force_scan" boolean not null,
+  "phase" integer not null,
+  "last_directory" text not null
+))");
+		}
+		else if (version == 29)
+		{
+			// File fingerprints, to follow moved files
+			_session.execute("ALTER TABLE track ADD file_size BIGINT NOT NULL DEFAULT(0)");
+			_session.execute("ALTER TABLE track ADD file_content_hash BIGINT");
+			// Make the next scan check every file once, so that the missing fingerprints get computed (no file is parsed again)
+			_session.execute("DELETE FROM directory");
+		}
+		else if (version == 30)
+		{
+			// Scanner scheduling controls
+			_session.execute("ALTER TABLE scan_settings ADD scanner_priority INTEGER NOT NULL DEFAULT(" + std::to_string(static_cast<int>(ScanSettings::defaultScannerPriority)) + ")");
+			_session.execute("ALTER TABLE scan_settings ADD max_files_per_second INTEGER NOT NULL DEFAULT(" + std::to_string(ScanSettings::defaultMaxFilesPerSecond) + ")");
+			_session.execute("ALTER TABLE scan_settings ADD back_off_when_streaming BOOLEAN NOT NULL DEFAULT(" + std::string {ScanSettings::defaultBackOffWhenStreaming ? "1" : "0"} + ")");
+		}
+		else if (version == 31)
+		{
+			// Embedded cover location
+			_session.execute("ALTER TABLE track ADD cover_offset BIGINT");
+			_session.execute("ALTER TABLE track ADD cover_size BIGINT NOT NULL DEFAULT(0)");
+			_session.execute("ALTER TABLE track ADD cover_mime_type TEXT NOT NULL DEFAULT('')");
+			_session.execute("ALTER TABLE track ADD cover_width INTEGER NOT NULL DEFAULT(0)");
+			_session.execute("ALTER TABLE track ADD cover_height INTEGER NOT NULL DEFAULT(0)");
+
+			// Filled in as the files get scanned again: the cover art grabber parses the files that have none
+		}
+		else if (version == 32)
+		{
+			_session.execute("ALTER TABLE scan_settings ADD scan_newest_first BOOLEAN NOT NULL DEFAULT(" + std::string {ScanSettings::defaultScanNewestFirst ? "1" : "0"} + ")");
+		}
+		else if (version == 33)
+		{
+			// Release aggregates, kept up to date by the scanner
+			_session.execute("ALTER TABLE release ADD track_count INTEGER NOT NULL DEFAULT(0)");
+			_session.execute("ALTER TABLE release ADD duration INTEGER NOT NULL DEFAULT(0)");
+			_session.execute("ALTER TABLE release ADD last_written TEXT");
+			_session.execute("ALTER TABLE release ADD total_track INTEGER NOT NULL DEFAULT(0)");
+			_session.execute("ALTER TABLE release ADD total_disc INTEGER NOT NULL DEFAULT(0)");
+			_session.execute("ALTER TABLE release ADD year INTEGER NOT NULL DEFAULT(0)");
+			_session.execute("ALTER TABLE release ADD original_year INTEGER NOT NULL DEFAULT(0)");
+			_session.execute("ALTER TABLE release ADD copyright TEXT NOT NULL DEFAULT('')");
+			_session.execute("ALTER TABLE release ADD copyright_url TEXT NOT NULL DEFAULT('')");
+			_session.execute("ALTER TABLE release ADD primary_artist_count INTEGER NOT NULL DEFAULT(0)");
+			_session.execute("ALTER TABLE release ADD primary_artist_id BIGINT REFERENCES artist(id) ON DELETE SET NULL DEFERRABLE INITIALLY DEFERRED");
+
+			// Computed from the tracks, no need to rescan the files
+			for (const Release::pointer& release : Release::getAll(*this))
+				release.modify()->updateAggregates();
+		}
+		else if (version == 34)
+		{
+			_session.execute("ALTER TABLE scan_settings ADD skip_unchanged_directories BOOLEAN NOT NULL DEFAULT(" + std::string {ScanSettings::defaultSkipUnchangedDirectories ? "1" : "0"} + ")");
+		}
+		else if (version == 35)
+		{
+			// Checkpoints saved without it do not skip any directory when resumed
+			_session.execute("ALTER TABLE scan_checkpoint ADD scan_start_time TEXT");
+		}
 		else
 		{
 			LMS_LOG(DB, ERROR) << "Database version " << version << " cannot be handled using migration";
@@ -298,7 +393,9 @@ Session::Session(Db& db)
 	_session.mapClass<AuthToken>("auth_token");
 	_session.mapClass<Cluster>("cluster");
 	_session.mapClass<ClusterType>("cluster_type");
+	_session.mapClass<Directory>("directory");
 	_session.mapClass<Release>("release");
+	_session.mapClass<ScanCheckpoint>("scan_checkpoint");
 	_session.mapClass<ScanSettings>("scan_settings");
 	_session.mapClass<Track>("track");
 	_session.mapClass<TrackBookmark>("track_bookmark");
@@ -319,32 +416,34 @@ enum class OwnedLock
 
 static thread_local std::map<std::shared_mutex*, OwnedLock> lockDebug;
 
-UniqueTransaction::UniqueTransaction(std::shared_mutex& mutex, Wt::Dbo::Session& session)
-: _lock {mutex},
+UniqueTransaction::UniqueTransaction(Db& db, Wt::Dbo::Session& session)
+: _mutex {db.getMutex()},
+ _lock {db.hasConcurrentReaders() ? std::unique_lock<std::shared_mutex> {} : std::unique_lock {_mutex}},
  _transaction {session}
 {
-	assert(lockDebug[_lock.mutex()] == OwnedLock::None);
-	lockDebug[_lock.mutex()] = OwnedLock::Unique;
+	assert(lockDebug[&_mutex] == OwnedLock::None);
+	lockDebug[&_mutex] = OwnedLock::Unique;
 }
 
 UniqueTransaction::~UniqueTransaction()
 {
-	assert(lockDebug[_lock.mutex()] == OwnedLock::Unique);
-	lockDebug[_lock.mutex()] = OwnedLock::None;
+	assert(lockDebug[&_mutex] == OwnedLock::Unique);
+	lockDebug[&_mutex] = OwnedLock::None;
 }
 
-SharedTransaction::SharedTransaction(std::shared_mutex& mutex, Wt::Dbo::Session& session)
-: _lock {mutex},
+SharedTransaction::SharedTransaction(Db& db, Wt::Dbo::Session& session)
+: _mutex {db.getMutex()},
+ _lock {db.hasConcurrentReaders() ? std::shared_lock<std::shared_mutex> {} : std::shared_lock {_mutex}},
  _transaction {session}
 {
-	assert(lockDebug[_lock.mutex()] == OwnedLock::None);
-	lockDebug[_lock.mutex()] = OwnedLock::Shared;
+	assert(lockDebug[&_mutex] == OwnedLock::None);
+	lockDebug[&_mutex] = OwnedLock::Shared;
 }
 
 SharedTransaction::~SharedTransaction()
 {
-	assert(lockDebug[_lock.mutex()] == OwnedLock::Shared);
-	lockDebug[_lock.mutex()] = OwnedLock::None;
+	assert(lockDebug[&_mutex] == OwnedLock::Shared);
+	lockDebug[&_mutex] = OwnedLock::None;
 }
 
 void
@@ -362,13 +461,17 @@ Session::checkSharedLocked()
 UniqueTransaction
 Session::createUniqueTransaction()
 {
-	return UniqueTransaction{_db.getMutex(), _session};
+	// Would write using the reader connection if the readers are concurrent, and deadlock otherwise
+	if (lockDebug[&_db.getMutex()] == OwnedLock::Shared)
+		throw LmsException {"Cannot create a unique transaction within a shared transaction"};
+
+	return UniqueTransaction{_db, _session};
 }
 
 SharedTransaction
 Session::createSharedTransaction()
 {
-	return SharedTransaction{_db.getMutex(), _session};
+	return SharedTransaction{_db, _session};
 }
 
 void
@@ -376,6 +479,7 @@ Session::prepareTables()
 {
 	// Creation case
 	try {
+		Db::ScopedWriterConnection writerConnection;
 	        _session.createTables();
 
 		LMS_LOG(DB, INFO) << "Tables created";
@@ -391,6 +495,7 @@ Session::prepareTables()
 	{
 		auto uniqueTransaction {createUniqueTransaction()};
 		_session.execute("CREATE INDEX IF NOT EXISTS artist_name_idx ON artist(name)");
+		_session.execute("CREATE INDEX IF NOT EXISTS artist_name_nocase_idx ON artist(name COLLATE NOCASE)");
 		_session.execute("CREATE INDEX IF NOT EXISTS artist_sort_name_nocase_idx ON artist(sort_name COLLATE NOCASE)");
 		_session.execute("CREATE INDEX IF NOT EXISTS artist_mbid_idx ON artist(mbid)");
 		_session.execute("CREATE INDEX IF NOT EXISTS auth_token_user_idx ON auth_token(user_id)");
@@ -399,8 +504,10 @@ Session::prepareTables()
 		_session.execute("CREATE INDEX IF NOT EXISTS cluster_name_idx ON cluster(name)");
 		_session.execute("CREATE INDEX IF NOT EXISTS cluster_cluster_type_idx ON cluster(cluster_type_id)");
 		_session.execute("CREATE INDEX IF NOT EXISTS cluster_type_name_idx ON cluster_type(name)");
+		_session.execute("CREATE INDEX IF NOT EXISTS directory_path_idx ON directory(path)");
 		_session.execute("CREATE INDEX IF NOT EXISTS release_name_idx ON release(name)");
 		_session.execute("CREATE INDEX IF NOT EXISTS release_name_nocase_idx ON release(name COLLATE NOCASE)");
+		_session.execute("CREATE INDEX IF NOT EXISTS release_last_written_idx ON release(last_written)");
 		_session.execute("CREATE INDEX IF NOT EXISTS release_mbid_idx ON release(mbid)");
 		_session.execute("CREATE INDEX IF NOT EXISTS track_file_last_write_idx ON track(file_last_write)");
 		_session.execute("CREATE INDEX IF NOT EXISTS track_path_idx ON track(file_path)");
@@ -419,6 +526,21 @@ Session::prepareTables()
 		_session.execute("CREATE INDEX IF NOT EXISTS track_artist_link_type_idx ON track_artist_link(type)");
 		_session.execute("CREATE INDEX IF NOT EXISTS track_bookmark_user_idx ON track_bookmark(user_id)");
 		_session.execute("CREATE INDEX IF NOT EXISTS track_bookmark_user_track_idx ON track_bookmark(user_id,track_id)");
+		_session.execute("CREATE INDEX IF NOT EXISTS track_cluster_cluster_idx ON track_cluster(cluster_id)");
+		_session.execute("CREATE INDEX IF NOT EXISTS track_cluster_track_idx ON track_cluster(track_id)");
+	}
+
+	// Full text search, optional since SQLite may be built without FTS5
+	try
+	{
+		auto uniqueTransaction {createUniqueTransaction()};
+
+		createFullTextSearchTables(_session);
+		_db._fullTextSearch = true;
+	}
+	catch (Wt::Dbo::Exception& e)
+	{
+		LMS_LOG(DB, ERROR) << "Cannot set up full text search, using slower searches: " << e.what();
 	}
 
 	// Initial settings tables
@@ -429,6 +551,12 @@ Session::prepareTables()
 	}
 }
 
+bool
+Session::hasFullTextSearch() const
+{
+	return _db._fullTextSearch;
+}
+
 void
 Session::optimize()
 {
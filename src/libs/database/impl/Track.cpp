@@ -28,6 +28,7 @@
 #include "database/Session.hpp"
 #include "utils/Logger.hpp"
 
+#include "FullTextSearch.hpp"
 #include "SqlQuery.hpp"
 
 namespace Database {
@@ -44,8 +45,16 @@ createQuery(Session& session,
 
 	auto query {session.getDboSession().query<T>(queryStr)};
 
-	for (const std::string& keyword : keywords)
-		query.where("t.name LIKE ?").bind("%%" + keyword + "%%");
+	if (const std::optional<std::string> fullTextSearchMatch {getFullTextSearchMatch(session, keywords)})
+	{
+		query.join("track_fts ON track_fts.rowid = t.id");
+		query.where("track_fts MATCH ?").bind(*fullTextSearchMatch);
+	}
+	else
+	{
+		for (const std::string& keyword : keywords)
+			query.where("t.name LIKE ?").bind("%%" + keyword + "%%");
+	}
 
 	if (!clusterIds.empty())
 	{
@@ -140,6 +149,20 @@ Track::getByPath(Session& session, const std::filesystem::path& p)
 	return session.getDboSession().find<Track>().where("file_path = ?").bind(p.string());
 }
 
+std::vector<Track::pointer>
+Track::getByDirectory(Session& session, const std::filesystem::path& directory)
+{
+	session.checkSharedLocked();
+
+	// Paths starting with "directory/": make use of the path index ('0' follows '/')
+	const std::string directoryStr {directory.string()};
+
+	Wt::Dbo::collection<pointer> res = session.getDboSession().find<Track>()
+		.where("file_path > ? AND file_path < ?").bind(directoryStr + "/").bind(directoryStr + "0");
+
+	return std::vector<pointer>(res.begin(), res.end());
+}
+
 Track::pointer
 Track::getById(Session& session, IdType id)
 {
@@ -169,26 +192,45 @@ Track::create(Session& session, const std::filesystem::path& p)
 	return res;
 }
 
-std::vector<std::pair<IdType, std::filesystem::path>>
-Track::getAllPaths(Session& session, std::optional<std::size_t> offset, std::optional<std::size_t> size)
+void
+Track::visitAllFileInfos(Session& session, const std::function<void(const FileInfo&)>& visitor)
 {
-	using QueryResultType = std::tuple<IdType, std::string>;
+	using QueryResultType = std::tuple<IdType, std::string, Wt::WDateTime, int, long long, std::optional<long long>>;
 	session.checkSharedLocked();
 
-	Wt::Dbo::collection<QueryResultType> queryRes = session.getDboSession().query<QueryResultType>("SELECT id,file_path FROM track")
-		.limit(size ? static_cast<int>(*size) + 1 : -1)
-		.offset(offset ? static_cast<int>(*offset) : -1);
+	Wt::Dbo::collection<QueryResultType> queryRes = session.getDboSession().query<QueryResultType>("SELECT id,file_path,file_last_write,scan_version,file_size,file_content_hash FROM track");
+
+	for (const QueryResultType& queryResult : queryRes)
+	{
+		std::optional<FileFingerprint> fingerprint;
+		if (std::get<5>(queryResult))
+			fingerprint = FileFingerprint {static_cast<std::uint64_t>(std::get<4>(queryResult)), static_cast<std::uint64_t>(*std::get<5>(queryResult))};
+
+		visitor(FileInfo {std::get<0>(queryResult), std::get<1>(queryResult), std::get<2>(queryResult), static_cast<std::size_t>(std::get<3>(queryResult)), fingerprint});
+	}
+}
+
+void
+Track::removeByIds(Session& session, const std::vector<IdType>& trackIds)
+{
+	// Keep well below the max number of bound parameters
+	static constexpr std::size_t maxIdsPerStatement {500};
+
+	session.checkUniqueLocked();
 
-	std::vector<std::pair<IdType, std::filesystem::path>> result;
-	result.reserve(queryRes.size());
+	for (std::size_t offset {}; offset < trackIds.size(); offset += maxIdsPerStatement)
+	{
+		const std::size_t count {std::min(maxIdsPerStatement, trackIds.size() - offset)};
 
-	std::transform(std::begin(queryRes), std::end(queryRes), std::back_inserter(result),
-			[](const QueryResultType& queryResult)
-			{
-				return std::make_pair(std::get<0>(queryResult), std::get<1>(queryResult));
-			});
+		std::string sql {"DELETE FROM track WHERE id IN ("};
+		for (std::size_t i {}; i < count; ++i)
+			sql += (i == 0 ? "?" : ",?");
+		sql += ")";
 
-	return result;
+		auto query {session.getDboSession().execute(sql)};
+		for (std::size_t i {}; i < count; ++i)
+			query.bind(trackIds[offset + i]);
+	}
 }
 
 std::vector<Track::pointer>
@@ -337,9 +379,19 @@ Track::getByFilter(Session& session,
 {
 	session.checkSharedLocked();
 
-	Wt::Dbo::collection<pointer> collection = createQuery<Track::pointer>(session, "SELECT t from track t", clusterIds, keywords)
+	auto query {createQuery<Track::pointer>(session, "SELECT t from track t", clusterIds, keywords)};
+
+	// Ranked results cannot be resumed from a given track
+	const bool rankedByRelevance {getFullTextSearchMatch(session, keywords).has_value()};
+	const bool useKeyset {range && range->after && !rankedByRelevance};
+	if (useKeyset)
+		query.where("t.id > ?").bind(*range->after);
+
+	query.orderBy(rankedByRelevance ? "track_fts.rank" : "t.id");
+
+	Wt::Dbo::collection<pointer> collection = query
 		.limit(range ? static_cast<int>(range->limit) + 1 : -1)
-		.offset(range ? static_cast<int>(range->offset) : -1);
+		.offset(range && !useKeyset ? static_cast<int>(range->offset) : -1);
 
 	std::vector<pointer> res(collection.begin(), collection.end());
 	if (range && (res.size() == static_cast<std::size_t>(range->limit) + 1))
@@ -431,6 +483,41 @@ Track::setFeatures(const Wt::Dbo::ptr<TrackFeatures>& features)
 	_trackFeatures = features;
 }
 
+void
+Track::setFileFingerprint(const std::optional<FileFingerprint>& fingerprint)
+{
+	_fileSize = fingerprint ? static_cast<long long>(fingerprint->size) : 0;
+	_fileContentHash = fingerprint ? std::make_optional(static_cast<long long>(fingerprint->contentHash)) : std::nullopt;
+}
+
+std::optional<Track::FileFingerprint>
+Track::getFileFingerprint() const
+{
+	if (!_fileContentHash)
+		return std::nullopt;
+
+	return FileFingerprint {static_cast<std::uint64_t>(_fileSize), static_cast<std::uint64_t>(*_fileContentHash)};
+}
+
+void
+Track::setEmbeddedCover(const std::optional<EmbeddedCover>& embeddedCover)
+{
+	_coverOffset = embeddedCover ? std::make_optional(static_cast<long long>(embeddedCover->offset)) : std::nullopt;
+	_coverSize = embeddedCover ? static_cast<long long>(embeddedCover->size) : 0;
+	_coverMimeType = embeddedCover ? embeddedCover->mimeType : "";
+	_coverWidth = embeddedCover ? static_cast<int>(embeddedCover->width) : 0;
+	_coverHeight = embeddedCover ? static_cast<int>(embeddedCover->height) : 0;
+}
+
+std::optional<Track::EmbeddedCover>
+Track::getEmbeddedCover() const
+{
+	if (!_coverOffset)
+		return std::nullopt;
+
+	return EmbeddedCover {static_cast<std::uint64_t>(*_coverOffset), static_cast<std::uint64_t>(_coverSize), _coverMimeType, static_cast<std::size_t>(_coverWidth), static_cast<std::size_t>(_coverHeight)};
+}
+
 std::optional<std::size_t>
 Track::getTrackNumber() const
 {
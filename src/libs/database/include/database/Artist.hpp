@@ -50,6 +50,7 @@ class Artist : public Wt::Dbo::Dbo<Artist>
 			None,
 			ByName,
 			BySortName,
+			ByRelevance,	// best keyword matches first, then by sort name
 		};
 
 		using pointer = Wt::Dbo::ptr<Artist>;
@@ -79,6 +80,7 @@ class Artist : public Wt::Dbo::Dbo<Artist>
 		static std::vector<IdType>	getAllIds(Session& session);
 		static std::vector<IdType>	getAllIdsRandom(Session& session, const std::set<IdType>& clusters, std::optional<TrackArtistLink::Type> linkType, std::optional<std::size_t> size = {});
 		static std::vector<pointer>	getAllOrphans(Session& session); // No track related
+		static std::size_t		removeAllOrphans(Session& session); // returns the number of removed artists
 		static std::vector<pointer>	getLastWritten(Session& session,
 								std::optional<Wt::WDateTime> after,
 								const std::set<IdType>& clusters,
@@ -48,6 +48,9 @@ class Cluster : public Wt::Dbo::Dbo<Cluster>
 		static std::vector<pointer> getAllOrphans(Session& session);
 		static pointer getById(Session& session, IdType id);
 
+		// Remove utility
+		static std::size_t removeAllOrphans(Session& session); // returns the number of removed clusters
+
 		// Create utility
 		static pointer create(Session& session, Wt::Dbo::ptr<ClusterType> type, std::string name);
 
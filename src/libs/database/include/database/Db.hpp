@@ -19,19 +19,47 @@
 
 #pragma once
 
+#include <atomic>
+#include <chrono>
 #include <filesystem>
+#include <memory>
 #include <shared_mutex>
 
 #include <Wt/Dbo/SqlConnectionPool.h>
 
 namespace Database {
 
+struct StatementCacheCounters;
+
 // Session living class handling the database and the login
 class Db
 {
 	public:
+		enum class ConcurrencyMode
+		{
+			Serialized,	// writers block all the readers of the process
+			Concurrent,	// readers use their own connection and snapshot, writers are serialized by a single connection
+		};
+
+		enum class TempStore
+		{
+			Default,
+			File,
+			Memory,
+		};
+
+		struct Parameters
+		{
+			ConcurrencyMode			concurrencyMode {ConcurrencyMode::Serialized};
+			std::size_t			connectionCount {10};	// reader connections if concurrent
+			std::chrono::seconds		connectionTimeout {10};
+			std::size_t			mmapSize {};		// in bytes, 0 means no memory-mapped I/O
+			std::size_t			cacheSize {2000};	// page cache of each connection, in KiB
+			TempStore			tempStore {TempStore::Default};
+		};
 
 		Db(const std::filesystem::path& dbPath);
+		Db(const std::filesystem::path& dbPath, const Parameters& parameters);
 		~Db();
 
 		Db(const Db&) = delete;
@@ -39,11 +67,38 @@ class Db
 		Db& operator=(const Db&) = delete;
 		Db& operator=(Db&&) = delete;
 
+		struct StatementCacheStats
+		{
+			std::size_t hits {};
+			std::size_t misses {};	// statement prepared
+		};
+		// Summed over all the connections, since the database is opened
+		StatementCacheStats getStatementCacheStats() const;
+
 	private:
 		friend class Session;
+		friend class UniqueTransaction;
+		friend class SharedTransaction;
 
 		std::shared_mutex&		getMutex() { return _sharedMutex; }
 		Wt::Dbo::SqlConnectionPool&	getConnectionPool() { return *_connectionPool; }
+		bool				hasConcurrentReaders() const { return _concurrencyMode == ConcurrencyMode::Concurrent; }
+
+		// While in scope, the calling thread uses the writer connection (no effect in serialized mode)
+		class ScopedWriterConnection
+		{
+			public:
+				ScopedWriterConnection();
+				~ScopedWriterConnection();
+
+				ScopedWriterConnection(const ScopedWriterConnection&) = delete;
+				ScopedWriterConnection(ScopedWriterConnection&&) = delete;
+				ScopedWriterConnection& operator=(const ScopedWriterConnection&) = delete;
+				ScopedWriterConnection& operator=(ScopedWriterConnection&&) = delete;
+
+			private:
+				bool _previousValue;
+		};
 
 		class ScopedConnection
 		{
@@ -86,7 +141,10 @@ class Db
 
 		void executeSql(const std::string& sql);
 
-		std::shared_mutex				_sharedMutex;
+		const ConcurrencyMode				_concurrencyMode;
+		std::unique_ptr<StatementCacheCounters>		_statementCacheCounters;	// must outlive the connections
+		std::shared_mutex				_sharedMutex;	// only locked in serialized mode
+		std::atomic<bool>				_fullTextSearch {};
 		std::unique_ptr<Wt::Dbo::SqlConnectionPool>	_connectionPool;
 };
 
@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2020 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+#include <Wt/Dbo/Dbo.h>
+#include <Wt/Dbo/WtSqlTraits.h>
+#include <Wt/WDateTime.h>
+
+#include "Types.hpp"
+
+namespace Database {
+
+class Session;
+
+// Fingerprint of a media directory, as seen during the last scan
+// Used by the scanner to skip the directories that did not change
+class Directory : public Wt::Dbo::Dbo<Directory>
+{
+	public:
+		using pointer = Wt::Dbo::ptr<Directory>;
+
+		Directory() = default;
+		Directory(const std::filesystem::path& p);
+
+		// Accessors
+		static pointer			getById(Session& session, IdType id);
+		static pointer			getByPath(Session& session, const std::filesystem::path& p);
+		static std::vector<pointer>	getAll(Session& session);
+
+		// Create
+		static pointer create(Session& session, const std::filesystem::path& p);
+
+		std::filesystem::path	getPath() const			{ return _path; }
+		Wt::WDateTime		getLastWriteTime() const	{ return _lastWrite; }
+		std::size_t		getEntryCount() const		{ return _entryCount; }
+		std::uint64_t		getChildrenHash() const		{ return static_cast<std::uint64_t>(_childrenHash); }
+		std::size_t		getScanVersion() const		{ return _scanVersion; }
+
+		void setLastWriteTime(const Wt::WDateTime& lastWrite)	{ _lastWrite = lastWrite; }
+		void setEntryCount(std::size_t entryCount)		{ _entryCount = static_cast<int>(entryCount); }
+		void setChildrenHash(std::uint64_t childrenHash)	{ _childrenHash = static_cast<long long>(childrenHash); }
+		void setScanVersion(std::size_t scanVersion)		{ _scanVersion = static_cast<int>(scanVersion); }
+
+		template<class Action>
+		void persist(Action& a)
+		{
+			Wt::Dbo::field(a, _path,		"path");
+			Wt::Dbo::field(a, _lastWrite,		"last_write");
+			Wt::Dbo::field(a, _entryCount,		"entry_count");
+			Wt::Dbo::field(a, _childrenHash,	"children_hash");
+			Wt::Dbo::field(a, _scanVersion,		"scan_version");
+		}
+
+	private:
+		std::string	_path;
+		Wt::WDateTime	_lastWrite;
+		int		_entryCount {};		// number of entries in the directory
+		long long	_childrenHash {};	// hash of the names of the audio files and sub directories
+		int		_scanVersion {};
+};
+
+} // namespace Database
+
@@ -19,9 +19,13 @@
 
 #pragma once
 
+#include <chrono>
 #include <optional>
+#include <string>
+#include <vector>
 
 #include <Wt/Dbo/WtSqlTraits.h>
+#include <Wt/WDateTime.h>
 
 #include "utils/UUID.hpp"
 #include "TrackArtistLink.hpp"
@@ -52,6 +56,7 @@ class Release : public Wt::Dbo::Dbo<Release>
 		static std::vector<pointer>	getByName(Session& session, const std::string& name);
 		static pointer			getById(Session& session, IdType id);
 		static std::vector<pointer>	getAllOrphans(Session& session); // no track related
+		static std::size_t		removeAllOrphans(Session& session); // returns the number of removed releases
 		static std::vector<pointer>	getAll(Session& session, std::optional<Range> range = std::nullopt);
 		static std::vector<IdType>	getAllIds(Session& session);
 		static std::vector<pointer>	getAllOrderedByArtist(Session& session, std::optional<std::size_t> offset = {}, std::optional<std::size_t> size = {});
@@ -69,8 +74,9 @@ class Release : public Wt::Dbo::Dbo<Release>
 							bool& moreExpected);
 		static std::vector<IdType>	getAllIdsWithClusters(Session& session, std::optional<std::size_t> limit = {});
 
+		static std::vector<IdType>	getIdsByTracks(Session& session, const std::vector<IdType>& trackIds);
+
 		std::vector<Wt::Dbo::ptr<Track>> getTracks(const std::set<IdType>& clusters = std::set<IdType>()) const;
-		std::size_t			getTracksCount() const;
 
 		// Get the cluster of the tracks that belong to this release
 		// Each clusters are grouped by cluster type, sorted by the number of occurence (max to min)
@@ -80,18 +86,24 @@ class Release : public Wt::Dbo::Dbo<Release>
 		// Create
 		static pointer create(Session& session, const std::string& name, const std::optional<UUID>& MBID = {});
 
-		// Utility functions
-		std::optional<int> getReleaseYear(bool originalDate = false) const; // 0 if unknown or various
-		std::optional<std::string> getCopyright() const;
-		std::optional<std::string> getCopyrightURL() const;
-
 		// Accessors
 		const std::string&		getName() const		{ return _name; }
 		std::optional<UUID>		getMBID() const		{ return UUID::fromString(_MBID); }
-		std::optional<std::size_t>	getTotalTrack() const;
-		std::optional<std::size_t>	getTotalDisc() const;
-		std::chrono::milliseconds	getDuration() const;
-		Wt::WDateTime				getLastWritten() const;
+
+		// Aggregates of the tracks, stored in the release: must be updated each time the tracks change
+		void				updateAggregates();
+		std::size_t			getTracksCount() const	{ return _trackCount; }
+		std::chrono::milliseconds	getDuration() const	{ return _duration; }
+		Wt::WDateTime			getLastWritten() const	{ return _lastWritten; }
+		std::optional<std::size_t>	getTotalTrack() const	{ return _totalTrack > 0 ? std::make_optional<std::size_t>(_totalTrack) : std::nullopt; }
+		std::optional<std::size_t>	getTotalDisc() const	{ return _totalDisc > 0 ? std::make_optional<std::size_t>(_totalDisc) : std::nullopt; }
+		std::optional<int>		getReleaseYear(bool originalDate = false) const; // not set if unknown or various
+		std::optional<std::string>	getCopyright() const	{ return _copyright.empty() ? std::nullopt : std::make_optional(_copyright); } // not set if unknown or various
+		std::optional<std::string>	getCopyrightURL() const	{ return _copyrightURL.empty() ? std::nullopt : std::make_optional(_copyrightURL); } // not set if unknown or various
+
+		// Primary artists are the release artists, or the track artists if there is none
+		std::size_t			getPrimaryArtistCount() const	{ return _primaryArtistCount; }
+		std::vector<Wt::Dbo::ptr<Artist>> getPrimaryArtists() const; // no query unless there are several primary artists
 
 		// Get the artists of this release
 		std::vector<Wt::Dbo::ptr<Artist> > getArtists(TrackArtistLink::Type type = TrackArtistLink::Type::Artist) const;
@@ -107,6 +119,18 @@ class Release : public Wt::Dbo::Dbo<Release>
 			{
 				Wt::Dbo::field(a, _name, "name");
 				Wt::Dbo::field(a, _MBID, "mbid");
+				Wt::Dbo::field(a, _trackCount, "track_count");
+				Wt::Dbo::field(a, _duration, "duration");
+				Wt::Dbo::field(a, _lastWritten, "last_written");
+				Wt::Dbo::field(a, _totalTrack, "total_track");
+				Wt::Dbo::field(a, _totalDisc, "total_disc");
+				Wt::Dbo::field(a, _year, "year");
+				Wt::Dbo::field(a, _originalYear, "original_year");
+				Wt::Dbo::field(a, _copyright, "copyright");
+				Wt::Dbo::field(a, _copyrightURL, "copyright_url");
+				Wt::Dbo::field(a, _primaryArtistCount, "primary_artist_count");
+
+				Wt::Dbo::belongsTo(a, _primaryArtist, "primary_artist", Wt::Dbo::OnDeleteSetNull);
 
 				Wt::Dbo::hasMany(a, _tracks, Wt::Dbo::ManyToOne, "release");
 				Wt::Dbo::hasMany(a, _starringUsers, Wt::Dbo::ManyToMany, "user_release_starred", "", Wt::Dbo::OnDeleteCascade);
@@ -118,6 +142,19 @@ class Release : public Wt::Dbo::Dbo<Release>
 		std::string	_name;
 		std::string	_MBID;
 
+		// Aggregates
+		int					_trackCount {};
+		std::chrono::duration<int, std::milli>	_duration {};
+		Wt::WDateTime				_lastWritten;
+		int					_totalTrack {};
+		int					_totalDisc {};
+		int					_year {};		// 0 if unknown or various
+		int					_originalYear {};	// 0 if unknown or various
+		std::string				_copyright;		// empty if unknown or various
+		std::string				_copyrightURL;		// empty if unknown or various
+		int					_primaryArtistCount {};
+		Wt::Dbo::ptr<Artist>			_primaryArtist;		// only set if there is a single primary artist
+
 		Wt::Dbo::collection<Wt::Dbo::ptr<Track>>	_tracks; // Tracks in the release
 		Wt::Dbo::collection<Wt::Dbo::ptr<User>>		_starringUsers; // Users that starred this release
 };
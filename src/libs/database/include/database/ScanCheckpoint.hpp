@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2020 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <filesystem>
+#include <string>
+
+#include <Wt/Dbo/Dbo.h>
+#include <Wt/Dbo/WtSqlTraits.h>
+#include <Wt/WDateTime.h>
+
+#include "Types.hpp"
+
+namespace Database {
+
+class Session;
+
+// Progress of the current full scan, committed along with the scanned files
+// Used by the scanner to resume an aborted scan instead of starting over
+// There is at most one checkpoint in the database
+class ScanCheckpoint : public Wt::Dbo::Dbo<ScanCheckpoint>
+{
+	public:
+		using pointer = Wt::Dbo::ptr<ScanCheckpoint>;
+
+		// Do not modify values (just add)
+		enum class Phase
+		{
+			ScanningFiles = 0,	// files are written up to the last directory
+			FilesScanned,		// all the files are written, the post scan steps are left
+		};
+
+		ScanCheckpoint() = default;
+
+		// Accessors
+		static pointer	get(Session& session);
+		static pointer	getById(Session& session, IdType id);
+
+		// Create
+		static pointer	create(Session& session);
+
+		std::size_t		getScanVersion() const		{ return _scanVersion; }
+		std::filesystem::path	getMediaDirectory() const	{ return _mediaDirectory; }
+		bool			isForceScan() const		{ return _forceScan; }
+		Phase			getPhase() const		{ return _phase; }
+		std::filesystem::path	getLastDirectory() const	{ return _lastDirectory; }
+		const Wt::WDateTime&	getScanStartTime() const	{ return _scanStartTime; }
+
+		void setScanVersion(std::size_t scanVersion)			{ _scanVersion = static_cast<int>(scanVersion); }
+		void setMediaDirectory(const std::filesystem::path& p)		{ _mediaDirectory = p.string(); }
+		void setForceScan(bool forceScan)				{ _forceScan = forceScan; }
+		void setPhase(Phase phase)					{ _phase = phase; }
+		void setLastDirectory(const std::filesystem::path& p)		{ _lastDirectory = p.string(); }
+		void setScanStartTime(const Wt::WDateTime& time)		{ _scanStartTime = time; }
+
+		template<class Action>
+		void persist(Action& a)
+		{
+			Wt::Dbo::field(a, _scanVersion,		"scan_version");
+			Wt::Dbo::field(a, _mediaDirectory,	"media_directory");
+			Wt::Dbo::field(a, _forceScan,		"force_scan");
+			Wt::Dbo::field(a, _phase,		"phase");
+			Wt::Dbo::field(a, _lastDirectory,	"last_directory");
+			Wt::Dbo::field(a, _scanStartTime,	"scan_start_time");
+		}
+
+	private:
+		int		_scanVersion {};
+		std::string	_mediaDirectory;
+		bool		_forceScan {};
+		Phase		_phase {Phase::ScanningFiles};
+		std::string	_lastDirectory;		// empty if no directory has been fully written yet
+		Wt::WDateTime	_scanStartTime;		// start of the scan that saved the checkpoint: directories modified since then have to be scanned again
+};
+
+} // namespace Database
+
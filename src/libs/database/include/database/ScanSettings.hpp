@@ -19,6 +19,7 @@
 
 #pragma once
 
+#include <chrono>
 #include <unordered_set>
 
 #include <Wt/Dbo/Dbo.h>
@@ -51,6 +52,22 @@ class ScanSettings : public Wt::Dbo::Dbo<ScanSettings>
 			Features,
 		};
 
+		// Do not modify values (just add)
+		enum class ScannerPriority
+		{
+			Normal = 0,
+			Low,		// lowest CPU priority, best effort I/O priority
+			Idle,		// lowest CPU priority, I/O only when the disk is idle
+		};
+
+		static inline constexpr std::size_t defaultWriteBatchSize {100};
+		static inline constexpr std::chrono::milliseconds defaultWriteBatchMaxDuration {1000};
+		static inline constexpr ScannerPriority defaultScannerPriority {ScannerPriority::Low};
+		static inline constexpr std::size_t defaultMaxFilesPerSecond {}; // unlimited
+		static inline constexpr bool defaultBackOffWhenStreaming {true};
+		static inline constexpr bool defaultScanNewestFirst {false};
+		static inline constexpr bool defaultSkipUnchangedDirectories {false};
+
 		static void init(Session& session);
 
 		static pointer get(Session& session);
@@ -63,6 +80,13 @@ class ScanSettings : public Wt::Dbo::Dbo<ScanSettings>
 		std::vector<Wt::Dbo::ptr<ClusterType>> getClusterTypes() const;
 		std::unordered_set<std::filesystem::path> getAudioFileExtensions() const;
 		RecommendationEngineType getRecommendationEngineType() const { return _recommendationEngineType; }
+		std::size_t getWriteBatchSize() const { return _writeBatchSize; }
+		std::chrono::milliseconds getWriteBatchMaxDuration() const { return _writeBatchMaxDuration; }
+		ScannerPriority getScannerPriority() const { return _scannerPriority; }
+		std::size_t getMaxFilesPerSecond() const { return _maxFilesPerSecond; } // 0 means unlimited
+		bool getBackOffWhenStreaming() const { return _backOffWhenStreaming; }
+		bool getScanNewestFirst() const { return _scanNewestFirst; }
+		bool getSkipUnchangedDirectories() const { return _skipUnchangedDirectories; }
 
 		// Setters
 		void addAudioFileExtension(const std::filesystem::path& ext);
@@ -71,6 +95,13 @@ class ScanSettings : public Wt::Dbo::Dbo<ScanSettings>
 		void setUpdatePeriod(UpdatePeriod p) { _updatePeriod = p; }
 		void setClusterTypes(Session& session, const std::set<std::string>& clusterTypeNames);
 		void setRecommendationEngineType(RecommendationEngineType type) { _recommendationEngineType = type; }
+		void setWriteBatchSize(std::size_t size) { _writeBatchSize = static_cast<int>(size); }
+		void setWriteBatchMaxDuration(std::chrono::milliseconds duration) { _writeBatchMaxDuration = duration; }
+		void setScannerPriority(ScannerPriority priority) { _scannerPriority = priority; }
+		void setMaxFilesPerSecond(std::size_t count) { _maxFilesPerSecond = static_cast<int>(count); }
+		void setBackOffWhenStreaming(bool backOff) { _backOffWhenStreaming = backOff; }
+		void setScanNewestFirst(bool newestFirst) { _scanNewestFirst = newestFirst; }
+		void setSkipUnchangedDirectories(bool skip) { _skipUnchangedDirectories = skip; }
 		void incScanVersion();
 
 		template<class Action>
@@ -82,6 +113,13 @@ class ScanSettings : public Wt::Dbo::Dbo<ScanSettings>
 			Wt::Dbo::field(a, _updatePeriod,	"update_period");
 			Wt::Dbo::field(a, _audioFileExtensions,	"audio_file_extensions");
 			Wt::Dbo::field(a, _recommendationEngineType,"similarity_engine_type");
+			Wt::Dbo::field(a, _writeBatchSize,	"write_batch_size");
+			Wt::Dbo::field(a, _writeBatchMaxDuration,	"write_batch_max_duration");
+			Wt::Dbo::field(a, _scannerPriority,	"scanner_priority");
+			Wt::Dbo::field(a, _maxFilesPerSecond,	"max_files_per_second");
+			Wt::Dbo::field(a, _backOffWhenStreaming,	"back_off_when_streaming");
+			Wt::Dbo::field(a, _scanNewestFirst,	"scan_newest_first");
+			Wt::Dbo::field(a, _skipUnchangedDirectories,	"skip_unchanged_directories");
 			Wt::Dbo::hasMany(a, _clusterTypes, Wt::Dbo::ManyToOne, "scan_settings");
 		}
 
@@ -93,6 +131,13 @@ class ScanSettings : public Wt::Dbo::Dbo<ScanSettings>
 		UpdatePeriod	_updatePeriod {UpdatePeriod::Never};
 		RecommendationEngineType _recommendationEngineType {RecommendationEngineType::Clusters};
 		std::string	_audioFileExtensions {".alac .mp3 .ogg .oga .aac .m4a .m4b .flac .wav .wma .aif .aiff .ape .mpc .shn .opus"};
+		int		_writeBatchSize {defaultWriteBatchSize};	// number of files written in the same transaction
+		std::chrono::duration<int, std::milli>	_writeBatchMaxDuration {defaultWriteBatchMaxDuration};
+		ScannerPriority	_scannerPriority {defaultScannerPriority};
+		int		_maxFilesPerSecond {defaultMaxFilesPerSecond};
+		bool		_backOffWhenStreaming {defaultBackOffWhenStreaming};	// slow down the scan while audio is being streamed or downloaded
+		bool		_scanNewestFirst {defaultScanNewestFirst};	// scan the most recently modified directories first, new files before the others
+		bool		_skipUnchangedDirectories {defaultSkipUnchangedDirectories};	// do not stat the files of unchanged directories: tags edited in place are missed
 		Wt::Dbo::collection<Wt::Dbo::ptr<ClusterType>>	_clusterTypes;
 };
 
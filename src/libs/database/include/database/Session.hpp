@@ -28,6 +28,8 @@
 #include <Wt/Dbo/Dbo.h>
 #include <Wt/Dbo/SqlConnectionPool.h>
 
+#include "database/Db.hpp"
+
 namespace Database {
 
 class UniqueTransaction
@@ -37,10 +39,12 @@ class UniqueTransaction
 
 	private:
 		friend class Session;
-		UniqueTransaction(std::shared_mutex& mutex, Wt::Dbo::Session& session);
+		UniqueTransaction(Db& db, Wt::Dbo::Session& session);
 
-		std::unique_lock<std::shared_mutex> _lock;
-		Wt::Dbo::Transaction _transaction;
+		std::shared_mutex&			_mutex;
+		std::unique_lock<std::shared_mutex>	_lock;	// not locked if the readers are concurrent
+		Db::ScopedWriterConnection		_writerConnection;	// must be set before the transaction gets its connection
+		Wt::Dbo::Transaction			_transaction;
 };
 
 class SharedTransaction
@@ -50,13 +54,13 @@ class SharedTransaction
 
 	private:
 		friend class Session;
-		SharedTransaction(std::shared_mutex& mutex, Wt::Dbo::Session& session);
+		SharedTransaction(Db& db, Wt::Dbo::Session& session);
 
-		std::shared_lock<std::shared_mutex> _lock;
-		Wt::Dbo::Transaction _transaction;
+		std::shared_mutex&			_mutex;
+		std::shared_lock<std::shared_mutex>	_lock;	// not locked if the readers are concurrent
+		Wt::Dbo::Transaction			_transaction;
 };
 
-class Db;
 class Session
 {
 	public:
@@ -77,6 +81,8 @@ class Session
 
 		void prepareTables(); // need to run only once at startup
 
+		bool hasFullTextSearch() const; // set up by prepareTables
+
 		Wt::Dbo::Session& getDboSession() { return _session; }
 
 	private:
@@ -20,7 +20,9 @@
 #pragma once
 
 #include <chrono>
+#include <cstdint>
 #include <filesystem>
+#include <functional>
 #include <optional>
 #include <string>
 #include <unordered_set>
@@ -57,6 +59,7 @@ class Track : public Wt::Dbo::Dbo<Track>
 		// Find utility functions
 		static std::size_t getCount(Session& session);
 		static pointer getByPath(Session& session, const std::filesystem::path& p);
+		static std::vector<pointer> getByDirectory(Session& session, const std::filesystem::path& directory); // tracks in this directory and its sub directories
 		static pointer getById(Session& session, IdType id);
 		static pointer getByMBID(Session& session, const UUID& MBID);
 		static std::vector<pointer>	getSimilarTracks(Session& session,
@@ -75,7 +78,39 @@ class Track : public Wt::Dbo::Dbo<Track>
 		static std::vector<pointer>	getAllRandom(Session& session, const std::set<IdType>& clusters, std::optional<std::size_t> limit = std::nullopt);
 		static std::vector<IdType>	getAllIdsRandom(Session& session, const std::set<IdType>& clusters, std::optional<std::size_t> limit = std::nullopt);
 		static std::vector<IdType>	getAllIds(Session& session);
-		static std::vector<std::pair<IdType, std::filesystem::path>> getAllPaths(Session& session, std::optional<std::size_t> offset = std::nullopt, std::optional<std::size_t> size = std::nullopt);
+
+		// Cheap content identity of a file, used to follow moved files
+		struct FileFingerprint
+		{
+			std::uint64_t	size {};
+			std::uint64_t	contentHash {};	// hash of the first and last blocks
+
+			bool operator==(const FileFingerprint& other) const { return size == other.size && contentHash == other.contentHash; }
+			bool operator!=(const FileFingerprint& other) const { return !(*this == other); }
+		};
+
+		// Location of the embedded cover in the file
+		struct EmbeddedCover
+		{
+			std::uint64_t	offset {};
+			std::uint64_t	size {};
+			std::string	mimeType;
+			std::size_t	width {};	// 0 if unknown
+			std::size_t	height {};	// 0 if unknown
+		};
+
+		// File related info, without loading the tracks
+		struct FileInfo
+		{
+			IdType				id;
+			std::filesystem::path		path;
+			Wt::WDateTime			lastWriteTime;
+			std::size_t			scanVersion;
+			std::optional<FileFingerprint>	fingerprint;
+		};
+		static void			visitAllFileInfos(Session& session, const std::function<void(const FileInfo&)>& visitor);
+		// Bulk removal, without loading the tracks
+		static void			removeByIds(Session& session, const std::vector<IdType>& trackIds);
 		static std::vector<pointer>	getMBIDDuplicates(Session& session);
 		static std::vector<pointer>	getLastWritten(Session& session, std::optional<Wt::WDateTime> after, const std::set<IdType>& clusters, std::optional<Range> range, bool& moreResults);
 		static std::vector<pointer>	getAllWithMBIDAndMissingFeatures(Session& session);
@@ -99,10 +134,13 @@ class Track : public Wt::Dbo::Dbo<Track>
 		void setName(const std::string& name)				{ _name = std::string(name, 0, _maxNameLength); }
 		void setDuration(std::chrono::milliseconds duration)		{ _duration = duration; }
 		void setLastWriteTime(Wt::WDateTime time)			{ _fileLastWrite = time; }
+		void setPath(const std::filesystem::path& p)			{ _filePath = p.string(); }
+		void setFileFingerprint(const std::optional<FileFingerprint>& fingerprint);
 		void setAddedTime(Wt::WDateTime time)				{ _fileAdded = time; }
 		void setYear(int year)						{ _year = year; }
 		void setOriginalYear(int year)					{ _originalYear = year; }
 		void setHasCover(bool hasCover)					{ _hasCover = hasCover; }
+		void setEmbeddedCover(const std::optional<EmbeddedCover>& embeddedCover);
 		void setMBID(const std::optional<UUID>& MBID)			{ _MBID = MBID ? MBID->getAsString() : ""; }
 		void setCopyright(const std::string& copyright)			{ _copyright = std::string(copyright, 0, _maxCopyrightLength); }
 		void setCopyrightURL(const std::string& copyrightURL)		{ _copyrightURL = std::string(copyrightURL, 0, _maxCopyrightURLLength); }
@@ -126,8 +164,10 @@ class Track : public Wt::Dbo::Dbo<Track>
 		std::optional<int>			getYear() const;
 		std::optional<int>			getOriginalYear() const;
 		Wt::WDateTime				getLastWriteTime() const	{ return _fileLastWrite; }
+		std::optional<FileFingerprint>		getFileFingerprint() const;
 		Wt::WDateTime				getAddedTime() const		{ return _fileAdded; }
 		bool					hasCover() const		{ return _hasCover; }
+		std::optional<EmbeddedCover>		getEmbeddedCover() const;
 		std::optional<UUID>			getMBID() const			{ return UUID::fromString(_MBID); }
 		std::optional<std::string>		getCopyright() const;
 		std::optional<std::string>		getCopyrightURL() const;
@@ -160,8 +200,15 @@ class Track : public Wt::Dbo::Dbo<Track>
 				Wt::Dbo::field(a, _originalYear,	"original_year");
 				Wt::Dbo::field(a, _filePath,		"file_path");
 				Wt::Dbo::field(a, _fileLastWrite,	"file_last_write");
+				Wt::Dbo::field(a, _fileSize,		"file_size");
+				Wt::Dbo::field(a, _fileContentHash,	"file_content_hash");
 				Wt::Dbo::field(a, _fileAdded,		"file_added");
 				Wt::Dbo::field(a, _hasCover,		"has_cover");
+				Wt::Dbo::field(a, _coverOffset,		"cover_offset");
+				Wt::Dbo::field(a, _coverSize,		"cover_size");
+				Wt::Dbo::field(a, _coverMimeType,	"cover_mime_type");
+				Wt::Dbo::field(a, _coverWidth,		"cover_width");
+				Wt::Dbo::field(a, _coverHeight,		"cover_height");
 				Wt::Dbo::field(a, _MBID,		"mbid");
 				Wt::Dbo::field(a, _copyright,		"copyright");
 				Wt::Dbo::field(a, _copyrightURL,	"copyright_url");
@@ -195,8 +242,15 @@ class Track : public Wt::Dbo::Dbo<Track>
 		int					_originalYear {};
 		std::string				_filePath;
 		Wt::WDateTime				_fileLastWrite;
+		long long				_fileSize {};
+		std::optional<long long>		_fileContentHash;	// not set if the fingerprint is unknown
 		Wt::WDateTime				_fileAdded;
 		bool					_hasCover {};
+		std::optional<long long>		_coverOffset;	// not set if the embedded cover location is unknown
+		long long				_coverSize {};
+		std::string				_coverMimeType;
+		int					_coverWidth {};
+		int					_coverHeight {};
 		std::string				_MBID; // Musicbrainz Identifier
 		std::string				_copyright;
 		std::string				_copyrightURL;
@@ -19,6 +19,8 @@
 
 #pragma once
 
+#include <optional>
+
 #include <Wt/Dbo/ptr.h>
 
 namespace Database
@@ -34,6 +36,9 @@ namespace Database
 	{
 		std::size_t offset {};
 		std::size_t limit {};
+		// Last entry of the previous range, if known
+		// Queries sorted on a unique key then start right after it instead of skipping offset entries
+		std::optional<IdType> after {};
 	};
 }
 
@@ -0,0 +1,146 @@
+/*
+ * Copyright (C) 2020 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "NativeReaders.hpp"
+
+#include <algorithm>
+
+namespace MetaData
+{
+
+FileReader::FileReader(const std::filesystem::path& p)
+: _is {p, std::ios_base::binary}
+{
+	if (!_is)
+		throw NativeReaderFallbackException {"cannot open file"};
+
+	std::error_code ec;
+	_size = std::filesystem::file_size(p, ec);
+	if (ec)
+		throw NativeReaderFallbackException {"cannot get file size: " + ec.message()};
+
+	_head.resize(static_cast<std::size_t>(std::min<std::uint64_t>(_size, headSize)));
+	_is.read(_head.data(), _head.size());
+	if (!_is || static_cast<std::size_t>(_is.gcount()) != _head.size())
+		throw NativeReaderFallbackException {"cannot read file"};
+}
+
+std::string_view
+FileReader::read(std::uint64_t offset, std::size_t size)
+{
+	if (offset > _size || size > _size - offset)
+		throw NativeReaderFallbackException {"unexpected end of file"};
+
+	if (offset + size <= _head.size())
+		return std::string_view {_head}.substr(offset, size);
+
+	if (size > maxReadSize)
+		throw NativeReaderFallbackException {"block too large"};
+
+	_buffer.resize(size);
+	_is.seekg(offset);
+	_is.read(_buffer.data(), size);
+	if (!_is || static_cast<std::size_t>(_is.gcount()) != size)
+		throw NativeReaderFallbackException {"cannot read file"};
+
+	return _buffer;
+}
+
+std::uint8_t
+ByteReader::readU8()
+{
+	return static_cast<std::uint8_t>(readBytes(1)[0]);
+}
+
+std::uint16_t
+ByteReader::readU16LE()
+{
+	const std::string_view bytes {readBytes(2)};
+	return static_cast<std::uint8_t>(bytes[0]) | (static_cast<std::uint8_t>(bytes[1]) << 8);
+}
+
+std::uint32_t
+ByteReader::readU24BE()
+{
+	const std::string_view bytes {readBytes(3)};
+
+	std::uint32_t res {};
+	for (char byte : bytes)
+		res = (res << 8) | static_cast<std::uint8_t>(byte);
+
+	return res;
+}
+
+std::uint32_t
+ByteReader::readU32BE()
+{
+	const std::string_view bytes {readBytes(4)};
+
+	std::uint32_t res {};
+	for (char byte : bytes)
+		res = (res << 8) | static_cast<std::uint8_t>(byte);
+
+	return res;
+}
+
+std::uint32_t
+ByteReader::readU32LE()
+{
+	const std::string_view bytes {readBytes(4)};
+
+	std::uint32_t res {};
+	for (std::size_t i {}; i < bytes.size(); ++i)
+		res |= static_cast<std::uint32_t>(static_cast<std::uint8_t>(bytes[i])) << (i * 8);
+
+	return res;
+}
+
+std::uint64_t
+ByteReader::readU64LE()
+{
+	const std::string_view bytes {readBytes(8)};
+
+	std::uint64_t res {};
+	for (std::size_t i {}; i < bytes.size(); ++i)
+		res |= static_cast<std::uint64_t>(static_cast<std::uint8_t>(bytes[i])) << (i * 8);
+
+	return res;
+}
+
+std::string_view
+ByteReader::readBytes(std::size_t size)
+{
+	if (size > getRemainingSize())
+		throw NativeReaderFallbackException {"truncated data"};
+
+	const std::string_view res {_data.substr(_offset, size)};
+	_offset += size;
+
+	return res;
+}
+
+void
+ByteReader::skip(std::size_t size)
+{
+	readBytes(size);
+}
+
+} // namespace MetaData
+
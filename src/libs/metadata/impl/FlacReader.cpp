@@ -0,0 +1,165 @@
+/*
+ * Copyright (C) 2020 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "NativeReaders.hpp"
+
+#include <algorithm>
+
+namespace MetaData
+{
+
+namespace
+{
+
+enum class FlacBlockType : std::uint8_t
+{
+	StreamInfo = 0,
+	Padding = 1,
+	SeekTable = 3,
+	VorbisComment = 4,
+	Picture = 6,
+};
+
+constexpr std::uint8_t lastBlockFlag {0x80};
+
+// The picture data is not read, only its header
+EmbeddedCover
+readFlacPictureLocation(FileReader& reader, std::uint64_t offset, std::uint32_t blockLength)
+{
+	const std::uint64_t blockEnd {offset + blockLength};
+
+	ByteReader typeReader {reader.read(offset, 8)};
+	typeReader.skip(4); // picture type
+	const std::uint32_t mimeTypeLength {typeReader.readU32BE()};
+	offset += 8;
+
+	EmbeddedCover cover;
+
+	ByteReader mimeTypeReader {reader.read(offset, std::size_t {mimeTypeLength} + 4)};
+	cover.mimeType = mimeTypeReader.readBytes(mimeTypeLength);
+	const std::uint32_t descriptionLength {mimeTypeReader.readU32BE()};
+	offset += mimeTypeLength + 4 + descriptionLength;
+
+	ByteReader propertiesReader {reader.read(offset, 20)};
+	cover.width = propertiesReader.readU32BE();
+	cover.height = propertiesReader.readU32BE();
+	propertiesReader.skip(8); // color depth, number of colors
+	cover.size = propertiesReader.readU32BE();
+	cover.offset = offset + 20;
+
+	if (cover.offset + cover.size > blockEnd)
+		throw NativeReaderFallbackException {"bad FLAC picture block"};
+
+	return cover;
+}
+
+} // namespace
+
+NativeFileInfo
+readFlacFile(FileReader& reader)
+{
+	// TagLib also handles ID3v2 tags before the stream
+	if (reader.read(0, 4) != "fLaC")
+		throw NativeReaderFallbackException {"FLAC stream not found at the start of the file"};
+
+	NativeFileInfo info;
+
+	std::uint64_t offset {4};
+	bool hasStreamInfo {};
+	bool hasXiphComment {};
+	std::uint32_t sampleRate {};
+	std::uint64_t sampleCount {};
+
+	while (true)
+	{
+		ByteReader headerReader {reader.read(offset, 4)};
+		const std::uint8_t blockHeader {headerReader.readU8()};
+		const FlacBlockType blockType {static_cast<FlacBlockType>(blockHeader & ~lastBlockFlag)};
+		const std::uint32_t blockLength {headerReader.readU24BE()};
+		offset += 4;
+
+		if (!hasStreamInfo && blockType != FlacBlockType::StreamInfo)
+			throw NativeReaderFallbackException {"first FLAC block is not STREAMINFO"};
+
+		if (blockLength == 0 && blockType != FlacBlockType::Padding && blockType != FlacBlockType::SeekTable)
+			throw NativeReaderFallbackException {"zero-sized FLAC block"};
+
+		switch (blockType)
+		{
+			case FlacBlockType::StreamInfo:
+			{
+				if (hasStreamInfo)
+					break;
+
+				ByteReader blockReader {reader.read(offset, blockLength)};
+				blockReader.skip(10); // block sizes, frame sizes
+
+				const std::uint32_t flags {blockReader.readU32BE()};
+				sampleRate = flags >> 12;
+				sampleCount = (static_cast<std::uint64_t>(flags & 0x0F) << 32) | blockReader.readU32BE();
+				hasStreamInfo = true;
+				break;
+			}
+
+			case FlacBlockType::VorbisComment:
+				// Only the first one is used, as TagLib does
+				if (!hasXiphComment)
+				{
+					bool hasPicture {}; // pictures only come from the PICTURE blocks
+					readXiphComment(reader.read(offset, blockLength), info.tags, hasPicture);
+					hasXiphComment = true;
+				}
+				break;
+
+			case FlacBlockType::Picture:
+				info.hasCover = true;
+				if (!info.cover)
+					info.cover = readFlacPictureLocation(reader, offset, blockLength);
+				break;
+
+			default:
+				break;
+		}
+
+		offset += blockLength;
+
+		if (blockHeader & lastBlockFlag)
+			break;
+	}
+
+	// TagLib would use the other tags (ID3v1, ID3v2)
+	if (info.tags.empty())
+		throw NativeReaderFallbackException {"no Vorbis comment"};
+
+	if (sampleCount > 0 && sampleRate > 0)
+	{
+		const double length {sampleCount * 1000.0 / sampleRate};
+		// Stream starts right after the metadata, any ID3v1 tag at the end is ignored (less than 1 kbps of error)
+		const std::uint64_t streamLength {reader.getSize() - std::min(offset, reader.getSize())};
+
+		info.length = std::chrono::milliseconds {static_cast<int>(length + 0.5)};
+		info.bitrate = static_cast<unsigned>(streamLength * 8.0 / length + 0.5);
+	}
+
+	return info;
+}
+
+} // namespace MetaData
+
@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2020 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "NativeReaders.hpp"
+
+namespace MetaData
+{
+
+namespace
+{
+
+std::optional<std::pair<std::size_t, std::size_t>>
+readPngDimensions(std::string_view data)
+{
+	// Signature, then the IHDR chunk
+	ByteReader reader {data};
+	reader.skip(8);
+	reader.skip(4); // chunk length
+	if (reader.readBytes(4) != "IHDR")
+		return std::nullopt;
+
+	const std::size_t width {reader.readU32BE()};
+	const std::size_t height {reader.readU32BE()};
+
+	return std::make_pair(width, height);
+}
+
+std::optional<std::pair<std::size_t, std::size_t>>
+readJpegDimensions(std::string_view data)
+{
+	ByteReader reader {data};
+	reader.skip(2); // SOI
+
+	while (true)
+	{
+		if (reader.readU8() != 0xFF)
+			return std::nullopt;
+
+		std::uint8_t marker {reader.readU8()};
+		while (marker == 0xFF) // fill bytes
+			marker = reader.readU8();
+
+		// Standalone markers
+		if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD8))
+			continue;
+
+		const std::uint8_t lengthHigh {reader.readU8()};
+		const std::size_t length {static_cast<std::size_t>(lengthHigh << 8) | reader.readU8()};
+		if (length < 2)
+			return std::nullopt;
+
+		// Start of frame, except DHT, JPG and DAC
+		if (marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC)
+		{
+			reader.skip(1); // precision
+			const std::uint8_t heightHigh {reader.readU8()};
+			const std::size_t height {static_cast<std::size_t>(heightHigh << 8) | reader.readU8()};
+			const std::uint8_t widthHigh {reader.readU8()};
+			const std::size_t width {static_cast<std::size_t>(widthHigh << 8) | reader.readU8()};
+
+			return std::make_pair(width, height);
+		}
+
+		reader.skip(length - 2);
+	}
+}
+
+} // namespace
+
+std::optional<std::pair<std::size_t, std::size_t>>
+readImageDimensions(std::string_view data)
+{
+	try
+	{
+		if (data.substr(0, 8) == "\x89PNG\r\n\x1a\n")
+			return readPngDimensions(data);
+
+		if (data.substr(0, 2) == "\xFF\xD8")
+			return readJpegDimensions(data);
+	}
+	catch (const NativeReaderFallbackException&)
+	{
+		// truncated image
+	}
+
+	return std::nullopt;
+}
+
+} // namespace MetaData
+
@@ -0,0 +1,915 @@
+/*
+ * Copyright (C) 2020 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "NativeReaders.hpp"
+
+#include <algorithm>
+#include <array>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "utils/String.hpp"
+
+// Only handles files starting with an ID3v2.3 or ID3v2.4 tag, the most common layout
+// Frames are interpreted the way TagLib does, so that both readers give the same tags
+namespace MetaData
+{
+
+namespace
+{
+
+constexpr std::size_t id3v2HeaderSize {10};
+constexpr std::size_t id3v2FrameHeaderSize {10};
+constexpr std::size_t id3v1Size {128};
+constexpr std::size_t apeFooterSize {32};
+
+// The first MPEG frame is expected to be close to the ID3v2 tag
+constexpr std::size_t mpegFrameSearchSize {65536};
+
+// ID3v2 frame ids, as translated by TagLib
+constexpr std::array<std::pair<std::string_view, std::string_view>, 59> frameIdKeys
+{{
+	{"TALB", "ALBUM"},
+	{"TBPM", "BPM"},
+	{"TCMP", "COMPILATION"},
+	{"TCOM", "COMPOSER"},
+	{"TCON", "GENRE"},
+	{"TCOP", "COPYRIGHT"},
+	{"TDEN", "ENCODINGTIME"},
+	{"TDLY", "PLAYLISTDELAY"},
+	{"TDOR", "ORIGINALDATE"},
+	{"TDRC", "DATE"},
+	{"TDRL", "RELEASEDATE"},
+	{"TDTG", "TAGGINGDATE"},
+	{"TENC", "ENCODEDBY"},
+	{"TEXT", "LYRICIST"},
+	{"TFLT", "FILETYPE"},
+	{"TIT1", "CONTENTGROUP"},
+	{"TIT2", "TITLE"},
+	{"TIT3", "SUBTITLE"},
+	{"TKEY", "INITIALKEY"},
+	{"TLAN", "LANGUAGE"},
+	{"TLEN", "LENGTH"},
+	{"TMED", "MEDIA"},
+	{"TMOO", "MOOD"},
+	{"TOAL", "ORIGINALALBUM"},
+	{"TOFN", "ORIGINALFILENAME"},
+	{"TOLY", "ORIGINALLYRICIST"},
+	{"TOPE", "ORIGINALARTIST"},
+	{"TOWN", "OWNER"},
+	{"TPE1", "ARTIST"},
+	{"TPE2", "ALBUMARTIST"},
+	{"TPE3", "CONDUCTOR"},
+	{"TPE4", "REMIXER"},
+	{"TPOS", "DISCNUMBER"},
+	{"TPRO", "PRODUCEDNOTICE"},
+	{"TPUB", "LABEL"},
+	{"TRCK", "TRACKNUMBER"},
+	{"TRSN", "RADIOSTATION"},
+	{"TRSO", "RADIOSTATIONOWNER"},
+	{"TSOA", "ALBUMSORT"},
+	{"TSOP", "ARTISTSORT"},
+	{"TSOT", "TITLESORT"},
+	{"TSO2", "ALBUMARTISTSORT"},
+	{"TSRC", "ISRC"},
+	{"TSSE", "ENCODING"},
+	{"TSST", "DISCSUBTITLE"},
+	{"WCOP", "COPYRIGHTURL"},
+	{"WOAF", "FILEWEBPAGE"},
+	{"WOAR", "ARTISTWEBPAGE"},
+	{"WOAS", "AUDIOSOURCEWEBPAGE"},
+	{"WORS", "RADIOSTATIONWEBPAGE"},
+	{"WPAY", "PAYMENTWEBPAGE"},
+	{"WPUB", "PUBLISHERWEBPAGE"},
+	{"TCAT", "PODCASTCATEGORY"},
+	{"TDES", "PODCASTDESC"},
+	{"TGID", "PODCASTID"},
+	{"WFED", "PODCASTURL"},
+	{"MVNM", "MOVEMENTNAME"},
+	{"MVIN", "MOVEMENTNUMBER"},
+	{"GRP1", "GROUPING"},
+}};
+
+// TXXX descriptions, as translated by TagLib
+constexpr std::array<std::pair<std::string_view, std::string_view>, 12> userTextKeys
+{{
+	{"MUSICBRAINZ ALBUM ID", "MUSICBRAINZ_ALBUMID"},
+	{"MUSICBRAINZ ARTIST ID", "MUSICBRAINZ_ARTISTID"},
+	{"MUSICBRAINZ ALBUM ARTIST ID", "MUSICBRAINZ_ALBUMARTISTID"},
+	{"MUSICBRAINZ ALBUM RELEASE COUNTRY", "RELEASECOUNTRY"},
+	{"MUSICBRAINZ ALBUM STATUS", "RELEASESTATUS"},
+	{"MUSICBRAINZ ALBUM TYPE", "RELEASETYPE"},
+	{"MUSICBRAINZ RELEASE GROUP ID", "MUSICBRAINZ_RELEASEGROUPID"},
+	{"MUSICBRAINZ RELEASE TRACK ID", "MUSICBRAINZ_RELEASETRACKID"},
+	{"MUSICBRAINZ WORK ID", "MUSICBRAINZ_WORKID"},
+	{"ACOUSTID ID", "ACOUSTID_ID"},
+	{"ACOUSTID FINGERPRINT", "ACOUSTID_FINGERPRINT"},
+	{"MUSICIP PUID", "MUSICIP_PUID"},
+}};
+
+enum class TextEncoding
+{
+	Latin1 = 0,
+	UTF16 = 1,	// with BOM
+	UTF16BE = 2,
+	UTF8 = 3,
+};
+
+std::uint8_t
+byteAt(std::string_view data, std::size_t offset)
+{
+	return static_cast<std::uint8_t>(data[offset]);
+}
+
+std::uint32_t
+readU32BE(std::string_view data, std::size_t offset)
+{
+	ByteReader reader {data.substr(offset)};
+	return reader.readU32BE();
+}
+
+// Some taggers write plain integers instead of sync safe ones: read them as such, as TagLib does
+std::uint32_t
+readSyncSafeU32(std::string_view data, std::size_t offset)
+{
+	const std::string_view bytes {data.substr(offset, 4)};
+	if (bytes.size() != 4)
+		throw NativeReaderFallbackException {"truncated ID3v2 data"};
+
+	std::uint32_t res {};
+	for (char byte : bytes)
+	{
+		if (static_cast<std::uint8_t>(byte) & 0x80)
+			return readU32BE(bytes, 0);
+
+		res = (res << 7) | static_cast<std::uint8_t>(byte);
+	}
+
+	return res;
+}
+
+std::string
+toUpperASCII(std::string_view str)
+{
+	std::string res {str};
+	for (char& c : res)
+	{
+		if (c >= 'a' && c <= 'z')
+			c = c - 'a' + 'A';
+	}
+
+	return res;
+}
+
+void
+appendUTF8(std::string& str, char32_t codePoint)
+{
+	if (codePoint < 0x80)
+		str += static_cast<char>(codePoint);
+	else if (codePoint < 0x800)
+	{
+		str += static_cast<char>(0xC0 | (codePoint >> 6));
+		str += static_cast<char>(0x80 | (codePoint & 0x3F));
+	}
+	else if (codePoint < 0x10000)
+	{
+		str += static_cast<char>(0xE0 | (codePoint >> 12));
+		str += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+		str += static_cast<char>(0x80 | (codePoint & 0x3F));
+	}
+	else
+	{
+		str += static_cast<char>(0xF0 | (codePoint >> 18));
+		str += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+		str += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+		str += static_cast<char>(0x80 | (codePoint & 0x3F));
+	}
+}
+
+std::string
+decodeLatin1(std::string_view data)
+{
+	data = data.substr(0, data.find('\0'));
+
+	std::string res;
+	res.reserve(data.size());
+	for (char c : data)
+		appendUTF8(res, static_cast<std::uint8_t>(c));
+
+	return res;
+}
+
+std::string
+decodeUTF16(std::string_view data, bool bigEndian)
+{
+	std::string res;
+	res.reserve(data.size() / 2);
+
+	char32_t highSurrogate {};
+	for (std::size_t i {}; i + 1 < data.size(); i += 2)
+	{
+		const char32_t codeUnit {bigEndian ? static_cast<char32_t>((byteAt(data, i) << 8) | byteAt(data, i + 1)) : static_cast<char32_t>((byteAt(data, i + 1) << 8) | byteAt(data, i))};
+		if (codeUnit == 0)
+			break;
+
+		if (codeUnit >= 0xD800 && codeUnit < 0xDC00)
+		{
+			if (highSurrogate)
+				appendUTF8(res, 0xFFFD);
+			highSurrogate = codeUnit;
+			continue;
+		}
+
+		if (codeUnit >= 0xDC00 && codeUnit < 0xE000)
+		{
+			appendUTF8(res, highSurrogate ? 0x10000 + ((highSurrogate - 0xD800) << 10) + (codeUnit - 0xDC00) : 0xFFFD);
+			highSurrogate = 0;
+			continue;
+		}
+
+		if (highSurrogate)
+		{
+			appendUTF8(res, 0xFFFD);
+			highSurrogate = 0;
+		}
+		appendUTF8(res, codeUnit);
+	}
+
+	if (highSurrogate)
+		appendUTF8(res, 0xFFFD);
+
+	return res;
+}
+
+// As TagLib, the string stops at the first null character
+std::string
+decodeText(std::string_view data, TextEncoding encoding)
+{
+	switch (encoding)
+	{
+		case TextEncoding::Latin1:
+			return decodeLatin1(data);
+
+		case TextEncoding::UTF8:
+			return std::string {data.substr(0, data.find('\0'))};
+
+		case TextEncoding::UTF16:
+			// TagLib gives an empty string if there is no BOM
+			if (data.size() >= 2 && byteAt(data, 0) == 0xFF && byteAt(data, 1) == 0xFE)
+				return decodeUTF16(data.substr(2), false);
+			if (data.size() >= 2 && byteAt(data, 0) == 0xFE && byteAt(data, 1) == 0xFF)
+				return decodeUTF16(data.substr(2), true);
+			return {};
+
+		case TextEncoding::UTF16BE:
+			return decodeUTF16(data, true);
+	}
+
+	return {};
+}
+
+TextEncoding
+getTextEncoding(std::string_view data)
+{
+	const std::uint8_t encoding {byteAt(data, 0)};
+	if (encoding > static_cast<std::uint8_t>(TextEncoding::UTF8))
+		throw NativeReaderFallbackException {"bad ID3v2 text encoding"};
+
+	return static_cast<TextEncoding>(encoding);
+}
+
+std::size_t
+getCharSize(TextEncoding encoding)
+{
+	return (encoding == TextEncoding::Latin1 || encoding == TextEncoding::UTF8) ? 1 : 2;
+}
+
+// Splits on null characters, as TagLib's ByteVectorList::split does (maxCount = 0 means no limit)
+std::vector<std::string_view>
+splitText(std::string_view data, TextEncoding encoding, std::size_t maxCount = 0)
+{
+	const std::size_t charSize {getCharSize(encoding)};
+
+	auto findDelimiter {[&](std::size_t offset)
+	{
+		for (std::size_t i {offset}; i + charSize <= data.size(); i += charSize)
+		{
+			if (data[i] == '\0' && (charSize == 1 || data[i + 1] == '\0'))
+				return i;
+		}
+		return std::string_view::npos;
+	}};
+
+	std::vector<std::string_view> res;
+
+	std::size_t previousOffset {};
+	for (std::size_t offset {findDelimiter(0)}; offset != std::string_view::npos && (maxCount == 0 || maxCount > res.size() + 1); offset = findDelimiter(offset + charSize))
+	{
+		res.push_back(data.substr(previousOffset, offset - previousOffset));
+		previousOffset = offset + charSize;
+	}
+
+	if (previousOffset < data.size())
+		res.push_back(data.substr(previousOffset));
+
+	return res;
+}
+
+// Text information frame fields, without the empty ones
+std::vector<std::string>
+parseTextFields(std::string_view data)
+{
+	if (data.size() < 2)
+		return {};
+
+	const TextEncoding encoding {getTextEncoding(data)};
+	const std::size_t charSize {getCharSize(encoding)};
+
+	// Strip the nulls at the end, keeping the alignment
+	std::size_t dataLength {data.size() - 1};
+	while (dataLength > 0 && data[dataLength] == '\0')
+		dataLength--;
+	while (dataLength % charSize != 0)
+		dataLength++;
+
+	std::vector<std::string> fields;
+	for (std::string_view field : splitText(data.substr(1, dataLength), encoding))
+	{
+		if (!field.empty())
+			fields.emplace_back(decodeText(field, encoding));
+	}
+
+	return fields;
+}
+
+// Description and text of comments, lyrics and user URL frames
+std::pair<std::string, std::string>
+parseDescribedText(std::string_view data, bool hasLanguage)
+{
+	if (data.size() < (hasLanguage ? 5 : 2))
+		return {};
+
+	const TextEncoding encoding {getTextEncoding(data)};
+	const std::vector<std::string_view> fields {splitText(data.substr(hasLanguage ? 4 : 1), encoding, 2)};
+	if (fields.size() != 2)
+		return {};
+
+	// URLs are always Latin1
+	return {decodeText(fields.front(), encoding), hasLanguage ? decodeText(fields.back(), encoding) : decodeLatin1(fields.back())};
+}
+
+std::string
+getFrameKey(std::string_view frameId)
+{
+	const auto it {std::find_if(std::cbegin(frameIdKeys), std::cend(frameIdKeys), [&](const auto& frameIdKey) { return frameIdKey.first == frameId; })};
+	return it != std::cend(frameIdKeys) ? std::string {it->second} : std::string {};
+}
+
+std::string
+getUserTextKey(std::string_view description)
+{
+	std::string key {toUpperASCII(description)};
+
+	const auto it {std::find_if(std::cbegin(userTextKeys), std::cend(userTextKeys), [&](const auto& userTextKey) { return userTextKey.first == key; })};
+	return it != std::cend(userTextKeys) ? std::string {it->second} : key;
+}
+
+// TagLib converts ID3v1 genre numbers
+bool
+isGenreReference(const std::string& value)
+{
+	if (value.empty())
+		return false;
+
+	if (value.front() == '(')
+		return true;
+
+	std::size_t i {value.find_first_not_of(" \t")};
+	if (i != std::string::npos && (value[i] == '-' || value[i] == '+'))
+		i++;
+
+	return i < value.size() && std::all_of(std::cbegin(value) + i, std::cend(value), [](char c) { return c >= '0' && c <= '9'; });
+}
+
+bool
+isValidFrameId(std::string_view frameId)
+{
+	return frameId.size() == 4 && std::all_of(std::cbegin(frameId), std::cend(frameId), [](char c) { return (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9'); });
+}
+
+// Attached picture frame: encoding, MIME type, picture type, description and picture data
+std::optional<EmbeddedCover>
+parseAttachedPictureLocation(std::string_view data, std::uint64_t dataOffset)
+{
+	if (data.size() < 2)
+		return std::nullopt;
+
+	const TextEncoding encoding {getTextEncoding(data)};
+
+	const std::size_t mimeTypeEnd {data.find('\0', 1)};
+	if (mimeTypeEnd == std::string_view::npos || mimeTypeEnd + 2 >= data.size())
+		return std::nullopt;
+
+	const std::vector<std::string_view> fields {splitText(data.substr(mimeTypeEnd + 2), encoding, 2)};
+	if (fields.size() != 2)
+		return std::nullopt;
+
+	EmbeddedCover cover;
+	cover.mimeType = decodeLatin1(data.substr(1, mimeTypeEnd - 1));
+	cover.offset = dataOffset + (data.size() - fields.back().size());
+	cover.size = fields.back().size();
+
+	// Linked picture
+	if (cover.mimeType == "-->")
+		return std::nullopt;
+
+	if (const auto dimensions {readImageDimensions(fields.back())})
+	{
+		cover.width = dimensions->first;
+		cover.height = dimensions->second;
+	}
+
+	return cover;
+}
+
+// Date frames of ID3v2.3 tags, merged into a single date by TagLib
+struct Id3v23DateFrames
+{
+	std::size_t	yearFrameCount {};
+	std::size_t	dateFrameCount {};
+	std::string	date;	// DDMM
+	std::size_t	timeFrameCount {};
+	std::string	time;	// HHMM
+};
+
+void
+processFrame(NativeFileInfo& info, std::string_view frameId, std::string_view data, std::uint64_t dataOffset, Id3v23DateFrames& dateFrames)
+{
+	if (frameId == "APIC")
+	{
+		info.hasCover = true;
+		if (!info.cover)
+			info.cover = parseAttachedPictureLocation(data, dataOffset);
+	}
+	else if (frameId == "TXXX")
+	{
+		const std::vector<std::string> fields {parseTextFields(data)};
+		if (fields.size() < 2)
+			return;
+
+		std::vector<std::string>& values {info.tags[getUserTextKey(fields.front())]};
+		values.insert(std::end(values), std::next(std::cbegin(fields)), std::cend(fields));
+	}
+	else if (frameId == "TIPL" || frameId == "TMCL")
+		throw NativeReaderFallbackException {"unhandled ID3v2 involved people frame"};
+	else if (frameId.front() == 'T' || frameId == "WFED" || frameId == "MVNM" || frameId == "MVIN" || frameId == "GRP1")
+	{
+		const std::string key {getFrameKey(frameId)};
+		if (key.empty())
+			return;
+
+		std::vector<std::string> fields {parseTextFields(data)};
+		if (key == "GENRE")
+		{
+			if (std::any_of(std::cbegin(fields), std::cend(fields), isGenreReference))
+				throw NativeReaderFallbackException {"ID3v1 genre reference"};
+		}
+		else if (key == "DATE")
+		{
+			// ISO 8601 separator between date and time
+			for (std::string& field : fields)
+			{
+				const std::size_t separator {field.find('T')};
+				if (separator != std::string::npos)
+					field[separator] = ' ';
+			}
+			dateFrames.yearFrameCount++;
+		}
+
+		std::vector<std::string>& values {info.tags[key]};
+		values.insert(std::end(values), std::make_move_iterator(std::begin(fields)), std::make_move_iterator(std::end(fields)));
+	}
+	else if (frameId == "WXXX")
+	{
+		const auto [description, url] {parseDescribedText(data, false)};
+		const std::string key {toUpperASCII(description)};
+		info.tags[(key.empty() || key == "URL") ? "URL" : "URL:" + key].push_back(url);
+	}
+	else if (frameId.front() == 'W')
+	{
+		const std::string key {getFrameKey(frameId)};
+		if (!key.empty())
+			info.tags[key].push_back(decodeLatin1(data));
+	}
+	else if (frameId == "COMM" || frameId == "USLT")
+	{
+		const std::string defaultKey {frameId == "COMM" ? "COMMENT" : "LYRICS"};
+
+		const auto [description, text] {parseDescribedText(data, true)};
+		const std::string key {toUpperASCII(description)};
+		info.tags[(key.empty() || key == defaultKey) ? defaultKey : defaultKey + ":" + key].push_back(text);
+	}
+	else if (frameId == "UFID")
+	{
+		const std::vector<std::string_view> fields {splitText(data, TextEncoding::Latin1)};
+		if (fields.size() == 2 && fields.front() == "http://musicbrainz.org")
+			info.tags["MUSICBRAINZ_TRACKID"].push_back(decodeLatin1(fields.back()));
+	}
+	else if (frameId == "TDAT" || frameId == "TIME")
+	{
+		// Only kept by TagLib to be merged into the date
+	}
+}
+
+void
+mergeId3v23DateFrames(NativeFileInfo& info, const Id3v23DateFrames& dateFrames)
+{
+	auto itDate {info.tags.find("DATE")};
+	if (dateFrames.yearFrameCount != 1 || dateFrames.dateFrameCount != 1 || itDate == std::end(info.tags) || itDate->second.size() != 1)
+		return;
+
+	std::string& date {itDate->second.front()};
+	if (date.size() != 4 || dateFrames.date.size() != 4)
+		return;
+
+	date += "-" + dateFrames.date.substr(2, 2) + "-" + dateFrames.date.substr(0, 2);
+	if (dateFrames.timeFrameCount == 1 && dateFrames.time.size() == 4)
+		date += " " + dateFrames.time.substr(0, 2) + ":" + dateFrames.time.substr(2, 2);
+}
+
+// Same as TagLib: a tag is considered empty if none of the basic fields is set
+bool
+isEmptyTag(const TagMap& tags)
+{
+	auto hasValue {[&](const std::string& key)
+	{
+		const auto it {tags.find(key)};
+		return it != std::cend(tags) && std::any_of(std::cbegin(it->second), std::cend(it->second), [](const std::string& value) { return !value.empty(); });
+	}};
+
+	auto hasNumber {[&](const std::string& key, std::size_t maxLength)
+	{
+		const auto it {tags.find(key)};
+		if (it == std::cend(tags) || it->second.empty())
+			return false;
+
+		const std::optional<int> number {StringUtils::readAs<int>(it->second.front().substr(0, maxLength))};
+		return number && *number != 0;
+	}};
+
+	if (hasValue("TITLE") || hasValue("ARTIST") || hasValue("ALBUM") || hasValue("GENRE") || hasNumber("DATE", 4) || hasNumber("TRACKNUMBER", std::string::npos))
+		return false;
+
+	return std::none_of(tags.lower_bound("COMMENT"), std::cend(tags), [](const auto& tag)
+	{
+		return tag.first.compare(0, 7, "COMMENT") == 0 && std::any_of(std::cbegin(tag.second), std::cend(tag.second), [](const std::string& value) { return !value.empty(); });
+	});
+}
+
+// Returns the size of the tag, including its header and footer
+std::uint64_t
+readId3v2Tag(FileReader& reader, NativeFileInfo& info)
+{
+	const std::string_view header {reader.read(0, id3v2HeaderSize)};
+	if (header.substr(0, 3) != "ID3")
+		throw NativeReaderFallbackException {"no ID3v2 tag at the start of the file"};
+
+	const std::uint8_t majorVersion {byteAt(header, 3)};
+	const std::uint8_t flags {byteAt(header, 5)};
+	if (majorVersion != 3 && majorVersion != 4)
+		throw NativeReaderFallbackException {"unhandled ID3v2 version"};
+
+	if (std::any_of(std::cbegin(header) + 6, std::cend(header), [](char c) { return static_cast<std::uint8_t>(c) & 0x80; }))
+		throw NativeReaderFallbackException {"bad ID3v2 tag size"};
+
+	constexpr std::uint8_t unsynchronisationFlag {0x80};
+	constexpr std::uint8_t extendedHeaderFlag {0x40};
+	constexpr std::uint8_t footerFlag {0x10};
+
+	if (flags & unsynchronisationFlag)
+		throw NativeReaderFallbackException {"unsynchronised ID3v2 tag"};
+
+	const std::uint32_t tagSize {readSyncSafeU32(header, 6)};
+	const bool hasFooter {majorVersion == 4 && (flags & footerFlag)};
+
+	const std::string_view data {reader.read(id3v2HeaderSize, tagSize)};
+
+	std::size_t frameDataPosition {};
+	std::size_t frameDataLength {data.size()};
+
+	if (flags & extendedHeaderFlag)
+	{
+		if (majorVersion == 3)
+			throw NativeReaderFallbackException {"unhandled ID3v2.3 extended header"};
+
+		const std::uint32_t extendedHeaderSize {readSyncSafeU32(data, 0)};
+		if (extendedHeaderSize <= data.size())
+		{
+			// Same accounting as TagLib
+			frameDataPosition += extendedHeaderSize;
+			frameDataLength -= extendedHeaderSize;
+		}
+	}
+
+	if (hasFooter && frameDataLength >= id3v2HeaderSize)
+		frameDataLength -= id3v2HeaderSize;
+
+	Id3v23DateFrames dateFrames;
+
+	while (frameDataLength > id3v2FrameHeaderSize && frameDataPosition < frameDataLength - id3v2FrameHeaderSize)
+	{
+		// Padding
+		if (data[frameDataPosition] == '\0')
+			break;
+
+		const std::string_view frame {data.substr(frameDataPosition)};
+		if (frame.size() < id3v2FrameHeaderSize)
+			break;
+
+		std::string_view frameId {frame.substr(0, 4)};
+		std::uint32_t frameSize {majorVersion == 4 ? readSyncSafeU32(frame, 4) : readU32BE(frame, 4)};
+
+		// iTunes writes ID3v2.4 tags with ID3v2.3 frame sizes
+		if (majorVersion == 4 && frameSize > 127 && !isValidFrameId(frame.substr(std::min<std::size_t>(frame.size(), frameSize + id3v2FrameHeaderSize), 4)))
+		{
+			const std::uint32_t plainFrameSize {readU32BE(frame, 4)};
+			if (isValidFrameId(frame.substr(std::min<std::size_t>(frame.size(), plainFrameSize + id3v2FrameHeaderSize), 4)))
+				frameSize = plainFrameSize;
+		}
+
+		if (majorVersion == 3 && frameId[3] == '\0')
+			throw NativeReaderFallbackException {"ID3v2.2 frames in an ID3v2.3 tag"};
+
+		const std::uint8_t formatFlags {byteAt(frame, 9)};
+		const bool hasDataLengthIndicator {majorVersion == 4 && (formatFlags & 0x01)};
+
+		// Ends the parsing, as TagLib
+		if (!isValidFrameId(frameId) || frameSize <= (hasDataLengthIndicator ? 4 : 0) || frameSize > frame.size() - id3v2FrameHeaderSize)
+			break;
+
+		if ((majorVersion == 3 && (formatFlags & 0xE0)) || (majorVersion == 4 && (formatFlags & 0x4E)))
+			throw NativeReaderFallbackException {"unhandled ID3v2 frame format (compression, encryption, grouping or unsynchronisation)"};
+
+		std::string_view frameData {frame.substr(id3v2FrameHeaderSize, frameSize)};
+		if (hasDataLengthIndicator)
+			frameData = frameData.substr(4, readSyncSafeU32(frameData, 0));
+
+		if (majorVersion == 3)
+		{
+			if (frameId == "TORY")
+				frameId = "TDOR";
+			else if (frameId == "TYER")
+				frameId = "TDRC";
+			else if (frameId == "IPLS")
+				frameId = "TIPL";
+			else if (frameId == "TDAT" && !frameData.empty())
+			{
+				dateFrames.dateFrameCount++;
+				dateFrames.date = decodeText(frameData.substr(1), getTextEncoding(frameData));
+			}
+			else if (frameId == "TIME" && !frameData.empty())
+			{
+				dateFrames.timeFrameCount++;
+				dateFrames.time = decodeText(frameData.substr(1), getTextEncoding(frameData));
+			}
+		}
+		else if (frameId == "TRDC")
+			frameId = "TDRC";
+
+		// Frame data is stored as is: no unsynchronisation
+		const std::uint64_t frameDataOffset {id3v2HeaderSize + static_cast<std::uint64_t>(frameData.data() - data.data())};
+		processFrame(info, frameId, frameData, frameDataOffset, dateFrames);
+
+		frameDataPosition += frameSize + id3v2FrameHeaderSize;
+	}
+
+	if (majorVersion == 3)
+		mergeId3v23DateFrames(info, dateFrames);
+
+	return id3v2HeaderSize + tagSize + (hasFooter ? id3v2HeaderSize : 0);
+}
+
+struct MpegFrameHeader
+{
+	unsigned	bitrate;	// kbps
+	unsigned	sampleRate;
+	unsigned	samplesPerFrame;
+	std::size_t	frameLength;
+};
+
+bool
+isFrameSync(std::string_view data, std::size_t offset)
+{
+	return byteAt(data, offset) == 0xFF && byteAt(data, offset + 1) != 0xFF && (byteAt(data, offset + 1) & 0xE0) == 0xE0;
+}
+
+std::optional<MpegFrameHeader>
+parseMpegFrameHeader(std::string_view data)
+{
+	static constexpr unsigned bitrates[2][3][16]
+	{
+		{ // Version 1
+			{0, 32, 64, 96, 128, 160, 192, 224, 256, 288, 320, 352, 384, 416, 448, 0}, // layer 1
+			{0, 32, 48, 56, 64,  80,  96,  112, 128, 160, 192, 224, 256, 320, 384, 0}, // layer 2
+			{0, 32, 40, 48, 56,  64,  80,  96,  112, 128, 160, 192, 224, 256, 320, 0}, // layer 3
+		},
+		{ // Version 2 or 2.5
+			{0, 32, 48, 56, 64, 80, 96, 112, 128, 144, 160, 176, 192, 224, 256, 0}, // layer 1
+			{0, 8,  16, 24, 32, 40, 48, 56,  64,  80,  96,  112, 128, 144, 160, 0}, // layer 2
+			{0, 8,  16, 24, 32, 40, 48, 56,  64,  80,  96,  112, 128, 144, 160, 0}, // layer 3
+		},
+	};
+	static constexpr unsigned sampleRates[3][4]
+	{
+		{44100, 48000, 32000, 0}, // Version 1
+		{22050, 24000, 16000, 0}, // Version 2
+		{11025, 12000, 8000,  0}, // Version 2.5
+	};
+	static constexpr unsigned samplesPerFrame[3][2]
+	{
+		{384,  384},  // Layer I
+		{1152, 1152}, // Layer II
+		{1152, 576},  // Layer III
+	};
+	static constexpr unsigned paddingSizes[3] {4, 1, 1};
+
+	if (data.size() < 4 || !isFrameSync(data, 0))
+		return std::nullopt;
+
+	const unsigned versionBits {(byteAt(data, 1) >> 3) & 0x03u};
+	if (versionBits == 1)
+		return std::nullopt;
+	const unsigned version {versionBits == 3 ? 0u : (versionBits == 2 ? 1u : 2u)}; // 1, 2, 2.5
+	const unsigned versionIndex {version == 0 ? 0u : 1u};
+
+	const unsigned layerBits {(byteAt(data, 1) >> 1) & 0x03u};
+	if (layerBits == 0)
+		return std::nullopt;
+	const unsigned layerIndex {3 - layerBits};
+
+	MpegFrameHeader header;
+
+	header.bitrate = bitrates[versionIndex][layerIndex][(byteAt(data, 2) >> 4) & 0x0F];
+	if (header.bitrate == 0)
+		return std::nullopt;
+
+	header.sampleRate = sampleRates[version][(byteAt(data, 2) >> 2) & 0x03];
+	if (header.sampleRate == 0)
+		return std::nullopt;
+
+	header.samplesPerFrame = samplesPerFrame[layerIndex][versionIndex];
+	header.frameLength = header.samplesPerFrame * header.bitrate * 125 / header.sampleRate;
+	if (byteAt(data, 2) & 0x02)
+		header.frameLength += paddingSizes[layerIndex];
+
+	return header;
+}
+
+// Returns the number of frames and the stream size from the Xing or VBRI header
+std::optional<std::pair<std::uint32_t, std::uint32_t>>
+parseVbrHeader(std::string_view frame)
+{
+	std::size_t offset {frame.find("Xing")};
+	if (offset == std::string_view::npos)
+		offset = frame.find("Info");
+
+	std::uint32_t frameCount {};
+	std::uint32_t streamSize {};
+
+	if (offset != std::string_view::npos)
+	{
+		// Frame count and stream size are both required
+		if (frame.size() < offset + 16 || (byteAt(frame, offset + 7) & 0x03) != 0x03)
+			return std::nullopt;
+
+		frameCount = readU32BE(frame, offset + 8);
+		streamSize = readU32BE(frame, offset + 12);
+	}
+	else
+	{
+		offset = frame.find("VBRI");
+		if (offset == std::string_view::npos || frame.size() < offset + 32)
+			return std::nullopt;
+
+		frameCount = readU32BE(frame, offset + 14);
+		streamSize = readU32BE(frame, offset + 10);
+	}
+
+	if (frameCount == 0 || streamSize == 0)
+		return std::nullopt;
+
+	return std::make_pair(frameCount, streamSize);
+}
+
+void
+readMpegAudioProperties(NativeFileInfo& info, FileReader& reader, std::uint64_t streamStart, std::uint64_t streamEnd)
+{
+	if (streamStart >= reader.getSize())
+		return;
+
+	const std::size_t searchSize {static_cast<std::size_t>(std::min<std::uint64_t>(reader.getSize() - streamStart, mpegFrameSearchSize))};
+	const bool searchesUpToEndOfFile {streamStart + searchSize == reader.getSize()};
+	const std::string_view data {reader.read(streamStart, searchSize)};
+
+	// First frame: valid header, followed by a consistent header
+	constexpr std::uint32_t headerMask {0xFFFE0C00};
+
+	std::optional<MpegFrameHeader> firstHeader;
+	std::size_t firstFrameOffset {};
+	for (std::size_t offset {}; !firstHeader && offset + 1 < data.size(); ++offset)
+	{
+		if (!isFrameSync(data, offset))
+			continue;
+
+		const std::optional<MpegFrameHeader> header {parseMpegFrameHeader(data.substr(offset))};
+		if (!header)
+			continue;
+
+		const std::size_t nextFrameOffset {offset + header->frameLength};
+		if (nextFrameOffset + 4 > data.size())
+		{
+			if (searchesUpToEndOfFile)
+				continue;
+			throw NativeReaderFallbackException {"first MPEG frame not found close to the tag"};
+		}
+
+		if ((readU32BE(data, offset) & headerMask) != (readU32BE(data, nextFrameOffset) & headerMask))
+			continue;
+
+		firstHeader = header;
+		firstFrameOffset = offset;
+	}
+
+	if (!firstHeader)
+	{
+		if (!searchesUpToEndOfFile)
+			throw NativeReaderFallbackException {"first MPEG frame not found close to the tag"};
+
+		return;
+	}
+
+	if (const auto vbrHeader {parseVbrHeader(data.substr(firstFrameOffset, firstHeader->frameLength))})
+	{
+		const double timePerFrame {firstHeader->samplesPerFrame * 1000.0 / firstHeader->sampleRate};
+		const double length {timePerFrame * vbrHeader->first};
+
+		info.length = std::chrono::milliseconds {static_cast<int>(length + 0.5)};
+		info.bitrate = static_cast<unsigned>(vbrHeader->second * 8.0 / length + 0.5);
+	}
+	else
+	{
+		// Constant bitrate: TagLib looks for the last frame, the end of the stream is close enough
+		info.bitrate = firstHeader->bitrate;
+
+		const std::uint64_t frameStart {streamStart + firstFrameOffset};
+		if (streamEnd > frameStart)
+			info.length = std::chrono::milliseconds {static_cast<int>((streamEnd - frameStart) * 8.0 / info.bitrate + 0.5)};
+	}
+}
+
+} // namespace
+
+NativeFileInfo
+readMpegFile(FileReader& reader)
+{
+	NativeFileInfo info;
+
+	const std::uint64_t tagSize {readId3v2Tag(reader, info)};
+
+	// TagLib merges the APE tags and uses the ID3v1 tag if the ID3v2 one is empty
+	const std::size_t tailSize {static_cast<std::size_t>(std::min<std::uint64_t>(reader.getSize(), id3v1Size + apeFooterSize))};
+	const std::string_view tail {reader.read(reader.getSize() - tailSize, tailSize)};
+
+	const bool hasId3v1Tag {tail.size() >= id3v1Size && tail.substr(tail.size() - id3v1Size, 3) == "TAG"};
+	const std::size_t tagsEnd {tail.size() - (hasId3v1Tag ? id3v1Size : 0)};
+	if (tagsEnd >= apeFooterSize && tail.substr(tagsEnd - apeFooterSize, 8) == "APETAGEX")
+		throw NativeReaderFallbackException {"APE tag"};
+
+	if (hasId3v1Tag && isEmptyTag(info.tags))
+		throw NativeReaderFallbackException {"empty ID3v2 tag, ID3v1 tag to be used"};
+
+	readMpegAudioProperties(info, reader, tagSize, reader.getSize() - (hasId3v1Tag ? id3v1Size : 0));
+
+	return info;
+}
+
+} // namespace MetaData
+
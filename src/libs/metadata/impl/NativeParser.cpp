@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2020 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "metadata/NativeParser.hpp"
+
+#include "metadata/TagLibParser.hpp"
+#include "utils/Logger.hpp"
+#include "utils/String.hpp"
+#include "NativeReaders.hpp"
+
+namespace MetaData
+{
+
+namespace
+{
+
+using NativeReaderFunc = NativeFileInfo(*)(FileReader&);
+
+NativeReaderFunc
+getNativeReader(const std::filesystem::path& p)
+{
+	const std::string extension {StringUtils::stringToLower(p.extension().string())};
+
+	if (extension == ".flac")
+		return &readFlacFile;
+	if (extension == ".mp3")
+		return &readMpegFile;
+	if (extension == ".ogg" || extension == ".oga" || extension == ".opus")
+		return &readOggFile;
+
+	return nullptr;
+}
+
+} // namespace
+
+NativeParser::NativeParser()
+: _fallbackParser {std::make_unique<TagLibParser>()}
+{
+}
+
+NativeParser::~NativeParser() = default;
+
+std::optional<Track>
+NativeParser::parse(const std::filesystem::path& p, bool debug)
+{
+	const NativeReaderFunc nativeReader {getNativeReader(p)};
+	if (!nativeReader)
+		return parseUsingFallback(p, debug);
+
+	NativeFileInfo info;
+	try
+	{
+		FileReader reader {p};
+		info = nativeReader(reader);
+	}
+	catch (const NativeReaderFallbackException& e)
+	{
+		LMS_LOG(METADATA, DEBUG) << "File '" << p.string() << "': using TagLib: " << e.what();
+
+		_fallbackCount++;
+		return parseUsingFallback(p, debug);
+	}
+
+	Track track;
+
+	// Same precision as TagLib
+	track.duration = std::chrono::duration_cast<std::chrono::seconds>(info.length);
+	track.audioStreams = {AudioStream {info.bitrate * 1000}};
+	track.hasCover = info.hasCover;
+	track.embeddedCover = std::move(info.cover);
+
+	fillTrackFromTags(track, info.tags, _clusterTypeNames, debug);
+
+	return track;
+}
+
+std::optional<Track>
+NativeParser::parseUsingFallback(const std::filesystem::path& p, bool debug)
+{
+	_fallbackParser->setClusterTypeNames(_clusterTypeNames);
+	return _fallbackParser->parse(p, debug);
+}
+
+} // namespace MetaData
+
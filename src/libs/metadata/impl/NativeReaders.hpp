@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2020 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "utils/Exception.hpp"
+#include "TagMap.hpp"
+
+namespace MetaData
+{
+
+// The file has to be handled by TagLib: unusual layout, unhandled feature, read error, etc.
+class NativeReaderFallbackException : public LmsException
+{
+	using LmsException::LmsException;
+};
+
+// Reads parts of a file
+// The head of the file is read at once on construction: most of the tags are found there
+class FileReader
+{
+	public:
+		static inline constexpr std::size_t headSize {65536};
+		static inline constexpr std::size_t maxReadSize {16 * 1024 * 1024};
+
+		FileReader(const std::filesystem::path& p);
+
+		FileReader(const FileReader&) = delete;
+		FileReader(FileReader&&) = delete;
+		FileReader& operator=(const FileReader&) = delete;
+		FileReader& operator=(FileReader&&) = delete;
+
+		std::uint64_t getSize() const { return _size; }
+
+		// Returned data is only valid until the next call
+		std::string_view read(std::uint64_t offset, std::size_t size);
+
+	private:
+		std::ifstream	_is;
+		std::uint64_t	_size {};
+		std::string	_head;
+		std::string	_buffer;
+};
+
+// Sequential reads in memory, throws on truncated data
+class ByteReader
+{
+	public:
+		ByteReader(std::string_view data) : _data {data} {}
+
+		std::size_t getOffset() const { return _offset; }
+		std::size_t getRemainingSize() const { return _data.size() - _offset; }
+
+		std::uint8_t readU8();
+		std::uint16_t readU16LE();
+		std::uint32_t readU24BE();
+		std::uint32_t readU32BE();
+		std::uint32_t readU32LE();
+		std::uint64_t readU64LE();
+		std::string_view readBytes(std::size_t size);
+		void skip(std::size_t size);
+
+	private:
+		const std::string_view	_data;
+		std::size_t		_offset {};
+};
+
+// Tags and audio properties, with the same precision as TagLib
+struct NativeFileInfo
+{
+	TagMap				tags;
+	bool				hasCover {};
+	std::optional<EmbeddedCover>	cover;	// first picture, if stored as is in the file
+	std::chrono::milliseconds	length {};
+	unsigned			bitrate {};	// kbps
+};
+
+NativeFileInfo readFlacFile(FileReader& reader);
+NativeFileInfo readMpegFile(FileReader& reader);
+NativeFileInfo readOggFile(FileReader& reader); // Vorbis or Opus
+
+// Dimensions read from the header of PNG and JPEG images
+std::optional<std::pair<std::size_t, std::size_t>> readImageDimensions(std::string_view data);
+
+// Vorbis comment, as found in FLAC and Ogg files
+// Pictures are not added to the tags: hasPicture is set instead
+void readXiphComment(std::string_view data, TagMap& tags, bool& hasPicture);
+
+} // namespace MetaData
+
@@ -0,0 +1,234 @@
+/*
+ * Copyright (C) 2020 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "NativeReaders.hpp"
+
+#include <algorithm>
+#include <array>
+#include <optional>
+#include <vector>
+
+namespace MetaData
+{
+
+namespace
+{
+
+constexpr std::string_view oggPageCapturePattern {"OggS"};
+constexpr std::size_t oggPageHeaderSize {27};
+constexpr std::size_t oggMaxPageSize {oggPageHeaderSize + 255 + 255 * 255};
+
+constexpr std::string_view vorbisIdentificationHeader {"\x01vorbis"};
+constexpr std::string_view vorbisCommentHeader {"\x03vorbis"};
+constexpr std::string_view opusIdentificationHeader {"OpusHead"};
+constexpr std::string_view opusCommentHeader {"OpusTags"};
+
+struct OggPageHeader
+{
+	std::int64_t	granulePosition;
+	std::size_t	segmentCount;
+};
+
+OggPageHeader
+parsePageHeader(std::string_view data)
+{
+	ByteReader reader {data};
+
+	if (reader.readBytes(oggPageCapturePattern.size()) != oggPageCapturePattern)
+		throw NativeReaderFallbackException {"Ogg page not found"};
+
+	reader.skip(2); // version, header type
+
+	OggPageHeader header;
+	header.granulePosition = static_cast<std::int64_t>(reader.readU64LE());
+	reader.skip(12); // serial number, sequence number, checksum
+	header.segmentCount = reader.readU8();
+
+	return header;
+}
+
+// Reads the first packets of the file, pages after pages
+class OggPacketReader
+{
+	public:
+		OggPacketReader(FileReader& reader) : _reader {reader} {}
+
+		std::string readPacket()
+		{
+			std::string packet;
+
+			while (true)
+			{
+				if (_segmentIndex == _segmentCount)
+					readNextPage();
+
+				while (_segmentIndex < _segmentCount)
+				{
+					const std::size_t segmentSize {_segmentSizes[_segmentIndex++]};
+					packet.append(_pageData, _segmentOffset, segmentSize);
+					_segmentOffset += segmentSize;
+
+					if (packet.size() > FileReader::maxReadSize)
+						throw NativeReaderFallbackException {"Ogg packet too large"};
+
+					// A segment smaller than 255 ends the packet
+					if (segmentSize < 255)
+						return packet;
+				}
+			}
+		}
+
+		std::optional<std::int64_t> getFirstPageGranulePosition() const { return _firstPageGranulePosition; }
+
+	private:
+		void readNextPage()
+		{
+			const OggPageHeader header {parsePageHeader(_reader.read(_pageOffset, oggPageHeaderSize))};
+			_pageOffset += oggPageHeaderSize;
+
+			const std::string_view segmentTable {_reader.read(_pageOffset, header.segmentCount)};
+			std::copy(std::cbegin(segmentTable), std::cend(segmentTable), std::begin(_segmentSizes));
+			_pageOffset += header.segmentCount;
+
+			std::size_t dataSize {};
+			for (std::size_t i {}; i < header.segmentCount; ++i)
+				dataSize += _segmentSizes[i];
+
+			// Whole page data at once
+			_pageData = _reader.read(_pageOffset, dataSize);
+			_pageOffset += dataSize;
+
+			_segmentCount = header.segmentCount;
+			_segmentIndex = 0;
+			_segmentOffset = 0;
+
+			if (!_firstPageGranulePosition)
+				_firstPageGranulePosition = header.granulePosition;
+		}
+
+		FileReader&				_reader;
+		std::uint64_t				_pageOffset {};
+		std::string				_pageData;
+		std::array<std::uint8_t, 255>		_segmentSizes {};
+		std::size_t				_segmentCount {};
+		std::size_t				_segmentIndex {};
+		std::size_t				_segmentOffset {};
+		std::optional<std::int64_t>		_firstPageGranulePosition;
+};
+
+// Same as TagLib: granule position of the last page header found in the file
+std::optional<std::int64_t>
+getLastPageGranulePosition(FileReader& reader)
+{
+	const std::size_t tailSize {static_cast<std::size_t>(std::min<std::uint64_t>(reader.getSize(), oggMaxPageSize))};
+	const std::uint64_t tailOffset {reader.getSize() - tailSize};
+	const std::string_view tail {reader.read(tailOffset, tailSize)};
+
+	const std::size_t pageOffset {tail.rfind(oggPageCapturePattern)};
+	if (pageOffset == std::string_view::npos || tail.size() - pageOffset < oggPageHeaderSize)
+		return std::nullopt;
+
+	return parsePageHeader(tail.substr(pageOffset)).granulePosition;
+}
+
+void
+computeAudioProperties(NativeFileInfo& info, FileReader& reader, std::optional<std::int64_t> firstGranulePosition, std::int64_t skippedSampleCount, unsigned sampleRate, std::uint64_t headerPacketsSize)
+{
+	const std::optional<std::int64_t> lastGranulePosition {getLastPageGranulePosition(reader)};
+	if (!firstGranulePosition || !lastGranulePosition || *firstGranulePosition < 0 || *lastGranulePosition < 0 || sampleRate == 0)
+		return;
+
+	const std::int64_t sampleCount {*lastGranulePosition - *firstGranulePosition - skippedSampleCount};
+	if (sampleCount <= 0)
+		return;
+
+	const double length {sampleCount * 1000.0 / sampleRate};
+	const std::uint64_t streamLength {reader.getSize() - std::min(headerPacketsSize, reader.getSize())};
+
+	info.length = std::chrono::milliseconds {static_cast<int>(length + 0.5)};
+	info.bitrate = static_cast<unsigned>(streamLength * 8.0 / length + 0.5);
+}
+
+void
+readVorbisStream(NativeFileInfo& info, FileReader& reader, OggPacketReader& packetReader, std::string_view identificationPacket)
+{
+	ByteReader identificationReader {identificationPacket};
+	identificationReader.skip(vorbisIdentificationHeader.size());
+	identificationReader.skip(4); // version
+	identificationReader.skip(1); // channels
+	const std::uint32_t sampleRate {identificationReader.readU32LE()};
+	identificationReader.skip(4); // max bitrate
+	const std::int32_t nominalBitrate {static_cast<std::int32_t>(identificationReader.readU32LE())};
+
+	const std::string commentPacket {packetReader.readPacket()};
+	if (commentPacket.compare(0, vorbisCommentHeader.size(), vorbisCommentHeader) != 0)
+		throw NativeReaderFallbackException {"Vorbis comment header not found"};
+
+	readXiphComment(std::string_view {commentPacket}.substr(vorbisCommentHeader.size()), info.tags, info.hasCover);
+
+	const std::string setupPacket {packetReader.readPacket()};
+
+	computeAudioProperties(info, reader, packetReader.getFirstPageGranulePosition(), 0, sampleRate, identificationPacket.size() + commentPacket.size() + setupPacket.size());
+
+	if (info.bitrate == 0 && nominalBitrate > 0)
+		info.bitrate = static_cast<unsigned>(nominalBitrate / 1000.0 + 0.5);
+}
+
+void
+readOpusStream(NativeFileInfo& info, FileReader& reader, OggPacketReader& packetReader, std::string_view identificationPacket)
+{
+	ByteReader identificationReader {identificationPacket};
+	identificationReader.skip(opusIdentificationHeader.size());
+	identificationReader.skip(1); // version
+	identificationReader.skip(1); // channels
+	const std::uint16_t preSkip {identificationReader.readU16LE()};
+
+	const std::string commentPacket {packetReader.readPacket()};
+	if (commentPacket.compare(0, opusCommentHeader.size(), opusCommentHeader) != 0)
+		throw NativeReaderFallbackException {"Opus comment header not found"};
+
+	readXiphComment(std::string_view {commentPacket}.substr(opusCommentHeader.size()), info.tags, info.hasCover);
+
+	// Opus always uses 48kHz granule positions
+	computeAudioProperties(info, reader, packetReader.getFirstPageGranulePosition(), preSkip, 48000, identificationPacket.size() + commentPacket.size());
+}
+
+} // namespace
+
+NativeFileInfo
+readOggFile(FileReader& reader)
+{
+	NativeFileInfo info;
+
+	OggPacketReader packetReader {reader};
+	const std::string identificationPacket {packetReader.readPacket()};
+
+	if (identificationPacket.compare(0, vorbisIdentificationHeader.size(), vorbisIdentificationHeader) == 0)
+		readVorbisStream(info, reader, packetReader, identificationPacket);
+	else if (identificationPacket.compare(0, opusIdentificationHeader.size(), opusIdentificationHeader) == 0)
+		readOpusStream(info, reader, packetReader, identificationPacket);
+	else
+		throw NativeReaderFallbackException {"unhandled Ogg stream"};
+
+	return info;
+}
+
+} // namespace MetaData
+
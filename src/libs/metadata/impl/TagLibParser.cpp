@@ -19,8 +19,13 @@
 
 #include "metadata/TagLibParser.hpp"
 
+#include <algorithm>
+#include <functional>
+#include <iostream>
+
 #include <taglib/apetag.h>
 #include <taglib/asffile.h>
+#include <taglib/attachedpictureframe.h>
 #include <taglib/id3v2tag.h>
 #include <taglib/fileref.h>
 #include <taglib/flacfile.h>
@@ -34,263 +39,57 @@
 #include <taglib/wavpackfile.h>
 
 #include "utils/Logger.hpp"
-#include "utils/String.hpp"
+#include "NativeReaders.hpp"
+#include "TagMap.hpp"
 
 
 namespace MetaData
 {
 
-template<typename T>
-std::vector<T>
-getPropertyValuesFirstMatchAs(const TagLib::PropertyMap& properties, const std::set<std::string>& keys)
-{
-	std::vector<T> res;
-
-	for (const std::string& key : keys)
-	{
-		const TagLib::StringList& values {properties[key]};
-		if (values.isEmpty())
-			continue;
-
-		res.reserve(values.size());
-
-		for (const auto& value : values)
-		{
-			auto val {StringUtils::readAs<T>(StringUtils::stringTrim(value.to8Bit(true)))};
-			if (!val)
-				continue;
-
-			res.emplace_back(std::move(*val));
-		}
-
-		break;
-	}
-
-	return res;
-}
-
-template <typename T>
-std::vector<T>
-getPropertyValuesAs(const TagLib::PropertyMap& properties, const std::string& key)
-{
-	return getPropertyValuesFirstMatchAs<T>(properties, {std::move(key)});
-}
-
-static
-std::vector<std::string>
-splitAndTrimString(const std::string& str, const std::string& delimiters)
-{
-	std::vector<std::string> res;
-
-	std::vector<std::string> strings {StringUtils::splitString(str, delimiters)};
-	for (const std::string& s : strings)
-		res.emplace_back(StringUtils::stringTrim(s));
-
-	return res;
-}
-
-static
-std::vector<Artist>
-getArtists(const TagLib::PropertyMap& properties)
+namespace
 {
-	std::vector<std::string> artistNames {getPropertyValuesAs<std::string>(properties, "ARTISTS")};
-	if (artistNames.empty())
-		artistNames = getPropertyValuesAs<std::string>(properties, "ARTIST");
-
-	if (artistNames.empty())
-		return {};
-
-	std::vector<Artist> artists;
-	artists.reserve(artistNames.size());
-	std::transform(std::cbegin(artistNames), std::cend(artistNames), std::back_inserter(artists),
-		[&](const std::string& name) { return Artist {name}; });
-
-	{
-		const std::vector<std::string> artistSortNames {getPropertyValuesAs<std::string>(properties, "ARTISTSORT")};
-		if (artistSortNames.size() == artists.size())
-		{
-			for (std::size_t i {}; i < artistSortNames.size(); ++i)
-				artists[i].sortName = artistSortNames[i];
-		}
-	}
-
-	{
-		const std::vector<UUID> artistsMBID {getPropertyValuesFirstMatchAs<UUID>(properties, {"MUSICBRAINZ_ARTISTID", "MUSICBRAINZ ARTIST ID"})};
-
-		if (artistNames.size() == artistsMBID.size())
-		{
-			for (std::size_t i {}; i < artistsMBID.size(); ++i)
-				artists[i].musicBrainzArtistID = artistsMBID[i];
-		}
-	}
-
-
-	return artists;
-}
-
-static
-std::vector<Artist>
-getAlbumArtists(const TagLib::PropertyMap& properties)
-{
-	std::vector<std::string> artistNames {getPropertyValuesAs<std::string>(properties, "ALBUMARTIST")};
-	if (artistNames.empty())
-		return {};
-
-	std::vector<Artist> artists;
-	artists.reserve(artistNames.size());
-	std::transform(std::cbegin(artistNames), std::cend(artistNames), std::back_inserter(artists),
-		[&](const std::string& name) { return Artist {name}; });
-
-	{
-		const std::vector<std::string> artistSortNames {getPropertyValuesAs<std::string>(properties, "ALBUMARTISTSORT")};
-		if (artistSortNames.size() == artists.size())
-		{
-			for (std::size_t i {}; i < artistSortNames.size(); ++i)
-				artists[i].sortName = artistSortNames[i];
-		}
-	}
-
-	{
-		const std::vector<UUID> artistsMBID {getPropertyValuesFirstMatchAs<UUID>(properties, {"MUSICBRAINZ_ALBUMARTISTID", "MUSICBRAINZ ALBUM ARTIST ID"})};
-
-		if (artistsMBID.size() == artists.size())
-		{
-			for (std::size_t i {}; i < artistsMBID.size(); ++i)
-				artists[i].musicBrainzArtistID = artistsMBID[i];
-		}
-	}
 
-	return artists;
-}
+// Pictures are stored with the other tags, at the start of the file
+constexpr std::size_t coverSearchMargin {1024 * 1024};
 
-static
-std::optional<Album>
-getAlbum(const TagLib::PropertyMap& properties)
+// TagLib does not tell where the picture is stored: look for its data in the head of the file
+// Pictures that are not stored as is (unsynchronisation, compression) are not found
+std::optional<EmbeddedCover>
+findEmbeddedCover(const std::filesystem::path& p, const TagLib::ByteVector& picture, const TagLib::String& mimeType)
 {
-	std::vector<std::string> albumName {getPropertyValuesAs<std::string>(properties, "ALBUM")};
-	if (albumName.empty())
+	if (picture.isEmpty() || picture.size() > FileReader::maxReadSize)
 		return std::nullopt;
 
-	const std::vector<UUID> albumMBID {getPropertyValuesFirstMatchAs<UUID>(properties, {"MUSICBRAINZ_ALBUMID", "MUSICBRAINZ ALBUM ID"})};
+	const std::string_view pictureData {picture.data(), picture.size()};
 
-	if (albumMBID.empty())
-		return Album {std::move(albumName.front()), {}};
-	else
-		return Album {std::move(albumName.front()), albumMBID.front()};
-}
-
-void
-TagLibParser::processTag(Track& track, const std::string& tag, const TagLib::StringList& values, bool debug)
-{
-
-	// TODO validate MBID format
-	if (debug)
+	try
 	{
-		std::vector<std::string> strs;
-		std::transform(values.begin(), values.end(), std::back_inserter(strs), [](const auto& value) { return value.to8Bit(true); });
-
-		std::cout << "[" << tag << "] = " << StringUtils::joinStrings(strs, "*SEP*") << std::endl;
-	}
+		FileReader reader {p};
 
-	if (tag.empty() || values.isEmpty() || values.front().isEmpty())
-		return;
+		const std::uint64_t searchSize {std::min<std::uint64_t>({reader.getSize(), std::uint64_t {picture.size()} + coverSearchMargin, std::uint64_t {FileReader::maxReadSize}})};
+		const std::string_view head {reader.read(0, static_cast<std::size_t>(searchSize))};
 
-	std::string value {StringUtils::stringTrim(values.front().to8Bit(true))};
+		const auto itPicture {std::search(std::cbegin(head), std::cend(head), std::boyer_moore_horspool_searcher {std::cbegin(pictureData), std::cend(pictureData)})};
+		if (itPicture == std::cend(head))
+			return std::nullopt;
 
-	if (tag == "TITLE")
-		track.title = value;
-	else if (tag == "MUSICBRAINZ_RELEASETRACKID"
-			|| tag == "MUSICBRAINZ RELEASE TRACK ID")
-	{
-		track.musicBrainzTrackID = UUID::fromString(value);
-	}
-	else if (tag == "MUSICBRAINZ_TRACKID"
-			|| tag == "MUSICBRAINZ TRACK ID")
-		track.musicBrainzRecordID = UUID::fromString(value);
-	else if (tag == "ACOUSTID_ID")
-		track.acoustID = UUID::fromString(value);
-	else if (tag == "TRACKTOTAL")
-	{
-		auto totalTrack = StringUtils::readAs<std::size_t>(value);
-		if (totalTrack)
-			track.totalTrack = totalTrack;
-	}
-	else if (tag == "TRACKNUMBER")
-	{
-		// Expecting 'Number/Total'
-		std::vector<std::string> strings {splitAndTrimString(value, "/")};
-
-		if (!strings.empty())
-		{
-			track.trackNumber = StringUtils::readAs<std::size_t>(strings[0]);
+		EmbeddedCover cover;
+		cover.offset = static_cast<std::uint64_t>(std::distance(std::cbegin(head), itPicture));
+		cover.size = picture.size();
+		cover.mimeType = mimeType.to8Bit(true);
 
-			// Lower priority than TRACKTOTAL
-			if (strings.size() > 1 && !track.totalTrack)
-				track.totalTrack = StringUtils::readAs<std::size_t>(strings[1]);
-		}
+		return cover;
 	}
-	else if (tag == "DISCTOTAL")
+	catch (const NativeReaderFallbackException& e)
 	{
-		auto totalDisc = StringUtils::readAs<std::size_t>(value);
-		if (totalDisc)
-			track.totalDisc = totalDisc;
+		LMS_LOG(METADATA, DEBUG) << "File '" << p.string() << "': cannot locate embedded cover: " << e.what();
 	}
-	else if (tag == "DISCNUMBER")
-	{
-		// Expecting 'Number/Total'
-		std::vector<std::string> strings {StringUtils::splitString(value, "/")};
 
-		if (!strings.empty())
-		{
-			track.discNumber = StringUtils::readAs<std::size_t>(strings[0]);
-
-			// Lower priority than DISCTOTAL
-			if (strings.size() > 1 && !track.totalDisc)
-				track.totalDisc = StringUtils::readAs<std::size_t>(strings[1]);
-		}
-	}
-	else if (tag == "DATE")
-		track.year = StringUtils::readAs<int>(value);
-	else if (tag == "ORIGINALDATE" && !track.originalYear)
-	{
-		// Lower priority than ORIGINALYEAR
-		track.originalYear = StringUtils::readAs<int>(value);
-	}
-	else if (tag == "ORIGINALYEAR")
-	{
-		// Higher priority than ORIGINALDATE
-		auto originalYear = StringUtils::readAs<int>(value);
-		if (originalYear)
-			track.originalYear = originalYear;
-	}
-	else if (tag == "METADATA_BLOCK_PICTURE")
-		track.hasCover = true;
-	else if (tag == "COPYRIGHT")
-		track.copyright = value;
-	else if (tag == "COPYRIGHTURL")
-		track.copyrightURL = value;
-	else if (tag == "REPLAYGAIN_ALBUM_GAIN")
-		track.albumReplayGain = StringUtils::readAs<float>(value);
-	else if (tag == "REPLAYGAIN_TRACK_GAIN")
-		track.trackReplayGain = StringUtils::readAs<float>(value);
-	else if (tag == "DISCSUBTITLE" || tag == "SETSUBTITLE")
-		track.discSubtitle = value;
-	else if (_clusterTypeNames.find(tag) != _clusterTypeNames.end())
-	{
-		std::set<std::string> clusterNames;
-		for (const auto& valueList : values)
-		{
-			auto values = splitAndTrimString(valueList.to8Bit(true), "/,;");
-
-			for (const auto& value : values)
-				clusterNames.insert(value);
-		}
-
-		if (!clusterNames.empty())
-			track.clusters[tag] = clusterNames;
-	}
+	return std::nullopt;
 }
 
+} // namespace
+
 std::optional<Track>
 TagLibParser::parse(const std::filesystem::path& p, bool debug)
 {
@@ -380,7 +179,24 @@ TagLibParser::parse(const std::filesystem::path& p, bool debug)
 			const auto& frameListMap {mp3File->ID3v2Tag()->frameListMap()};
 
 			if (!frameListMap["APIC"].isEmpty())
+			{
 				track.hasCover = true;
+
+				const auto* pictureFrame {dynamic_cast<const TagLib::ID3v2::AttachedPictureFrame*>(frameListMap["APIC"].front())};
+				if (pictureFrame && pictureFrame->mimeType() != "-->") // not a linked picture
+				{
+					track.embeddedCover = findEmbeddedCover(p, pictureFrame->picture(), pictureFrame->mimeType());
+					if (track.embeddedCover)
+					{
+						const TagLib::ByteVector& picture {pictureFrame->picture()};
+						if (const auto dimensions {readImageDimensions(std::string_view {picture.data(), picture.size()})})
+						{
+							track.embeddedCover->width = dimensions->first;
+							track.embeddedCover->height = dimensions->second;
+						}
+					}
+				}
+			}
 			if (!frameListMap["TSST"].isEmpty())
 				properties.insert("DISCSUBTITLE", frameListMap["TSST"].front()->toString());
 		}
@@ -409,7 +225,18 @@ TagLibParser::parse(const std::filesystem::path& p, bool debug)
 	else if (TagLib::FLAC::File* flacFile {dynamic_cast<TagLib::FLAC::File*>(f.file())})
 	{
 		if (!flacFile->pictureList().isEmpty())
+		{
 			track.hasCover = true;
+
+			// Dimensions as stored in the picture block
+			const TagLib::FLAC::Picture* picture {flacFile->pictureList().front()};
+			track.embeddedCover = findEmbeddedCover(p, picture->data(), picture->mimeType());
+			if (track.embeddedCover)
+			{
+				track.embeddedCover->width = static_cast<std::size_t>(picture->width());
+				track.embeddedCover->height = static_cast<std::size_t>(picture->height());
+			}
+		}
 	}
 	else if (TagLib::Ogg::Vorbis::File* vorbisFile {dynamic_cast<TagLib::Ogg::Vorbis::File*>(f.file())})
 	{
@@ -422,17 +249,15 @@ TagLibParser::parse(const std::filesystem::path& p, bool debug)
 			track.hasCover = true;
 	}
 
-	for (const auto& property : properties)
+	TagMap tags;
+	for (const auto& [name, values] : properties)
 	{
-		const std::string tag {property.first.upper().to8Bit(true)};
-		const TagLib::StringList& values {property.second};
-
-		processTag(track, tag, values, debug);
+		std::vector<std::string>& tagValues {tags[name.upper().to8Bit(true)]};
+		for (const TagLib::String& value : values)
+			tagValues.emplace_back(value.to8Bit(true));
 	}
 
-	track.artists = getArtists(properties);
-	track.albumArtists = getAlbumArtists(properties);
-	track.album = getAlbum(properties);
+	fillTrackFromTags(track, tags, _clusterTypeNames, debug);
 
 	return track;
 }
@@ -0,0 +1,290 @@
+/*
+ * Copyright (C) 2020 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "TagMap.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+#include "utils/String.hpp"
+
+namespace MetaData
+{
+
+namespace
+{
+
+template<typename T>
+std::vector<T>
+getTagValuesFirstMatchAs(const TagMap& tags, const std::set<std::string>& keys)
+{
+	std::vector<T> res;
+
+	for (const std::string& key : keys)
+	{
+		const auto it {tags.find(key)};
+		if (it == std::cend(tags) || it->second.empty())
+			continue;
+
+		const std::vector<std::string>& values {it->second};
+		res.reserve(values.size());
+
+		for (const std::string& value : values)
+		{
+			auto val {StringUtils::readAs<T>(StringUtils::stringTrim(value))};
+			if (!val)
+				continue;
+
+			res.emplace_back(std::move(*val));
+		}
+
+		break;
+	}
+
+	return res;
+}
+
+template <typename T>
+std::vector<T>
+getTagValuesAs(const TagMap& tags, const std::string& key)
+{
+	return getTagValuesFirstMatchAs<T>(tags, {key});
+}
+
+std::vector<std::string>
+splitAndTrimString(const std::string& str, const std::string& delimiters)
+{
+	std::vector<std::string> res;
+
+	std::vector<std::string> strings {StringUtils::splitString(str, delimiters)};
+	for (const std::string& s : strings)
+		res.emplace_back(StringUtils::stringTrim(s));
+
+	return res;
+}
+
+std::vector<Artist>
+getArtists(const TagMap& tags)
+{
+	std::vector<std::string> artistNames {getTagValuesAs<std::string>(tags, "ARTISTS")};
+	if (artistNames.empty())
+		artistNames = getTagValuesAs<std::string>(tags, "ARTIST");
+
+	if (artistNames.empty())
+		return {};
+
+	std::vector<Artist> artists;
+	artists.reserve(artistNames.size());
+	std::transform(std::cbegin(artistNames), std::cend(artistNames), std::back_inserter(artists),
+		[&](const std::string& name) { return Artist {name}; });
+
+	{
+		const std::vector<std::string> artistSortNames {getTagValuesAs<std::string>(tags, "ARTISTSORT")};
+		if (artistSortNames.size() == artists.size())
+		{
+			for (std::size_t i {}; i < artistSortNames.size(); ++i)
+				artists[i].sortName = artistSortNames[i];
+		}
+	}
+
+	{
+		const std::vector<UUID> artistsMBID {getTagValuesFirstMatchAs<UUID>(tags, {"MUSICBRAINZ_ARTISTID", "MUSICBRAINZ ARTIST ID"})};
+
+		if (artistNames.size() == artistsMBID.size())
+		{
+			for (std::size_t i {}; i < artistsMBID.size(); ++i)
+				artists[i].musicBrainzArtistID = artistsMBID[i];
+		}
+	}
+
+
+	return artists;
+}
+
+std::vector<Artist>
+getAlbumArtists(const TagMap& tags)
+{
+	std::vector<std::string> artistNames {getTagValuesAs<std::string>(tags, "ALBUMARTIST")};
+	if (artistNames.empty())
+		return {};
+
+	std::vector<Artist> artists;
+	artists.reserve(artistNames.size());
+	std::transform(std::cbegin(artistNames), std::cend(artistNames), std::back_inserter(artists),
+		[&](const std::string& name) { return Artist {name}; });
+
+	{
+		const std::vector<std::string> artistSortNames {getTagValuesAs<std::string>(tags, "ALBUMARTISTSORT")};
+		if (artistSortNames.size() == artists.size())
+		{
+			for (std::size_t i {}; i < artistSortNames.size(); ++i)
+				artists[i].sortName = artistSortNames[i];
+		}
+	}
+
+	{
+		const std::vector<UUID> artistsMBID {getTagValuesFirstMatchAs<UUID>(tags, {"MUSICBRAINZ_ALBUMARTISTID", "MUSICBRAINZ ALBUM ARTIST ID"})};
+
+		if (artistsMBID.size() == artists.size())
+		{
+			for (std::size_t i {}; i < artistsMBID.size(); ++i)
+				artists[i].musicBrainzArtistID = artistsMBID[i];
+		}
+	}
+
+	return artists;
+}
+
+std::optional<Album>
+getAlbum(const TagMap& tags)
+{
+	std::vector<std::string> albumName {getTagValuesAs<std::string>(tags, "ALBUM")};
+	if (albumName.empty())
+		return std::nullopt;
+
+	const std::vector<UUID> albumMBID {getTagValuesFirstMatchAs<UUID>(tags, {"MUSICBRAINZ_ALBUMID", "MUSICBRAINZ ALBUM ID"})};
+
+	if (albumMBID.empty())
+		return Album {std::move(albumName.front()), {}};
+	else
+		return Album {std::move(albumName.front()), albumMBID.front()};
+}
+
+void
+processTag(Track& track, const std::string& tag, const std::vector<std::string>& values, const std::set<std::string>& clusterTypeNames, bool debug)
+{
+	// TODO validate MBID format
+	if (debug)
+		std::cout << "[" << tag << "] = " << StringUtils::joinStrings(values, "*SEP*") << std::endl;
+
+	if (tag.empty() || values.empty() || values.front().empty())
+		return;
+
+	std::string value {StringUtils::stringTrim(values.front())};
+
+	if (tag == "TITLE")
+		track.title = value;
+	else if (tag == "MUSICBRAINZ_RELEASETRACKID"
+			|| tag == "MUSICBRAINZ RELEASE TRACK ID")
+	{
+		track.musicBrainzTrackID = UUID::fromString(value);
+	}
+	else if (tag == "MUSICBRAINZ_TRACKID"
+			|| tag == "MUSICBRAINZ TRACK ID")
+		track.musicBrainzRecordID = UUID::fromString(value);
+	else if (tag == "ACOUSTID_ID")
+		track.acoustID = UUID::fromString(value);
+	else if (tag == "TRACKTOTAL")
+	{
+		auto totalTrack = StringUtils::readAs<std::size_t>(value);
+		if (totalTrack)
+			track.totalTrack = totalTrack;
+	}
+	else if (tag == "TRACKNUMBER")
+	{
+		// Expecting 'Number/Total'
+		std::vector<std::string> strings {splitAndTrimString(value, "/")};
+
+		if (!strings.empty())
+		{
+			track.trackNumber = StringUtils::readAs<std::size_t>(strings[0]);
+
+			// Lower priority than TRACKTOTAL
+			if (strings.size() > 1 && !track.totalTrack)
+				track.totalTrack = StringUtils::readAs<std::size_t>(strings[1]);
+		}
+	}
+	else if (tag == "DISCTOTAL")
+	{
+		auto totalDisc = StringUtils::readAs<std::size_t>(value);
+		if (totalDisc)
+			track.totalDisc = totalDisc;
+	}
+	else if (tag == "DISCNUMBER")
+	{
+		// Expecting 'Number/Total'
+		std::vector<std::string> strings {StringUtils::splitString(value, "/")};
+
+		if (!strings.empty())
+		{
+			track.discNumber = StringUtils::readAs<std::size_t>(strings[0]);
+
+			// Lower priority than DISCTOTAL
+			if (strings.size() > 1 && !track.totalDisc)
+				track.totalDisc = StringUtils::readAs<std::size_t>(strings[1]);
+		}
+	}
+	else if (tag == "DATE")
+		track.year = StringUtils::readAs<int>(value);
+	else if (tag == "ORIGINALDATE" && !track.originalYear)
+	{
+		// Lower priority than ORIGINALYEAR
+		track.originalYear = StringUtils::readAs<int>(value);
+	}
+	else if (tag == "ORIGINALYEAR")
+	{
+		// Higher priority than ORIGINALDATE
+		auto originalYear = StringUtils::readAs<int>(value);
+		if (originalYear)
+			track.originalYear = originalYear;
+	}
+	else if (tag == "METADATA_BLOCK_PICTURE")
+		track.hasCover = true;
+	else if (tag == "COPYRIGHT")
+		track.copyright = value;
+	else if (tag == "COPYRIGHTURL")
+		track.copyrightURL = value;
+	else if (tag == "REPLAYGAIN_ALBUM_GAIN")
+		track.albumReplayGain = StringUtils::readAs<float>(value);
+	else if (tag == "REPLAYGAIN_TRACK_GAIN")
+		track.trackReplayGain = StringUtils::readAs<float>(value);
+	else if (tag == "DISCSUBTITLE" || tag == "SETSUBTITLE")
+		track.discSubtitle = value;
+	else if (clusterTypeNames.find(tag) != clusterTypeNames.end())
+	{
+		std::set<std::string> clusterNames;
+		for (const std::string& valueList : values)
+		{
+			auto values = splitAndTrimString(valueList, "/,;");
+
+			for (const auto& value : values)
+				clusterNames.insert(value);
+		}
+
+		if (!clusterNames.empty())
+			track.clusters[tag] = clusterNames;
+	}
+}
+
+} // namespace
+
+void
+fillTrackFromTags(Track& track, const TagMap& tags, const std::set<std::string>& clusterTypeNames, bool debug)
+{
+	for (const auto& [tag, values] : tags)
+		processTag(track, tag, values, clusterTypeNames, debug);
+
+	track.artists = getArtists(tags);
+	track.albumArtists = getAlbumArtists(tags);
+	track.album = getAlbum(tags);
+}
+
+} // namespace MetaData
+
@@ -0,0 +1,40 @@
+/*
+ * Copyright (C) 2020 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "metadata/IParser.hpp"
+
+namespace MetaData
+{
+
+// Tag values (UTF-8), by upper case tag name, as TagLib's property maps
+using TagMap = std::map<std::string, std::vector<std::string>>;
+
+// Same interpretation of the tags whatever the parser
+void fillTrackFromTags(Track& track, const TagMap& tags, const std::set<std::string>& clusterTypeNames, bool debug);
+
+} // namespace MetaData
+
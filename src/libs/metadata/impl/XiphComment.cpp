@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2020 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "NativeReaders.hpp"
+
+#include <algorithm>
+
+namespace MetaData
+{
+
+namespace
+{
+
+// Same rules as TagLib: printable ASCII, except '='
+bool
+isValidFieldName(std::string_view name)
+{
+	if (name.empty())
+		return false;
+
+	return std::all_of(std::cbegin(name), std::cend(name), [](char c) { return c >= 0x20 && c <= 0x7D && c != '='; });
+}
+
+std::string
+toUpperASCII(std::string_view str)
+{
+	std::string res {str};
+	for (char& c : res)
+	{
+		if (c >= 'a' && c <= 'z')
+			c = c - 'a' + 'A';
+	}
+
+	return res;
+}
+
+} // namespace
+
+void
+readXiphComment(std::string_view data, TagMap& tags, bool& hasPicture)
+{
+	ByteReader reader {data};
+
+	const std::uint32_t vendorLength {reader.readU32LE()};
+	reader.skip(vendorLength);
+
+	const std::uint32_t fieldCount {reader.readU32LE()};
+	if (fieldCount > reader.getRemainingSize() / 4)
+		throw NativeReaderFallbackException {"bad Vorbis comment field count"};
+
+	for (std::uint32_t i {}; i < fieldCount; ++i)
+	{
+		const std::uint32_t fieldLength {reader.readU32LE()};
+		if (fieldLength > reader.getRemainingSize())
+			break;
+
+		const std::string_view field {reader.readBytes(fieldLength)};
+
+		const std::size_t separator {field.find('=')};
+		if (separator == std::string_view::npos || separator == 0)
+			continue;
+
+		const std::string name {toUpperASCII(field.substr(0, separator))};
+		if (!isValidFieldName(name))
+			continue;
+
+		std::string_view value {field.substr(separator + 1)};
+
+		// Pictures are not decoded
+		if (name == "METADATA_BLOCK_PICTURE" || name == "COVERART")
+		{
+			if (!value.empty())
+				hasPicture = true;
+			continue;
+		}
+
+		value = value.substr(0, value.find('\0'));
+		if (!value.empty())
+			tags[name].emplace_back(value);
+	}
+}
+
+} // namespace MetaData
+
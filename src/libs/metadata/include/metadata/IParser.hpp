@@ -20,6 +20,7 @@
 #pragma once
 
 #include <chrono>
+#include <cstdint>
 #include <filesystem>
 #include <map>
 #include <optional>
@@ -54,6 +55,16 @@ namespace MetaData
 		unsigned bitRate;
 	};
 
+	// Location of the embedded cover, so that it can be read without parsing the file again
+	struct EmbeddedCover
+	{
+		std::uint64_t	offset {};
+		std::size_t	size {};
+		std::string	mimeType;
+		std::size_t	width {};	// 0 if unknown
+		std::size_t	height {};	// 0 if unknown
+	};
+
 	struct Track
 	{
 		std::vector<Artist>		artists;
@@ -71,6 +82,7 @@ namespace MetaData
 		std::optional<int>		year;
 		std::optional<int>		originalYear;
 		bool					hasCover {};
+		std::optional<EmbeddedCover>	embeddedCover;	// not set if the location is unknown
 		std::vector<AudioStream>	audioStreams;
 		std::optional<UUID>		acoustID;
 		std::string				copyright;
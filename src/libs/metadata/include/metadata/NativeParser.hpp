@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2020 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+
+#include "metadata/IParser.hpp"
+
+namespace MetaData
+{
+
+// Fast parser that only reads the tag areas of FLAC, MP3 and Ogg (Vorbis/Opus) files
+// Files that use unusual layouts or features, as well as other formats, are handled by TagLib
+class NativeParser : public IParser
+{
+	public:
+		NativeParser();
+		~NativeParser();
+
+		NativeParser(const NativeParser&) = delete;
+		NativeParser(NativeParser&&) = delete;
+		NativeParser& operator=(const NativeParser&) = delete;
+		NativeParser& operator=(NativeParser&&) = delete;
+
+		// Number of supported files that had to be parsed by TagLib
+		std::size_t getFallbackCount() const { return _fallbackCount; }
+
+	private:
+		std::optional<Track> parse(const std::filesystem::path& p, bool debug = false) override;
+		std::optional<Track> parseUsingFallback(const std::filesystem::path& p, bool debug);
+
+		std::unique_ptr<IParser>	_fallbackParser;
+		std::atomic<std::size_t>	_fallbackCount {};
+};
+
+} // namespace MetaData
+
@@ -21,11 +21,6 @@
 
 #include "metadata/IParser.hpp"
 
-namespace TagLib
-{
-	class StringList;
-}
-
 namespace MetaData
 {
 
@@ -34,8 +29,6 @@ class TagLibParser : public IParser
 {
 	private:
 		std::optional<Track> parse(const std::filesystem::path& p, bool debug = false) override;
-
-		void processTag(Track& track, const std::string& tag, const TagLib::StringList& values, bool debug);
 };
 
 } // namespace MetaData
@@ -17,71 +17,354 @@
  * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+
 #include "AcousticBrainzUtils.hpp"
 
-#include <boost/property_tree/ptree.hpp>
-#include <boost/property_tree/json_parser.hpp>
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <deque>
+#include <list>
+#include <optional>
+
+#include <boost/asio/steady_timer.hpp>
 
 #include <Wt/WIOService.h>
 #include <Wt/Http/Client.h>
 
-#include "utils/IConfig.hpp"
 #include "utils/Logger.hpp"
-#include "utils/Service.hpp"
+#include "utils/String.hpp"
 #include "utils/UUID.hpp"
 
 
 namespace AcousticBrainz
 {
 
-static
-std::string
-getJsonData(const UUID& mbid)
+namespace
 {
-	static const std::string defaultAPIURL = "https://acousticbrainz.org/api/v1/";
 
-	const std::string url {Service<IConfig>::get()->getString("acousticbrainz-api-url", defaultAPIURL) + std::string {mbid.getAsString()} + "/low-level"};
+// Minimal JSON scanning, just enough to extract sub-documents without altering them
+bool
+skipString(std::string_view json, std::size_t& pos)
+{
+	assert(json[pos] == '"');
+
+	for (++pos; pos < json.size(); ++pos)
+	{
+		if (json[pos] == '\\')
+			++pos;
+		else if (json[pos] == '"')
+		{
+			++pos;
+			return true;
+		}
+	}
+
+	return false;
+}
 
-	boost::asio::io_service ioService;
+void
+skipWhitespaces(std::string_view json, std::size_t& pos)
+{
+	while (pos < json.size() && (json[pos] == ' ' || json[pos] == '\t' || json[pos] == '\r' || json[pos] == '\n'))
+		++pos;
+}
 
-	Wt::Http::Client client {ioService};
-	client.setFollowRedirect(true);
-	client.setSslCertificateVerificationEnabled(true);
-	client.setMaximumResponseSize(256*1024);
+bool
+skipValue(std::string_view json, std::size_t& pos)
+{
+	if (pos >= json.size())
+		return false;
 
-	if (!client.get(url))
+	if (json[pos] == '"')
+		return skipString(json, pos);
+
+	if (json[pos] != '{' && json[pos] != '[')
 	{
-		LMS_LOG(DBUPDATER, ERROR) << "Cannot perform a GET request to url '" << url << "'";
-		return {};
+		// Number, true, false or null
+		const std::size_t start {pos};
+		while (pos < json.size() && std::string_view {",}] \t\r\n"}.find(json[pos]) == std::string_view::npos)
+			++pos;
+
+		return pos > start;
 	}
 
-	std::string response;
-	client.done().connect([&](Wt::AsioWrapper::error_code ec, const Wt::Http::Message &msg)
+	std::size_t depth {};
+	while (pos < json.size())
 	{
-		if (ec)
+		switch (json[pos])
 		{
-			LMS_LOG(DBUPDATER, ERROR) << "GET request to url '" << url << "' failed: " << ec.message();
-			return;
+			case '"':
+				if (!skipString(json, pos))
+					return false;
+				continue;
+
+			case '{':
+			case '[':
+				++depth;
+				break;
+
+			case '}':
+			case ']':
+				if (--depth == 0)
+				{
+					++pos;
+					return true;
+				}
+				break;
 		}
+		++pos;
+	}
+
+	return false;
+}
+
+// Raw value of the given member of a JSON object
+std::optional<std::string_view>
+findObjectMember(std::string_view object, std::string_view name)
+{
+	std::size_t pos {};
+
+	skipWhitespaces(object, pos);
+	if (pos >= object.size() || object[pos] != '{')
+		return std::nullopt;
+	++pos;
+
+	while (true)
+	{
+		skipWhitespaces(object, pos);
+		if (pos >= object.size() || object[pos] != '"')
+			return std::nullopt;
+
+		const std::size_t nameStart {pos + 1};
+		if (!skipString(object, pos))
+			return std::nullopt;
+		const std::string_view memberName {object.substr(nameStart, pos - 1 - nameStart)};
+
+		skipWhitespaces(object, pos);
+		if (pos >= object.size() || object[pos] != ':')
+			return std::nullopt;
+		++pos;
+
+		skipWhitespaces(object, pos);
+		const std::size_t valueStart {pos};
+		if (!skipValue(object, pos))
+			return std::nullopt;
+
+		if (memberName == name)
+			return object.substr(valueStart, pos - valueStart);
+
+		skipWhitespaces(object, pos);
+		if (pos >= object.size() || object[pos] != ',')
+			return std::nullopt;
+		++pos;
+	}
+}
+
+// Runs all the requests in the calling thread, using a fixed number of clients
+class FeaturesFetcher
+{
+	public:
+		FeaturesFetcher(const FetchParameters& parameters, const FeaturesCallback& callback, const std::atomic<bool>& abort);
+
+		void fetch(const std::vector<UUID>& MBIDs);
 
-		if (msg.status() != 200)
+	private:
+		struct Slot
 		{
-			LMS_LOG(DBUPDATER, ERROR) << "GET request to url '" << url << "' failed: status = " << msg.status() << ", body = " << msg.body();
-			return;
-		}
+			Slot(boost::asio::io_service& ioService) : client {ioService}, timer {ioService} {}
+
+			Wt::Http::Client		client;
+			boost::asio::steady_timer	timer;
+			std::vector<UUID>		batch;
+		};
+
+		void startNextRequest(Slot& slot);
+		void onRequestDone(Slot& slot, Wt::AsioWrapper::error_code ec, const Wt::Http::Message& msg);
+		void handleResponse(const std::vector<UUID>& batch, const std::string& body);
+		void reportFailure(const std::vector<UUID>& batch);
+		void delayRequests(const Wt::Http::Message& msg);
+
+		const std::string			_apiURL;
+		const std::size_t			_batchSize;
+		const std::size_t			_maxConcurrentRequests;
+		const FeaturesCallback&			_callback;
+		const std::atomic<bool>&		_abort;
+
+		boost::asio::io_service			_ioService;
+		std::list<Slot>				_slots;
+		std::deque<std::vector<UUID>>		_pendingBatches;
+		std::chrono::steady_clock::time_point	_resumeTime {};	// no request sent before, due to rate limiting
+};
+
+FeaturesFetcher::FeaturesFetcher(const FetchParameters& parameters, const FeaturesCallback& callback, const std::atomic<bool>& abort)
+: _apiURL {parameters.apiURL}
+, _batchSize {std::clamp<std::size_t>(parameters.maxMBIDsPerRequest, 1, maxMBIDsPerRequest)}
+, _maxConcurrentRequests {std::max<std::size_t>(parameters.maxConcurrentRequests, 1)}
+, _callback {callback}
+, _abort {abort}
+{
+}
+
+void
+FeaturesFetcher::fetch(const std::vector<UUID>& MBIDs)
+{
+	for (std::size_t offset {}; offset < MBIDs.size(); offset += _batchSize)
+		_pendingBatches.emplace_back(std::cbegin(MBIDs) + offset, std::cbegin(MBIDs) + std::min(offset + _batchSize, MBIDs.size()));
+
+	const std::size_t slotCount {std::min(_maxConcurrentRequests, _pendingBatches.size())};
+
+	LMS_LOG(DBUPDATER, DEBUG) << "Fetching features using " << _pendingBatches.size() << " request(s), " << slotCount << " at a time";
+
+	for (std::size_t i {}; i < slotCount; ++i)
+	{
+		Slot& slot {_slots.emplace_back(_ioService)};
+
+		slot.client.setFollowRedirect(true);
+		slot.client.setSslCertificateVerificationEnabled(true);
+		slot.client.setMaximumResponseSize(_batchSize * 256*1024);
+		slot.client.setTimeout(std::chrono::seconds {30});
+		slot.client.done().connect([this, &slot](Wt::AsioWrapper::error_code ec, const Wt::Http::Message& msg)
+		{
+			onRequestDone(slot, ec, msg);
+		});
 
-		response = msg.body();
-	});
+		_ioService.post([this, &slot] { startNextRequest(slot); });
+	}
+
+	// Returns once all the slots are idle
+	_ioService.run();
+}
+
+void
+FeaturesFetcher::startNextRequest(Slot& slot)
+{
+	if (_abort || _pendingBatches.empty())
+		return;
+
+	if (std::chrono::steady_clock::now() < _resumeTime)
+	{
+		slot.timer.expires_at(_resumeTime);
+		slot.timer.async_wait([this, &slot](const boost::system::error_code& ec)
+		{
+			if (!ec)
+				startNextRequest(slot);
+		});
+		return;
+	}
+
+	slot.batch = std::move(_pendingBatches.front());
+	_pendingBatches.pop_front();
+
+	std::string url {_apiURL + "low-level?recording_ids="};
+	for (const UUID& MBID : slot.batch)
+	{
+		if (&MBID != &slot.batch.front())
+			url += ';';
+		url += MBID.getAsString();
+	}
+
+	if (!slot.client.get(url))
+	{
+		LMS_LOG(DBUPDATER, ERROR) << "Cannot perform a GET request to url '" << url << "'";
+		reportFailure(slot.batch);
+		_ioService.post([this, &slot] { startNextRequest(slot); });
+	}
+}
+
+void
+FeaturesFetcher::onRequestDone(Slot& slot, Wt::AsioWrapper::error_code ec, const Wt::Http::Message& msg)
+{
+	if (ec)
+	{
+		LMS_LOG(DBUPDATER, ERROR) << "GET request failed: " << ec.message();
+		reportFailure(slot.batch);
+	}
+	else if (msg.status() == 429)
+	{
+		// Too many requests: retry later
+		LMS_LOG(DBUPDATER, INFO) << "Rate limited by AcousticBrainz, delaying requests";
+		delayRequests(msg);
+		_pendingBatches.push_front(std::move(slot.batch));
+	}
+	else if (msg.status() != 200)
+	{
+		LMS_LOG(DBUPDATER, ERROR) << "GET request failed: status = " << msg.status() << ", body = " << msg.body();
+		reportFailure(slot.batch);
+	}
+	else
+	{
+		handleResponse(slot.batch, msg.body());
 
-	ioService.run();
+		if (const std::string* remaining {msg.getHeader("X-RateLimit-Remaining")}; remaining && *remaining == "0")
+			delayRequests(msg);
+	}
+
+	slot.batch.clear();
+
+	// Do not start a new request from the done handler
+	_ioService.post([this, &slot] { startNextRequest(slot); });
+}
+
+void
+FeaturesFetcher::handleResponse(const std::vector<UUID>& batch, const std::string& body)
+{
+	for (const UUID& MBID : batch)
+	{
+		const std::string lowLevelFeatures {extractLowLevelFeatures(body, MBID)};
+		if (lowLevelFeatures.empty())
+			LMS_LOG(DBUPDATER, DEBUG) << "No low level features found for MBID '" << MBID.getAsString() << "'";
 
-	return response;
+		_callback(MBID, lowLevelFeatures);
+	}
+}
+
+void
+FeaturesFetcher::reportFailure(const std::vector<UUID>& batch)
+{
+	for (const UUID& MBID : batch)
+		_callback(MBID, "");
+}
+
+void
+FeaturesFetcher::delayRequests(const Wt::Http::Message& msg)
+{
+	std::chrono::seconds delay {1};
+	if (const std::string* resetIn {msg.getHeader("X-RateLimit-Reset-In")})
+	{
+		if (const auto value {StringUtils::readAs<std::size_t>(*resetIn)})
+			delay = std::chrono::seconds {std::max<std::size_t>(*value, 1)};
+	}
+
+	_resumeTime = std::max(_resumeTime, std::chrono::steady_clock::now() + delay);
+}
+
+} // namespace
+
+void
+fetchLowLevelFeatures(const FetchParameters& parameters, const std::vector<UUID>& MBIDs, const FeaturesCallback& callback, const std::atomic<bool>& abort)
+{
+	if (MBIDs.empty())
+		return;
+
+	FeaturesFetcher fetcher {parameters, callback, abort};
+	fetcher.fetch(MBIDs);
 }
 
 std::string
-extractLowLevelFeatures(const UUID& mbid)
+extractLowLevelFeatures(std::string_view response, const UUID& MBID)
 {
-	return getJsonData(mbid);
+	// Response layout: { "<mbid>": { "0": { <low level features> } } }
+	const std::optional<std::string_view> recording {findObjectMember(response, MBID.getAsString())};
+	if (!recording)
+		return {};
+
+	const std::optional<std::string_view> submission {findObjectMember(*recording, "0")};
+	if (!submission)
+		return {};
+
+	return std::string {*submission};
 }
 
-} // namespace Scanner::AcousticBrainz
+} // namespace AcousticBrainz
+
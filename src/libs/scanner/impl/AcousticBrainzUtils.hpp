@@ -17,14 +17,39 @@
  * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+
 #pragma once
 
+#include <atomic>
+#include <cstddef>
+#include <functional>
 #include <string>
+#include <string_view>
+#include <vector>
 
 class UUID;
 
 namespace AcousticBrainz
 {
-	std::string extractLowLevelFeatures(const UUID& MBID);
-}
+	// Max number of recordings per bulk request allowed by the API
+	static constexpr std::size_t maxMBIDsPerRequest {25};
+
+	struct FetchParameters
+	{
+		std::string	apiURL {"https://acousticbrainz.org/api/v1/"};
+		std::size_t	maxMBIDsPerRequest {AcousticBrainz::maxMBIDsPerRequest};
+		std::size_t	maxConcurrentRequests {4};
+	};
 
+	// lowLevelFeatures is empty if the features cannot be fetched
+	using FeaturesCallback = std::function<void(const UUID& MBID, const std::string& lowLevelFeatures)>;
+
+	// Fetch low level features using batched and concurrent requests
+	// The callback is called from the calling thread, for each MBID (unless aborted)
+	void fetchLowLevelFeatures(const FetchParameters& parameters, const std::vector<UUID>& MBIDs, const FeaturesCallback& callback, const std::atomic<bool>& abort);
+
+	// Extract the low level features of a recording from a bulk "low-level" response
+	// The features are returned as is, in the same format as the single recording endpoint
+	// Returns an empty string if the recording is not in the response or if the response is malformed
+	std::string extractLowLevelFeatures(std::string_view response, const UUID& MBID);
+}
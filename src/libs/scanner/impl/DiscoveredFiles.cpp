@@ -0,0 +1,178 @@
+/*
+ * Copyright (C) 2020 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "DiscoveredFiles.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <ctime>
+
+namespace Scanner {
+
+void
+DiscoveredFiles::addDirectory(const std::filesystem::path& path, const std::optional<DirectoryFingerprint>& fingerprint, const std::vector<std::string>& fileNames)
+{
+	assert(std::is_sorted(std::cbegin(fileNames), std::cend(fileNames)));
+
+	_directoryIndexes.emplace(path, _directories.size());
+	_directories.push_back(Directory {path, fingerprint, _fileNameOffsets.size(), fileNames.size()});
+	_sortedByPath = false;
+
+	for (const std::string& fileName : fileNames)
+	{
+		_fileNameOffsets.push_back(_fileNames.size());
+		_fileNames.append(fileName);
+		_fileNames.push_back('\0');
+	}
+}
+
+void
+DiscoveredFiles::addUnreadablePath(const std::filesystem::path& path)
+{
+	_unreadablePaths.push_back(path);
+}
+
+void
+DiscoveredFiles::sortDirectories()
+{
+	std::sort(std::begin(_directories), std::end(_directories),
+			[](const Directory& a, const Directory& b) { return a.path < b.path; });
+
+	updateDirectoryIndexes();
+	_sortedByPath = true;
+}
+
+void
+DiscoveredFiles::sortDirectoriesByLastWriteTime()
+{
+	// Directories that could not be fully listed come last
+	auto getLastWriteTime {[](const Directory& directory)
+	{
+		return directory.fingerprint ? directory.fingerprint->lastWriteTime.toTime_t() : std::time_t {};
+	}};
+
+	std::sort(std::begin(_directories), std::end(_directories),
+			[&](const Directory& a, const Directory& b)
+			{
+				const std::time_t lastWriteTimeA {getLastWriteTime(a)};
+				const std::time_t lastWriteTimeB {getLastWriteTime(b)};
+				if (lastWriteTimeA != lastWriteTimeB)
+					return lastWriteTimeA > lastWriteTimeB;
+
+				return a.path < b.path;
+			});
+
+	updateDirectoryIndexes();
+	_sortedByPath = false;
+}
+
+void
+DiscoveredFiles::updateDirectoryIndexes()
+{
+	_directoryIndexes.clear();
+	for (std::size_t i {}; i < _directories.size(); ++i)
+		_directoryIndexes.emplace(_directories[i].path, i);
+}
+
+std::string_view
+DiscoveredFiles::getFileName(const Directory& directory, std::size_t index) const
+{
+	assert(index < directory.fileCount);
+
+	return std::string_view {_fileNames.c_str() + _fileNameOffsets[directory.firstFileIndex + index]};
+}
+
+std::optional<std::size_t>
+DiscoveredFiles::getDirectoryIndex(const std::filesystem::path& path) const
+{
+	auto itDirectory {_directoryIndexes.find(path)};
+	if (itDirectory == std::cend(_directoryIndexes))
+		return std::nullopt;
+
+	return itDirectory->second;
+}
+
+std::vector<bool>
+DiscoveredFiles::findWrittenDirectories(const std::filesystem::path& lastDirectory, const Wt::WDateTime& scanStartTime, std::function<bool(const std::filesystem::path&)> isFileWritten) const
+{
+	std::vector<bool> res(_directories.size());
+
+	if (lastDirectory.empty() || !scanStartTime.isValid())
+		return res;
+
+	std::size_t directoryCount {};
+	if (const std::optional<std::size_t> index {getDirectoryIndex(lastDirectory)})
+		directoryCount = *index + 1;
+	else if (_sortedByPath)
+		directoryCount = std::count_if(std::cbegin(_directories), std::cend(_directories),
+				[&](const Directory& directory) { return directory.path.compare(lastDirectory) <= 0; });
+
+	for (std::size_t directoryIndex {}; directoryIndex < directoryCount; ++directoryIndex)
+	{
+		// Directories created, or with files added, removed or renamed since then sort anywhere: their files have to be checked
+		const Directory& directory {_directories[directoryIndex]};
+		if (!directory.fingerprint || directory.fingerprint->lastWriteTime.toTime_t() >= scanStartTime.toTime_t())
+			continue;
+
+		// Moved directories keep their last write time
+		bool written {true};
+		for (std::size_t i {}; i < directory.fileCount && written; ++i)
+			written = isFileWritten(directory.path / getFileName(directory, i));
+
+		res[directoryIndex] = written;
+	}
+
+	return res;
+}
+
+bool
+DiscoveredFiles::contains(const std::filesystem::path& file) const
+{
+	auto itDirectory {_directoryIndexes.find(file.parent_path())};
+	if (itDirectory == std::cend(_directoryIndexes))
+		return false;
+
+	const Directory& directory {_directories[itDirectory->second]};
+	const std::string fileName {file.filename().string()};
+
+	const auto itBegin {std::next(std::cbegin(_fileNameOffsets), directory.firstFileIndex)};
+	const auto itEnd {std::next(itBegin, directory.fileCount)};
+
+	const auto it {std::lower_bound(itBegin, itEnd, fileName,
+			[this](std::size_t offset, std::string_view name)
+			{
+				return std::string_view {_fileNames.c_str() + offset} < name;
+			})};
+
+	return it != itEnd && std::string_view {_fileNames.c_str() + *it} == fileName;
+}
+
+bool
+DiscoveredFiles::isUnreadable(const std::filesystem::path& file) const
+{
+	return std::any_of(std::cbegin(_unreadablePaths), std::cend(_unreadablePaths),
+			[&](const std::filesystem::path& unreadablePath)
+			{
+				return std::mismatch(std::cbegin(unreadablePath), std::cend(unreadablePath), std::cbegin(file), std::cend(file)).first == std::cend(unreadablePath);
+			});
+}
+
+} // namespace Scanner
+
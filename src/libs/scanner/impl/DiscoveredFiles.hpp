@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2020 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <Wt/WDateTime.h>
+
+#include "utils/Path.hpp"
+
+namespace Scanner {
+
+struct DirectoryFingerprint
+{
+	Wt::WDateTime	lastWriteTime;
+	std::size_t	entryCount {};
+	std::uint64_t	childrenHash {};
+
+	bool operator==(const DirectoryFingerprint& other) const
+	{
+		return lastWriteTime.toTime_t() == other.lastWriteTime.toTime_t() && entryCount == other.entryCount && childrenHash == other.childrenHash;
+	}
+	bool operator!=(const DirectoryFingerprint& other) const { return !(*this == other); }
+};
+
+// Audio files found in the media directory, grouped by directory
+// File names are stored in a single buffer to keep the memory usage low on huge libraries
+class DiscoveredFiles
+{
+	public:
+		struct Directory
+		{
+			std::filesystem::path			path;
+			std::optional<DirectoryFingerprint>	fingerprint;	// not set if the directory could not be fully listed
+			std::size_t				firstFileIndex {};
+			std::size_t				fileCount {};
+		};
+
+		// fileNames must be sorted
+		void addDirectory(const std::filesystem::path& path, const std::optional<DirectoryFingerprint>& fingerprint, const std::vector<std::string>& fileNames);
+		// Path that could not be explored: files in there may still exist
+		void addUnreadablePath(const std::filesystem::path& path);
+		// Directories may be added in any order: sort them by path, which is also the depth first order
+		void sortDirectories();
+		// Most recently modified directories first, then by path
+		void sortDirectoriesByLastWriteTime();
+
+		const std::vector<Directory>&	getDirectories() const { return _directories; }
+		std::size_t			getFileCount() const { return _fileNameOffsets.size(); }
+		std::string_view		getFileName(const Directory& directory, std::size_t index) const;
+		std::optional<std::size_t>	getDirectoryIndex(const std::filesystem::path& path) const; // in getDirectories()
+
+		// Directories an aborted scan fully wrote, indexed as getDirectories()
+		// They must be ordered up to lastDirectory (or before it in path order if it has been removed since), not modified since scanStartTime and only contain written files
+		std::vector<bool>	findWrittenDirectories(const std::filesystem::path& lastDirectory, const Wt::WDateTime& scanStartTime, std::function<bool(const std::filesystem::path&)> isFileWritten) const;
+
+		bool	contains(const std::filesystem::path& file) const;
+		bool	isUnreadable(const std::filesystem::path& file) const;
+
+	private:
+		void updateDirectoryIndexes();
+
+		std::vector<Directory>					_directories;
+		std::unordered_map<std::filesystem::path, std::size_t>	_directoryIndexes;
+		std::string						_fileNames;	// '\0' separated
+		std::vector<std::size_t>				_fileNameOffsets;
+		std::vector<std::filesystem::path>			_unreadablePaths;
+		bool							_sortedByPath {};
+};
+
+} // namespace Scanner
+
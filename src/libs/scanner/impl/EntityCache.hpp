@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2020 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include "database/Artist.hpp"
+#include "database/Cluster.hpp"
+#include "database/Release.hpp"
+
+namespace Scanner {
+
+// Entities resolved while writing tracks, to avoid querying the same artists/releases/clusters for each track
+// Must be cleared as soon as the written entities may not reflect the database (rollback, end of scan, entities removal)
+struct EntityCache
+{
+	std::unordered_map<std::string, Database::Artist::pointer>	artistsByMBID;
+	std::unordered_map<std::string, Database::Artist::pointer>	artistsByName;		// artists without MBID only
+	std::unordered_map<std::string, Database::Release::pointer>	releasesByMBID;
+	std::unordered_map<std::string, Database::Release::pointer>	releasesByName;		// releases without MBID only
+	std::unordered_map<std::string, Database::ClusterType::pointer>	clusterTypesByName;	// null if the cluster type does not exist
+	std::map<std::pair<Database::IdType, std::string>, Database::Cluster::pointer>	clustersByTypeAndName;
+
+	void clear()
+	{
+		artistsByMBID.clear();
+		artistsByName.clear();
+		releasesByMBID.clear();
+		releasesByName.clear();
+		clusterTypesByName.clear();
+		clustersByTypeAndName.clear();
+	}
+};
+
+} // namespace Scanner
+
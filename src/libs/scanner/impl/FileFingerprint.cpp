@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2020 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "FileFingerprint.hpp"
+
+#include <algorithm>
+#include <array>
+#include <fstream>
+
+#include "utils/Logger.hpp"
+
+namespace Scanner {
+
+namespace {
+
+constexpr std::size_t blockSize {16384};
+
+// FNV-1a: the result is stored in the database, so it must not depend on the standard library implementation
+constexpr std::uint64_t fnvOffsetBasis {14695981039346656037ULL};
+constexpr std::uint64_t fnvPrime {1099511628211ULL};
+
+void
+hashBytes(std::uint64_t& hash, const char* data, std::size_t size)
+{
+	for (std::size_t i {}; i < size; ++i)
+	{
+		hash ^= static_cast<unsigned char>(data[i]);
+		hash *= fnvPrime;
+	}
+}
+
+bool
+hashBlock(std::uint64_t& hash, std::ifstream& is, std::uint64_t offset, std::size_t size)
+{
+	std::array<char, blockSize> buffer;
+
+	is.seekg(offset);
+	is.read(buffer.data(), size);
+	if (!is || static_cast<std::size_t>(is.gcount()) != size)
+		return false;
+
+	hashBytes(hash, buffer.data(), size);
+	return true;
+}
+
+} // namespace
+
+std::optional<Database::Track::FileFingerprint>
+computeFileFingerprint(const std::filesystem::path& file)
+{
+	std::error_code ec;
+	const std::uintmax_t fileSize {std::filesystem::file_size(file, ec)};
+	if (ec)
+	{
+		LMS_LOG(DBUPDATER, ERROR) << "Cannot get size of '" << file.string() << "': " << ec.message();
+		return std::nullopt;
+	}
+
+	std::ifstream is {file, std::ios_base::binary};
+	if (!is)
+	{
+		LMS_LOG(DBUPDATER, ERROR) << "Cannot open '" << file.string() << "'";
+		return std::nullopt;
+	}
+
+	const std::uint64_t size {static_cast<std::uint64_t>(fileSize)};
+	std::uint64_t hash {fnvOffsetBasis};
+
+	// The size is part of the hash: files that only differ by their middle part are still told apart most of the time
+	for (std::size_t i {}; i < sizeof(size); ++i)
+	{
+		hash ^= (size >> (i * 8)) & 0xFF;
+		hash *= fnvPrime;
+	}
+
+	// Blocks overlap on small files, this is fine
+	const std::size_t firstBlockSize {static_cast<std::size_t>(std::min<std::uint64_t>(size, blockSize))};
+	if (!hashBlock(hash, is, 0, firstBlockSize))
+	{
+		LMS_LOG(DBUPDATER, ERROR) << "Cannot read '" << file.string() << "'";
+		return std::nullopt;
+	}
+
+	if (size > blockSize && !hashBlock(hash, is, size - blockSize, blockSize))
+	{
+		LMS_LOG(DBUPDATER, ERROR) << "Cannot read '" << file.string() << "'";
+		return std::nullopt;
+	}
+
+	return Database::Track::FileFingerprint {size, hash};
+}
+
+} // namespace Scanner
+
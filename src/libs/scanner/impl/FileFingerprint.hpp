@@ -0,0 +1,36 @@
+/*
+ * Copyright (C) 2020 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <filesystem>
+#include <optional>
+
+#include "database/Track.hpp"
+
+namespace Scanner {
+
+// Size and hash of the first and last blocks of the file
+// Cheap enough to be computed for every scanned file, yet stable across moves and renames
+// Returns std::nullopt if the file cannot be read
+std::optional<Database::Track::FileFingerprint> computeFileFingerprint(const std::filesystem::path& file);
+
+} // namespace Scanner
+
@@ -0,0 +1,228 @@
+/*
+ * Copyright (C) 2020 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "InotifyWatcher.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include "utils/Exception.hpp"
+#include "utils/Logger.hpp"
+
+namespace Scanner {
+
+namespace {
+
+// Files are only reported once written, to avoid parsing them while they are being copied
+constexpr std::uint32_t watchMask {IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR};
+
+bool
+isSameOrSubPath(const std::filesystem::path& path, const std::filesystem::path& directory)
+{
+	return std::mismatch(std::cbegin(directory), std::cend(directory), std::cbegin(path), std::cend(path)).first == std::cend(directory);
+}
+
+} // namespace
+
+InotifyWatcher::InotifyWatcher(const std::filesystem::path& rootDirectory, ChangeCallback changeCallback, OverflowCallback overflowCallback)
+: _rootDirectory {rootDirectory}
+, _changeCallback {std::move(changeCallback)}
+, _overflowCallback {std::move(overflowCallback)}
+{
+	_inotifyFd = inotify_init1(IN_CLOEXEC);
+	if (_inotifyFd < 0)
+		throw LmsException {"Cannot init inotify: " + std::string {std::strerror(errno)}};
+
+	_stopFd = eventfd(0, EFD_CLOEXEC);
+	if (_stopFd < 0)
+	{
+		const int err {errno};
+		::close(_inotifyFd);
+		throw LmsException {"Cannot create eventfd: " + std::string {std::strerror(err)}};
+	}
+
+	_thread = std::thread {&InotifyWatcher::run, this};
+}
+
+InotifyWatcher::~InotifyWatcher()
+{
+	const std::uint64_t value {1};
+	if (::write(_stopFd, &value, sizeof(value)) < 0)
+		LMS_LOG(DBUPDATER, ERROR) << "Cannot stop watcher thread: " << std::strerror(errno);
+
+	_thread.join();
+
+	::close(_stopFd);
+	::close(_inotifyFd);
+}
+
+void
+InotifyWatcher::run()
+{
+	LMS_LOG(DBUPDATER, INFO) << "Watching changes in '" << _rootDirectory.string() << "'...";
+	addWatchRecursive(_rootDirectory);
+	LMS_LOG(DBUPDATER, INFO) << "Watching " << _watchedDirectories.size() << " directories";
+
+	alignas(inotify_event) std::array<char, 64 * 1024> buffer;
+
+	while (true)
+	{
+		std::array<pollfd, 2> fds {{{_inotifyFd, POLLIN, 0}, {_stopFd, POLLIN, 0}}};
+
+		if (::poll(fds.data(), fds.size(), -1) < 0)
+		{
+			if (errno == EINTR)
+				continue;
+
+			LMS_LOG(DBUPDATER, ERROR) << "Cannot poll inotify events: " << std::strerror(errno);
+			return;
+		}
+
+		if (fds[1].revents)
+			return;
+
+		if (!(fds[0].revents & POLLIN))
+			continue;
+
+		const ssize_t size {::read(_inotifyFd, buffer.data(), buffer.size())};
+		if (size < 0)
+		{
+			if (errno == EINTR)
+				continue;
+
+			LMS_LOG(DBUPDATER, ERROR) << "Cannot read inotify events: " << std::strerror(errno);
+			return;
+		}
+
+		processEvents(buffer.data(), static_cast<std::size_t>(size));
+	}
+}
+
+void
+InotifyWatcher::processEvents(const char* buffer, std::size_t size)
+{
+	for (const char* ptr {buffer}; ptr < buffer + size; )
+	{
+		const inotify_event& event {*reinterpret_cast<const inotify_event*>(ptr)};
+		ptr += sizeof(inotify_event) + event.len;
+
+		if (event.mask & IN_Q_OVERFLOW)
+		{
+			LMS_LOG(DBUPDATER, INFO) << "Too many changes, some of them have been lost";
+			_overflowCallback();
+			continue;
+		}
+
+		auto itDirectory {_watchedDirectories.find(event.wd)};
+		if (itDirectory == std::cend(_watchedDirectories))
+			continue;
+
+		// Watch removed (directory deleted or unmounted)
+		if (event.mask & IN_IGNORED)
+		{
+			_watchedDirectories.erase(itDirectory);
+			continue;
+		}
+
+		if (event.len == 0)
+			continue;
+
+		const std::filesystem::path path {itDirectory->second / event.name};
+
+		if (event.mask & IN_ISDIR)
+		{
+			// A moved directory keeps its watch descriptor: make sure it is up to date
+			if (event.mask & IN_MOVED_FROM)
+				removeWatchRecursive(path);
+			else if (event.mask & (IN_CREATE | IN_MOVED_TO))
+				addWatchRecursive(path);
+		}
+		else if (event.mask & IN_CREATE)
+		{
+			// Wait for IN_CLOSE_WRITE
+			continue;
+		}
+
+		LMS_LOG(DBUPDATER, DEBUG) << "Change detected on '" << path.string() << "'";
+		_changeCallback(path);
+	}
+}
+
+void
+InotifyWatcher::addWatchRecursive(const std::filesystem::path& directory)
+{
+	const int wd {inotify_add_watch(_inotifyFd, directory.c_str(), watchMask)};
+	if (wd < 0)
+	{
+		if (errno == ENOSPC)
+		{
+			if (!_watchLimitReached)
+				LMS_LOG(DBUPDATER, ERROR) << "Cannot watch '" << directory.string() << "': watch limit reached, consider increasing fs.inotify.max_user_watches";
+			_watchLimitReached = true;
+		}
+		else
+		{
+			LMS_LOG(DBUPDATER, ERROR) << "Cannot watch '" << directory.string() << "': " << std::strerror(errno);
+		}
+		return;
+	}
+
+	_watchedDirectories[wd] = directory;
+
+	std::error_code ec;
+	std::filesystem::directory_iterator itPath {directory, std::filesystem::directory_options::follow_directory_symlink, ec};
+	const std::filesystem::directory_iterator itEnd;
+	while (!ec && itPath != itEnd)
+	{
+		std::error_code entryEc;
+		if (itPath->is_directory(entryEc))
+			addWatchRecursive(itPath->path());
+
+		itPath.increment(ec);
+	}
+
+	if (ec)
+		LMS_LOG(DBUPDATER, ERROR) << "Cannot explore '" << directory.string() << "': " << ec.message();
+}
+
+void
+InotifyWatcher::removeWatchRecursive(const std::filesystem::path& directory)
+{
+	for (auto it {std::begin(_watchedDirectories)}; it != std::end(_watchedDirectories); )
+	{
+		if (isSameOrSubPath(it->second, directory))
+		{
+			inotify_rm_watch(_inotifyFd, it->first);
+			it = _watchedDirectories.erase(it);
+		}
+		else
+			++it;
+	}
+}
+
+} // namespace Scanner
+
@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2020 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <filesystem>
+#include <functional>
+#include <thread>
+#include <unordered_map>
+
+namespace Scanner {
+
+// Watches a directory and all its sub directories using inotify
+// Callbacks are called from a dedicated thread
+class InotifyWatcher
+{
+	public:
+		// Called with the file or directory that has been added, removed or modified
+		using ChangeCallback = std::function<void(const std::filesystem::path&)>;
+		// Called when some changes have been lost
+		using OverflowCallback = std::function<void()>;
+
+		InotifyWatcher(const std::filesystem::path& rootDirectory, ChangeCallback changeCallback, OverflowCallback overflowCallback);
+		~InotifyWatcher();
+
+		InotifyWatcher(const InotifyWatcher&) = delete;
+		InotifyWatcher(InotifyWatcher&&) = delete;
+		InotifyWatcher& operator=(const InotifyWatcher&) = delete;
+		InotifyWatcher& operator=(InotifyWatcher&&) = delete;
+
+		const std::filesystem::path& getRootDirectory() const { return _rootDirectory; }
+
+	private:
+		void run();
+		void processEvents(const char* buffer, std::size_t size);
+		void addWatchRecursive(const std::filesystem::path& directory);
+		void removeWatchRecursive(const std::filesystem::path& directory);
+
+		const std::filesystem::path	_rootDirectory;
+		ChangeCallback			_changeCallback;
+		OverflowCallback		_overflowCallback;
+		int				_inotifyFd {-1};
+		int				_stopFd {-1};	// used to wake up the watcher thread on destruction
+		bool				_watchLimitReached {};
+		std::unordered_map<int, std::filesystem::path>	_watchedDirectories;	// by watch descriptor, only accessed by the watcher thread
+		std::thread			_thread;
+};
+
+} // namespace Scanner
+
@@ -19,27 +19,45 @@
 
 #include "MediaScanner.hpp"
 
+#include <algorithm>
+#include <thread>
+
 #include <boost/asio/placeholders.hpp>
 
 #include <Wt/WLocalDateTime.h>
 
 #include "database/Artist.hpp"
 #include "database/Cluster.hpp"
+#include "database/Directory.hpp"
 #include "database/Release.hpp"
+#include "database/ScanCheckpoint.hpp"
 #include "database/ScanSettings.hpp"
 #include "database/Track.hpp"
 #include "database/TrackFeatures.hpp"
+#include "metadata/NativeParser.hpp"
 #include "metadata/TagLibParser.hpp"
+#include "utils/DirectoryWalker.hpp"
 #include "utils/Exception.hpp"
+#include "utils/IConfig.hpp"
 #include "utils/Logger.hpp"
 #include "utils/Path.hpp"
+#include "utils/Service.hpp"
 #include "utils/UUID.hpp"
 #include "AcousticBrainzUtils.hpp"
+#include "EntityCache.hpp"
+#include "FileFingerprint.hpp"
+#include "ThreadPriority.hpp"
 
 using namespace Database;
 
 namespace {
 
+// Minimum time between two scan checkpoints: all the parsed files have to be written to commit one
+constexpr std::chrono::seconds scanCheckpointPeriod {30};
+
+// Watched changes are scanned at the latest after this many debounce delays, even if changes keep coming
+constexpr unsigned watchMaxDelayFactor {10};
+
 Wt::WDate
 getNextMonday(Wt::WDate current)
 {
@@ -62,6 +80,102 @@ getNextFirstOfMonth(Wt::WDate current)
 	return current;
 }
 
+std::size_t
+getDiscoveryThreadCount()
+{
+	// Listing directories is mostly waiting for the file system: more threads than cores may help on network shares
+	return std::max<std::size_t>(Service<IConfig>::get()->getULong("scanner-discovery-thread-count", 4), 1);
+}
+
+std::size_t
+getParserThreadCount()
+{
+	// 0 means as many threads as cores
+	std::size_t threadCount {Service<IConfig>::get()->getULong("scanner-parser-thread-count", 0)};
+	if (threadCount == 0)
+		threadCount = std::max<std::size_t>(std::thread::hardware_concurrency(), 1);
+
+	return threadCount;
+}
+
+void
+mergeWriteStats(Scanner::ScanStats& stats, const Scanner::ScanStats& writeStats)
+{
+	stats.scans += writeStats.scans;
+	stats.additions += writeStats.additions;
+	stats.deletions += writeStats.deletions;
+	stats.updates += writeStats.updates;
+	stats.errors.insert(std::end(stats.errors), std::cbegin(writeStats.errors), std::cend(writeStats.errors));
+}
+
+// Records the wall time and the processed files of a scan step
+class ScopedStepPerfRecorder
+{
+	public:
+		ScopedStepPerfRecorder(Scanner::ScanStats& stats, const Scanner::ScanStepStats& stepStats)
+		: _stats {stats}
+		, _stepStats {stepStats}
+		{}
+
+		~ScopedStepPerfRecorder()
+		{
+			Scanner::ScanStepPerfStats& stepPerf {_stats.perf.getStep(_stepStats.currentStep)};
+
+			stepPerf.duration += std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - _start);
+			stepPerf.processedFiles += _stepStats.processedFiles;
+		}
+
+		ScopedStepPerfRecorder(const ScopedStepPerfRecorder&) = delete;
+		ScopedStepPerfRecorder& operator=(const ScopedStepPerfRecorder&) = delete;
+
+	private:
+		Scanner::ScanStats&				_stats;
+		const Scanner::ScanStepStats&			_stepStats;
+		const std::chrono::steady_clock::time_point	_start {std::chrono::steady_clock::now()};
+};
+
+void
+logPerfStats(const Scanner::ScanPerfStats& perf)
+{
+	for (std::size_t step {}; step < Scanner::ScanProgressStepCount; ++step)
+		LMS_LOG(DBUPDATER, DEBUG) << "Step " << step + 1 << ": " << perf.steps[step].duration.count() << " ms, " << perf.steps[step].processedFiles << " file(s), " << perf.steps[step].getFilesPerSecond() << " files/s";
+
+	auto logLatency {[](const char* name, const Scanner::LatencyHistogram& histogram)
+	{
+		LMS_LOG(DBUPDATER, DEBUG) << name << " latency (us): avg = " << histogram.getAverage().count() << ", p50 = " << histogram.getPercentile(50).count() << ", p99 = " << histogram.getPercentile(99).count() << ", max = " << histogram.max.count() << " (" << histogram.count << " samples)";
+	}};
+
+	logLatency("Parse", perf.parseLatency);
+	logLatency("DB write", perf.dbWriteLatency);
+	logLatency("DB lock wait", perf.dbLockWaitLatency);
+}
+
+// FNV-1a: the result is stored in the database, so it must not depend on the standard library implementation
+std::uint64_t
+computeChildrenHash(std::vector<std::string>& names)
+{
+	constexpr std::uint64_t offsetBasis {14695981039346656037ULL};
+	constexpr std::uint64_t prime {1099511628211ULL};
+
+	// Directory iteration order is unspecified
+	std::sort(std::begin(names), std::end(names));
+
+	std::uint64_t hash {offsetBasis};
+	for (const std::string& name : names)
+	{
+		for (const char c : name)
+		{
+			hash ^= static_cast<unsigned char>(c);
+			hash *= prime;
+		}
+
+		// names separator ('\0')
+		hash *= prime;
+	}
+
+	return hash;
+}
+
 bool
 isFileSupported(const std::filesystem::path& file, const std::unordered_set<std::filesystem::path>& extensions)
 {
@@ -118,7 +232,7 @@ updateArtistIfNeeded(const Artist::pointer& artist, const MetaData::Artist& arti
 }
 
 std::vector<Artist::pointer>
-getOrCreateArtists(Session& session, const std::vector<MetaData::Artist>& artistsInfo)
+getOrCreateArtists(Session& session, EntityCache& cache, const std::vector<MetaData::Artist>& artistsInfo)
 {
 	std::vector<Artist::pointer> artists;
 
@@ -129,12 +243,20 @@ getOrCreateArtists(Session& session, const std::vector<MetaData::Artist>& artist
 		// First try to get by MBID
 		if (artistInfo.musicBrainzArtistID)
 		{
-			artist = Artist::getByMBID(session, *artistInfo.musicBrainzArtistID);
+			const std::string mbid {artistInfo.musicBrainzArtistID->getAsString()};
+
+			auto itArtist {cache.artistsByMBID.find(mbid)};
+			if (itArtist != std::cend(cache.artistsByMBID))
+				artist = itArtist->second;
+			else
+				artist = Artist::getByMBID(session, *artistInfo.musicBrainzArtistID);
+
 			if (!artist)
 				artist = createArtist(session, artistInfo);
 			else
 				updateArtistIfNeeded(artist, artistInfo);
 
+			cache.artistsByMBID[mbid] = artist;
 			artists.emplace_back(std::move(artist));
 			continue;
 		}
@@ -142,13 +264,21 @@ getOrCreateArtists(Session& session, const std::vector<MetaData::Artist>& artist
 		// Fall back on artist name (collisions may occur)
 		if (!artistInfo.name.empty())
 		{
-			for (const Artist::pointer& sameNamedArtist : Artist::getByName(session, artistInfo.name))
+			auto itArtist {cache.artistsByName.find(artistInfo.name)};
+			if (itArtist != std::cend(cache.artistsByName))
 			{
-				// Do not fallback on artist that is correctly tagged
-				if (!sameNamedArtist->getMBID())
+				artist = itArtist->second;
+			}
+			else
+			{
+				for (const Artist::pointer& sameNamedArtist : Artist::getByName(session, artistInfo.name))
 				{
-					artist = sameNamedArtist;
-					break;
+					// Do not fallback on artist that is correctly tagged
+					if (!sameNamedArtist->getMBID())
+					{
+						artist = sameNamedArtist;
+						break;
+					}
 				}
 			}
 
@@ -158,6 +288,7 @@ getOrCreateArtists(Session& session, const std::vector<MetaData::Artist>& artist
 			else
 				updateArtistIfNeeded(artist, artistInfo);
 
+			cache.artistsByName[artistInfo.name] = artist;
 			artists.emplace_back(std::move(artist));
 			continue;
 		}
@@ -167,14 +298,21 @@ getOrCreateArtists(Session& session, const std::vector<MetaData::Artist>& artist
 }
 
 Release::pointer
-getOrCreateRelease(Session& session, const MetaData::Album& album)
+getOrCreateRelease(Session& session, EntityCache& cache, const MetaData::Album& album)
 {
 	Release::pointer release;
 
 	// First try to get by MBID
 	if (album.musicBrainzAlbumID)
 	{
-		release = Release::getByMBID(session, *album.musicBrainzAlbumID);
+		const std::string mbid {album.musicBrainzAlbumID->getAsString()};
+
+		auto itRelease {cache.releasesByMBID.find(mbid)};
+		if (itRelease != std::cend(cache.releasesByMBID))
+			release = itRelease->second;
+		else
+			release = Release::getByMBID(session, *album.musicBrainzAlbumID);
+
 		if (!release)
 		{
 			release = Release::create(session, album.name, album.musicBrainzAlbumID);
@@ -185,12 +323,17 @@ getOrCreateRelease(Session& session, const MetaData::Album& album)
 			release.modify()->setName(album.name);
 		}
 
+		cache.releasesByMBID[mbid] = release;
 		return release;
 	}
 
 	// Fall back on release name (collisions may occur)
 	if (!album.name.empty())
 	{
+		auto itRelease {cache.releasesByName.find(album.name)};
+		if (itRelease != std::cend(cache.releasesByName))
+			return itRelease->second;
+
 		for (const Release::pointer& sameNamedRelease : Release::getByName(session, album.name))
 		{
 			// do not fallback on properly tagged releases
@@ -205,6 +348,7 @@ getOrCreateRelease(Session& session, const MetaData::Album& album)
 		if (!release)
 			release = Release::create(session, album.name);
 
+		cache.releasesByName[album.name] = release;
 		return release;
 	}
 
@@ -212,19 +356,25 @@ getOrCreateRelease(Session& session, const MetaData::Album& album)
 }
 
 std::vector<Cluster::pointer>
-getOrCreateClusters(Session& session, const MetaData::Clusters& clustersNames)
+getOrCreateClusters(Session& session, EntityCache& cache, const MetaData::Clusters& clustersNames)
 {
 	std::vector< Cluster::pointer > clusters;
 
-	for (auto clusterNames : clustersNames)
+	for (const auto& [clusterTypeName, clusterNames] : clustersNames)
 	{
-		auto clusterType = ClusterType::getByName(session, clusterNames.first);
+		auto itClusterType {cache.clusterTypesByName.find(clusterTypeName)};
+		if (itClusterType == std::cend(cache.clusterTypesByName))
+			itClusterType = cache.clusterTypesByName.emplace(clusterTypeName, ClusterType::getByName(session, clusterTypeName)).first;
+
+		const ClusterType::pointer& clusterType {itClusterType->second};
 		if (!clusterType)
 			continue;
 
-		for (auto clusterName : clusterNames.second)
+		for (const auto& clusterName : clusterNames)
 		{
-			auto cluster = clusterType->getCluster(clusterName);
+			Cluster::pointer& cluster {cache.clustersByTypeAndName[{clusterType.id(), clusterName}]};
+			if (!cluster)
+				cluster = clusterType->getCluster(clusterName);
 			if (!cluster)
 				cluster = Cluster::create(session, clusterType, clusterName);
 
@@ -247,9 +397,11 @@ createMediaScanner(Database::Db& db)
 
 MediaScanner::MediaScanner(Database::Db& db)
 : _dbSession {db}
+, _directoryWalker {getDiscoveryThreadCount()}
+, _watchEnabled {Service<IConfig>::get()->getBool("scanner-watch", false)}
+, _watchDebounceDelay {Service<IConfig>::get()->getULong("scanner-watch-debounce-delay", 5)}
 {
-	// For now, always use TagLib
-	_metadataParser = std::make_unique<MetaData::TagLibParser>();
+	_parserPool = createParserPool();
 
 	_ioService.setThreadCount(1);
 
@@ -269,6 +421,7 @@ MediaScanner::start()
 	std::scoped_lock lock {_controlMutex};
 
 	scheduleNextScan();
+	restartWatcher();
 
 	_ioService.start();
 }
@@ -281,7 +434,12 @@ MediaScanner::stop()
 	_abortScan = true;
 
 	_scheduleTimer.cancel();
+	_watchTimer.cancel();
 	_ioService.stop();
+
+#ifdef LMS_SUPPORT_INOTIFY
+	_watcher.reset();
+#endif
 }
 
 void
@@ -290,13 +448,24 @@ MediaScanner::abortScan()
 	LMS_LOG(DBUPDATER, DEBUG) << "Aborting scan...";
 	std::scoped_lock lock {_controlMutex};
 
+	stopScanThread();
+	startScanThread();
+}
+
+void
+MediaScanner::stopScanThread()
+{
 	LMS_LOG(DBUPDATER, DEBUG) << "Waiting for the scan to abort...";
 
 	_abortScan = true;
 	_scheduleTimer.cancel();
 	_ioService.stop();
 	LMS_LOG(DBUPDATER, DEBUG) << "Scan abort done!";
+}
 
+void
+MediaScanner::startScanThread()
+{
 	_abortScan = false;
 	_ioService.start();
 }
@@ -314,10 +483,22 @@ MediaScanner::requestImmediateScan(bool force)
 void
 MediaScanner::requestReload()
 {
-	abortScan();
+	{
+		LMS_LOG(DBUPDATER, DEBUG) << "Aborting scan...";
+		std::scoped_lock lock {_controlMutex};
+
+		stopScanThread();
+
+		// The scanner priority may have been raised back: without CAP_SYS_NICE, a thread cannot undo a lower priority
+		// So the scan and parser threads are recreated by the calling thread, that is not a scanner thread
+		_parserPool = createParserPool();
+		startScanThread();
+	}
+
 	_ioService.post([=]()
 	{
 		scheduleNextScan();
+		restartWatcher();
 	});
 }
 
@@ -391,30 +572,6 @@ MediaScanner::scheduleNextScan()
 	_sigScheduled.emit(_nextScheduledScan);
 }
 
-void
-MediaScanner::countAllFiles(ScanStats& stats)
-{
-	ScanStepStats stepStats{stats.startTime, ScanProgressStep::DiscoveringFiles};
-
-	stats.filesScanned = 0;
-	notifyInProgress(stepStats);
-
-	exploreFilesRecursive(_mediaDirectory, [&](std::error_code ec, const std::filesystem::path& path)
-	{
-		if (_abortScan)
-			return false;
-
-		if (!ec && isFileSupported(path, _fileExtensions))
-		{
-			stats.filesScanned++;
-			stepStats.processedFiles++;
-			notifyInProgressIfNeeded(stepStats);
-		}
-
-		return true;
-	});
-}
-
 void
 MediaScanner::scheduleScan(bool force, const Wt::WDateTime& dateTime)
 {
@@ -460,20 +617,44 @@ MediaScanner::scan(bool forceScan)
 	LMS_LOG(UI, INFO) << "New scan started!";
 
 	refreshScanSettings();
+	applyScannerPriority();
 
-	removeMissingTracks(stats);
+	// Resume the previous scan if it did not complete
+	const ScanCheckpoint::Phase phase {loadScanCheckpoint(forceScan, stats.startTime)};
 
-	LMS_LOG(DBUPDATER, DEBUG) << "Counting files in media directory '" << _mediaDirectory.string() << "'...";
-	countAllFiles(stats);
+	// Single walk in the media directory, used by the following steps
+	DiscoveredFiles discoveredFiles;
+
+	LMS_LOG(DBUPDATER, DEBUG) << "Discovering files in media directory '" << _mediaDirectory.string() << "'...";
+	discoverFiles(discoveredFiles, stats);
 	LMS_LOG(DBUPDATER, DEBUG) << "-> Nb files = " << stats.filesScanned;
 
+	// Freshly added albums first
+	if (_scanNewestFirst)
+		discoveredFiles.sortDirectoriesByLastWriteTime();
+
+	findMissingTracks(discoveredFiles, stats);
+
 	LMS_LOG(UI, INFO) << "Checks complete, force scan = " << forceScan;
 
-	LMS_LOG(DBUPDATER, INFO) << "scaning media directory '" << _mediaDirectory.string() << "'...";
-	scanMediaDirectory(_mediaDirectory, forceScan, stats);
-	LMS_LOG(DBUPDATER, INFO) << "scaning media directory '" << _mediaDirectory.string() << "' DONE";
+	if (phase == ScanCheckpoint::Phase::ScanningFiles)
+	{
+		LMS_LOG(DBUPDATER, INFO) << "scaning media directory '" << _mediaDirectory.string() << "'...";
+		scanMediaDirectory(discoveredFiles, forceScan, stats);
+		LMS_LOG(DBUPDATER, INFO) << "scaning media directory '" << _mediaDirectory.string() << "' DONE";
+
+		if (!_abortScan)
+			saveScanCheckpoint(ScanCheckpoint::Phase::FilesScanned, {}, stats.startTime);
+	}
+	else
+	{
+		LMS_LOG(DBUPDATER, INFO) << "Media directory already scanned by the resumed scan";
+	}
+
+	// Missing tracks that have not been found elsewhere
+	removeMissingTracks(stats);
 
-	removeOrphanEntries();
+	removeOrphanEntries(stats);
 
 	if (!_abortScan)
 		checkDuplicatedAudioFiles(stats);
@@ -483,8 +664,22 @@ MediaScanner::scan(bool forceScan)
 
 	LMS_LOG(DBUPDATER, INFO) << "Scan " << (_abortScan ? "aborted" : "complete") << ". Changes = " << stats.nbChanges() << " (added = " << stats.additions << ", removed = " << stats.deletions << ", updated = " << stats.updates << "), Not changed = " << stats.skips << ", Scanned = " << stats.scans << " (errors = " << stats.errors.size() << "), features fetched = " << stats.featuresFetched << ",  duplicates = " << stats.duplicates.size();
 
+	logPerfStats(stats.perf);
+
 	_dbSession.optimize();
 
+	if (!_abortScan)
+		removeScanCheckpoint();
+	_resumeLastDirectory.clear();
+
+	finishScan(stats);
+}
+
+void
+MediaScanner::finishScan(ScanStats& stats)
+{
+	_entityCache.clear();
+
 	if (!_abortScan)
 	{
 		stats.stopTime = Wt::WLocalDateTime::currentDateTime().toUTC();
@@ -511,30 +706,188 @@ MediaScanner::scan(bool forceScan)
 	}
 }
 
-bool
-MediaScanner::fetchTrackFeatures(Database::IdType trackId, const UUID& MBID)
+void
+MediaScanner::restartWatcher()
 {
-	std::map<std::string, double> features;
+	if (!_watchEnabled)
+		return;
+
+#ifdef LMS_SUPPORT_INOTIFY
+	if (_watcher && _watcher->getRootDirectory() == _mediaDirectory)
+		return;
+
+	_watcher.reset();
+	_watchTimer.cancel();
+	_watchedChanges.clear();
+	_watchedChangesPendingSince.reset();
+
+	if (_mediaDirectory.empty())
+		return;
 
-	LMS_LOG(DBUPDATER, INFO) << "Fetching low level features for track '" << MBID.getAsString() << "'";
-	const std::string data {AcousticBrainz::extractLowLevelFeatures(MBID)};
-	if (data.empty())
+	try
 	{
-		LMS_LOG(DBUPDATER, ERROR) << "Track " << trackId << ", MBID = '" << MBID.getAsString() << "': cannot extract features using AcousticBrainz";
-		return false;
+		_watcher = std::make_unique<InotifyWatcher>(_mediaDirectory,
+			[this](const std::filesystem::path& path)
+			{
+				_ioService.post([this, path]
+				{
+					onWatchedChange(path);
+				});
+			},
+			[this]
+			{
+				_ioService.post([this]
+				{
+					LMS_LOG(DBUPDATER, INFO) << "Watched changes lost, scheduling a full scan";
+					_watchTimer.cancel();
+					_watchedChanges.clear();
+					_watchedChangesPendingSince.reset();
+					scheduleScan(false);
+				});
+			});
+	}
+	catch (LmsException& e)
+	{
+		LMS_LOG(DBUPDATER, ERROR) << "Cannot watch media directory: " << e.what();
+	}
+#else
+	LMS_LOG(DBUPDATER, ERROR) << "Watching the media directory is not supported on this platform";
+#endif
+}
+
+void
+MediaScanner::onWatchedChange(const std::filesystem::path& path)
+{
+	_watchedChanges.insert(path);
+	scheduleWatchedChangesScan();
+}
+
+void
+MediaScanner::scheduleWatchedChangesScan()
+{
+	// Postpone the scan as long as changes keep coming, up to a max delay
+	const auto now {std::chrono::steady_clock::now()};
+	if (!_watchedChangesPendingSince)
+		_watchedChangesPendingSince = now;
+
+	const std::chrono::steady_clock::time_point deadline {*_watchedChangesPendingSince + _watchDebounceDelay * watchMaxDelayFactor};
+	const std::chrono::steady_clock::duration delay {std::clamp<std::chrono::steady_clock::duration>(deadline - now, std::chrono::steady_clock::duration::zero(), _watchDebounceDelay)};
+
+	_watchTimer.expires_from_now(std::chrono::duration_cast<std::chrono::system_clock::duration>(delay));
+	_watchTimer.async_wait([this](boost::system::error_code ec)
+	{
+		if (ec)
+			return;
+
+		scanWatchedChanges();
+	});
+}
+
+void
+MediaScanner::scanWatchedChanges()
+{
+	if (_watchedChanges.empty())
+		return;
+
+	std::set<std::filesystem::path> changes;
+	changes.swap(_watchedChanges);
+	_watchedChangesPendingSince.reset();
+
+	scanStarted().emit();
+
+	{
+		std::unique_lock lock {_statusMutex};
+		_curState = State::InProgress;
+		_nextScheduledScan = {};
 	}
 
+	ScanStats stats;
+	stats.startTime = Wt::WLocalDateTime::currentDateTime().toUTC();
+
+	LMS_LOG(DBUPDATER, INFO) << "Scanning " << changes.size() << " watched change(s)...";
+
+	refreshScanSettings();
+	applyScannerPriority();
+
 	{
-		auto uniqueTransaction {_dbSession.createUniqueTransaction()};
+		ScanStepStats stepStats{stats.startTime, ScanProgressStep::ScanningFiles};
+		ScopedStepPerfRecorder stepPerfRecorder {stats, stepStats};
+		stepStats.filesToProcess = changes.size();
+		notifyInProgress(stepStats);
 
-		Wt::Dbo::ptr<Database::Track> track {Database::Track::getById(_dbSession, trackId)};
-		if (!track)
-			return false;
+		// Removed paths first: added files may be the moved ones
+		std::optional<std::filesystem::path> lastMissingPath;
+		for (const std::filesystem::path& path : changes)
+		{
+			// Sub paths follow their parent in the set: already handled by the parent path
+			if (lastMissingPath && isPathInParentPath(path, *lastMissingPath))
+				continue;
+
+			std::error_code ec;
+			if (std::filesystem::status(path, ec).type() == std::filesystem::file_type::not_found)
+			{
+				findMissingTracks(path, stats);
+				lastMissingPath = path;
+			}
+		}
+
+		std::optional<std::filesystem::path> lastScannedDirectory;
+		for (const std::filesystem::path& path : changes)
+		{
+			if (_abortScan)
+				break;
+
+			// Sub paths follow their parent in the set: already handled by the parent directory scan
+			if (lastScannedDirectory && isPathInParentPath(path, *lastScannedDirectory))
+				continue;
+
+			std::error_code ec;
+			const std::filesystem::file_status status {std::filesystem::status(path, ec)};
+			if (status.type() == std::filesystem::file_type::not_found)
+			{
+				// Already handled
+			}
+			else if (ec)
+			{
+				LMS_LOG(DBUPDATER, ERROR) << "Cannot process entry '" << path.string() << "': " << ec.message();
+				stats.errors.emplace_back(ScanError {path, ScanErrorType::CannotReadFile, ec.message()});
+			}
+			else if (std::filesystem::is_directory(status))
+			{
+				DiscoveredFiles discoveredFiles;
+				ScanStepStats discoveryStepStats {stats.startTime, ScanProgressStep::DiscoveringFiles};
+				discoverDirectory(path, discoveredFiles, stats, discoveryStepStats);
 
-		Database::TrackFeatures::create(_dbSession, track, data);
+				stepStats.filesToProcess += discoveredFiles.getFileCount();
+				scanDiscoveredFiles(discoveredFiles, false, stats, stepStats);
+				lastScannedDirectory = path;
+			}
+			else if (std::filesystem::is_regular_file(status) && isFileSupported(path, _fileExtensions))
+			{
+				scanAudioFile(path, false, stats, stepStats);
+			}
+
+			notifyInProgressIfNeeded(stepStats);
+		}
+
+		writeParsedFiles(stats, stepStats);
+		removeMissingTracks(stats);
 	}
 
-	return true;
+	if (_abortScan)
+	{
+		// Keep the changes for later
+		_watchedChanges.insert(std::cbegin(changes), std::cend(changes));
+		scheduleWatchedChangesScan();
+	}
+	else if (stats.nbChanges() > 0)
+	{
+		removeOrphanEntries(stats);
+	}
+
+	LMS_LOG(DBUPDATER, INFO) << "Watched changes scan " << (_abortScan ? "aborted" : "complete") << ". Changes = " << stats.nbChanges() << " (added = " << stats.additions << ", removed = " << stats.deletions << ", updated = " << stats.updates << "), Not changed = " << stats.skips << ", Scanned = " << stats.scans << " (errors = " << stats.errors.size() << ")";
+
+	finishScan(stats);
 }
 
 void
@@ -544,51 +897,114 @@ MediaScanner::fetchTrackFeatures(ScanStats& stats)
 		return;
 
 	ScanStepStats stepStats{stats.startTime, ScanProgressStep::FetchingTrackFeatures};
+	ScopedStepPerfRecorder stepPerfRecorder {stats, stepStats};
 
 	LMS_LOG(DBUPDATER, INFO) << "Fetching missing track features...";
 
-	struct TrackInfo
-	{
-		Database::IdType id;
-		UUID mbid;
-	};
-
-	const auto tracksToFetch {[&]()
+	// Several tracks may share the same MBID
+	std::vector<UUID> MBIDs;
+	std::unordered_map<std::string, std::vector<Database::IdType>> trackIdsByMBID;
 	{
-		std::vector<TrackInfo> res;
-
 		auto transaction {_dbSession.createSharedTransaction()};
 
-		auto tracks {Database::Track::getAllWithMBIDAndMissingFeatures(_dbSession)};
-		for (const auto& track : tracks)
-			res.emplace_back(TrackInfo {track.id(), *track->getMBID()});
+		for (const auto& track : Database::Track::getAllWithMBIDAndMissingFeatures(_dbSession))
+		{
+			const UUID& MBID {*track->getMBID()};
+
+			std::vector<Database::IdType>& trackIds {trackIdsByMBID[std::string {MBID.getAsString()}]};
+			if (trackIds.empty())
+				MBIDs.push_back(MBID);
 
-		return res;
-	}()};
+			trackIds.push_back(track.id());
+		}
+	}
 
-	stepStats.filesToProcess = tracksToFetch.size();
+	stepStats.filesToProcess = MBIDs.size();
 	notifyInProgress(stepStats);
 
-	LMS_LOG(DBUPDATER, INFO) << "Found " << tracksToFetch.size() << " track(s) to fetch!";
+	LMS_LOG(DBUPDATER, INFO) << "Found " << MBIDs.size() << " recording(s) to fetch!";
 
-	for (const TrackInfo& trackToFetch : tracksToFetch)
+	std::vector<std::pair<Database::IdType, std::string>> featuresBatch;
+	auto writeFeaturesBatch {[&]
 	{
-		if (_abortScan)
+		if (featuresBatch.empty())
 			return;
 
-		if (fetchTrackFeatures(trackToFetch.id, trackToFetch.mbid))
+		auto uniqueTransaction {_dbSession.createUniqueTransaction()};
+
+		for (const auto& [trackId, lowLevelFeatures] : featuresBatch)
+		{
+			Track::pointer track {Track::getById(_dbSession, trackId)};
+			if (!track)
+				continue;
+
+			Database::TrackFeatures::create(_dbSession, track, lowLevelFeatures);
 			stats.featuresFetched++;
+		}
+
+		featuresBatch.clear();
+	}};
+
+	AcousticBrainz::FetchParameters fetchParameters;
+	fetchParameters.apiURL = Service<IConfig>::get()->getString("acousticbrainz-api-url", fetchParameters.apiURL);
+	fetchParameters.maxMBIDsPerRequest = Service<IConfig>::get()->getULong("acousticbrainz-max-mbids-per-request", fetchParameters.maxMBIDsPerRequest);
+	fetchParameters.maxConcurrentRequests = Service<IConfig>::get()->getULong("acousticbrainz-max-concurrent-requests", fetchParameters.maxConcurrentRequests);
+
+	AcousticBrainz::fetchLowLevelFeatures(fetchParameters, MBIDs, [&](const UUID& MBID, const std::string& lowLevelFeatures)
+	{
+		if (lowLevelFeatures.empty())
+		{
+			LMS_LOG(DBUPDATER, ERROR) << "MBID = '" << MBID.getAsString() << "': cannot extract features using AcousticBrainz";
+		}
+		else
+		{
+			for (const Database::IdType trackId : trackIdsByMBID[std::string {MBID.getAsString()}])
+				featuresBatch.emplace_back(trackId, lowLevelFeatures);
+
+			if (featuresBatch.size() >= _writeBatchSize)
+				writeFeaturesBatch();
+		}
 
 		stepStats.processedFiles++;
 		notifyInProgressIfNeeded(stepStats);
-	}
+	}, _abortScan);
+
+	writeFeaturesBatch();
 
 	LMS_LOG(DBUPDATER, INFO) << "Track features fetched!";
 }
 
+std::unique_ptr<ParserPool>
+MediaScanner::createParserPool()
+{
+	const std::size_t parserThreadCount {getParserThreadCount()};
+
+	// The native parser falls back on TagLib for the files it does not handle
+	const bool useNativeParser {Service<IConfig>::get()->getBool("scanner-native-parser", false)};
+	LMS_LOG(DBUPDATER, INFO) << "Using " << (useNativeParser ? "native" : "TagLib") << " parser";
+
+	auto parserPool {std::make_unique<ParserPool>(parserThreadCount,
+			[=]() -> std::unique_ptr<MetaData::IParser>
+			{
+				if (useNativeParser)
+					return std::make_unique<MetaData::NativeParser>();
+
+				return std::make_unique<MetaData::TagLibParser>();
+			},
+			parserThreadCount * 4)};
+
+	// Settings applied on the next scan, the workers start with the priority of the calling thread
+	parserPool->setClusterTypeNames(_clusterTypeNames);
+	parserPool->setThreadPriority(_scannerPriority);
+
+	return parserPool;
+}
+
 void
 MediaScanner::refreshScanSettings()
 {
+	_entityCache.clear();
+
 	auto transaction {_dbSession.createSharedTransaction()};
 
 	ScanSettings::pointer scanSettings {ScanSettings::get(_dbSession)};
@@ -607,16 +1023,31 @@ MediaScanner::refreshScanSettings()
 	}
 	_mediaDirectory = scanSettings->getMediaDirectory();
 	_recommendationEngineType = scanSettings->getRecommendationEngineType();
+	_writeBatchSize = std::max<std::size_t>(scanSettings->getWriteBatchSize(), 1);
+	_writeBatchMaxDuration = scanSettings->getWriteBatchMaxDuration();
+	_scannerPriority = scanSettings->getScannerPriority();
+	_scanNewestFirst = scanSettings->getScanNewestFirst();
+	_skipUnchangedDirectories = scanSettings->getSkipUnchangedDirectories();
+	_scanThrottler.setMaxFilesPerSecond(scanSettings->getMaxFilesPerSecond());
+	_scanThrottler.setBackOffWhenStreaming(scanSettings->getBackOffWhenStreaming());
 
 	auto clusterTypes = scanSettings->getClusterTypes();
-	std::set<std::string> clusterTypeNames;
+	_clusterTypeNames.clear();
 
 	std::transform(std::cbegin(clusterTypes), std::cend(clusterTypes),
-			std::inserter(clusterTypeNames, clusterTypeNames.begin()),
+			std::inserter(_clusterTypeNames, _clusterTypeNames.begin()),
 			[](ClusterType::pointer clusterType) { return clusterType->getName(); });
 
-	_metadataParser->setClusterTypeNames(clusterTypeNames);
+	_parserPool->setClusterTypeNames(_clusterTypeNames);
+	_parserPool->setThreadPriority(_scannerPriority);
+}
 
+void
+MediaScanner::applyScannerPriority()
+{
+	// The io thread may have been recreated since the last scan (aborts, reloads): always apply
+	// The discovery threads are created by this thread and inherit its priority
+	setCurrentThreadPriority(_scannerPriority);
 }
 
 void
@@ -642,7 +1073,34 @@ MediaScanner::notifyInProgressIfNeeded(const ScanStepStats& stepStats)
 }
 
 void
-MediaScanner::scanAudioFile(const std::filesystem::path& file, bool forceScan, ScanStats& stats)
+MediaScanner::findMissingTracks(const std::filesystem::path& path, ScanStats& stats)
+{
+	std::vector<IdType> tracksToRemove;
+
+	{
+		auto transaction {_dbSession.createSharedTransaction()};
+
+		// Removed path may be a file or a directory
+		std::vector<Track::pointer> tracks {Track::getByDirectory(_dbSession, path)};
+		if (Track::pointer track {Track::getByPath(_dbSession, path)})
+			tracks.push_back(track);
+
+		for (const Track::pointer& track : tracks)
+		{
+			LMS_LOG(DBUPDATER, INFO) << "'" << track->getPath().string() << "' is missing";
+
+			if (const std::optional<Track::FileFingerprint> fingerprint {track->getFileFingerprint()})
+				_missingTracks.emplace(fingerprint->contentHash, MissingTrack {track.id(), track->getPath(), fingerprint->size, track->getScanVersion()});
+			else
+				tracksToRemove.push_back(track.id());
+		}
+	}
+
+	removeTracks(tracksToRemove, stats);
+}
+
+void
+MediaScanner::scanAudioFile(const std::filesystem::path& file, bool forceScan, ScanStats& stats, ScanStepStats& stepStats)
 {
 	Wt::WDateTime lastWriteTime;
 	try
@@ -652,26 +1110,232 @@ MediaScanner::scanAudioFile(const std::filesystem::path& file, bool forceScan, S
 	catch (LmsException& e)
 	{
 		LMS_LOG(DBUPDATER, ERROR) << e.what();
-		stats.skips++;
+		stats.errors.emplace_back(ScanError {file, ScanErrorType::CannotReadFile, e.what()});
+		stepStats.processedFiles++;
 		return;
 	}
 
-	if (!forceScan)
+	std::optional<IndexedTrack> indexedTrack;
+	if (!forceScan || !_missingTracks.empty())
+		indexedTrack = getIndexedTrack(file);
+
+	bool moved {};
+	if (!indexedTrack && !_missingTracks.empty())
 	{
-		// Skip file if last write is the same
-		auto transaction {_dbSession.createSharedTransaction()};
+		// New file: may be a missing track that has been moved here
+		_scanThrottler.waitForNextFile(_abortScan);
+		if (const std::optional<Track::FileFingerprint> fingerprint {computeFileFingerprint(file)})
+		{
+			if (const std::optional<MissingTrack> missingTrack {popMissingTrack(*fingerprint)})
+			{
+				LMS_LOG(DBUPDATER, INFO) << "Moving '" << missingTrack->path.string() << "' to '" << file.string() << "'";
 
-		const Track::pointer track {Track::getByPath(_dbSession, file)};
+				queueTrackFileUpdate(TrackFileUpdate {missingTrack->id, file, lastWriteTime, *fingerprint}, stats);
+				if (_trackIndex)
+				{
+					_trackIndex->erase(missingTrack->path);
+					(*_trackIndex)[file] = IndexedTrack {missingTrack->id, lastWriteTime.toTime_t(), missingTrack->scanVersion, true};
+				}
 
-		if (track && track->getLastWriteTime().toTime_t() == lastWriteTime.toTime_t()
-				&& track->getScanVersion() == _scanVersion)
-		{
-			stats.skips++;
-			return;
+				indexedTrack = IndexedTrack {missingTrack->id, lastWriteTime.toTime_t(), missingTrack->scanVersion, true};
+				moved = true;
+			}
 		}
 	}
 
-	std::optional<MetaData::Track> trackInfo {_metadataParser->parse(file)};
+	if (!forceScan)
+	{
+		// Skip file if last write is the same
+		if (indexedTrack && indexedTrack->lastWriteTime == lastWriteTime.toTime_t()
+				&& indexedTrack->scanVersion == _scanVersion)
+		{
+			// Tracks written before fingerprints were introduced
+			if (!indexedTrack->hasFingerprint)
+			{
+				_scanThrottler.waitForNextFile(_abortScan);
+				if (const std::optional<Track::FileFingerprint> fingerprint {computeFileFingerprint(file)})
+					queueTrackFileUpdate(TrackFileUpdate {indexedTrack->id, file, lastWriteTime, *fingerprint}, stats);
+			}
+
+			if (moved)
+				stats.updates++;
+			else
+				stats.skips++;
+			stepStats.processedFiles++;
+			return;
+		}
+	}
+
+	_scanThrottler.waitForNextFile(_abortScan);
+
+	// Make room for this file: write parsed files to the database meanwhile
+	while (_parserPool->isFull())
+		processNextParseResult(stats, stepStats);
+
+	_parserPool->push(file, lastWriteTime);
+}
+
+void
+MediaScanner::writeParsedFiles(ScanStats& stats, ScanStepStats& stepStats)
+{
+	while (!_abortScan && !_parserPool->isEmpty())
+		processNextParseResult(stats, stepStats);
+
+	if (_abortScan)
+		_parserPool->clear();
+
+	flushWriteBatch(stats);
+}
+
+void
+MediaScanner::processNextParseResult(ScanStats& stats, ScanStepStats& stepStats)
+{
+	std::optional<ParserPool::Result> result {_parserPool->popResult()};
+	if (!result)
+		return;
+
+	if (_writeBatch.empty())
+		_writeBatchStartTime = std::chrono::steady_clock::now();
+
+	stats.perf.parseLatency.add(result->parseDuration);
+	_writeBatch.emplace_back(std::move(*result));
+
+	if (_writeBatch.size() >= _writeBatchSize
+			|| std::chrono::steady_clock::now() - _writeBatchStartTime >= _writeBatchMaxDuration)
+	{
+		flushWriteBatch(stats);
+	}
+
+	stepStats.processedFiles++;
+	notifyInProgressIfNeeded(stepStats);
+}
+
+void
+MediaScanner::flushWriteBatch(ScanStats& stats)
+{
+	// Moved files may have been parsed too: they must be found at their new path
+	flushTrackFileUpdates(stats);
+
+	if (_writeBatch.empty())
+		return;
+
+	LMS_LOG(DBUPDATER, DEBUG) << "Writing batch of " << _writeBatch.size() << " file(s)";
+
+	try
+	{
+		ScanStats batchStats;
+		const auto lockWaitStart {std::chrono::steady_clock::now()};
+		std::chrono::steady_clock::time_point writeStart;
+		{
+			auto uniqueTransaction {_dbSession.createUniqueTransaction()};
+			writeStart = std::chrono::steady_clock::now();
+
+			for (const ParserPool::Result& result : _writeBatch)
+				writeTrack(result, batchStats);
+
+			updateReleaseAggregates();
+		}
+
+		stats.perf.dbLockWaitLatency.add(std::chrono::duration_cast<std::chrono::microseconds>(writeStart - lockWaitStart));
+		stats.perf.dbWriteLatency.add(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - writeStart));
+		mergeWriteStats(stats, batchStats);
+	}
+	catch (std::exception& e)
+	{
+		LMS_LOG(DBUPDATER, ERROR) << "Cannot write batch of " << _writeBatch.size() << " file(s): " << e.what() << ". Writing files one by one...";
+		_dbSession.getDboSession().discardUnflushed();
+		// Entities created in the rolled back transaction are no longer valid
+		_entityCache.clear();
+		_releasesToUpdate.clear();
+
+		// Isolate the faulty file(s), the other ones have to be written
+		for (const ParserPool::Result& result : _writeBatch)
+		{
+			try
+			{
+				ScanStats fileStats;
+				{
+					auto uniqueTransaction {_dbSession.createUniqueTransaction()};
+					writeTrack(result, fileStats);
+					updateReleaseAggregates();
+				}
+
+				mergeWriteStats(stats, fileStats);
+			}
+			catch (std::exception& e)
+			{
+				LMS_LOG(DBUPDATER, ERROR) << "Cannot write '" << result.file.string() << "': " << e.what();
+				_dbSession.getDboSession().discardUnflushed();
+				_entityCache.clear();
+				_releasesToUpdate.clear();
+
+				stats.errors.emplace_back(result.file, ScanErrorType::CannotUpdateDatabase, e.what());
+			}
+		}
+	}
+
+	_writeBatch.clear();
+}
+
+void
+MediaScanner::queueTrackFileUpdate(const TrackFileUpdate& update, ScanStats& stats)
+{
+	_trackFileUpdates.push_back(update);
+
+	if (_trackFileUpdates.size() >= _writeBatchSize)
+		flushTrackFileUpdates(stats);
+}
+
+void
+MediaScanner::flushTrackFileUpdates(ScanStats& stats)
+{
+	if (_trackFileUpdates.empty())
+		return;
+
+	LMS_LOG(DBUPDATER, DEBUG) << "Writing batch of " << _trackFileUpdates.size() << " file update(s)";
+
+	try
+	{
+		auto uniqueTransaction {_dbSession.createUniqueTransaction()};
+
+		for (const TrackFileUpdate& update : _trackFileUpdates)
+		{
+			Track::pointer track {Track::getById(_dbSession, update.id)};
+			if (!track)
+				continue;
+
+			track.modify()->setPath(update.file);
+			track.modify()->setLastWriteTime(update.lastWriteTime);
+			track.modify()->setFileFingerprint(update.fingerprint);
+
+			if (track->getRelease())
+				_releasesToUpdate.insert(track->getRelease());
+		}
+
+		updateReleaseAggregates();
+	}
+	catch (std::exception& e)
+	{
+		LMS_LOG(DBUPDATER, ERROR) << "Cannot write batch of " << _trackFileUpdates.size() << " file update(s): " << e.what();
+		_dbSession.getDboSession().discardUnflushed();
+		_entityCache.clear();
+		_releasesToUpdate.clear();
+
+		// Reported as errors so that their directories are fully scanned again next time
+		for (const TrackFileUpdate& update : _trackFileUpdates)
+			stats.errors.emplace_back(update.file, ScanErrorType::CannotUpdateDatabase, e.what());
+	}
+
+	_trackFileUpdates.clear();
+}
+
+void
+MediaScanner::writeTrack(const ParserPool::Result& result, ScanStats& stats)
+{
+	_dbSession.checkUniqueLocked();
+
+	const std::filesystem::path& file {result.file};
+	const std::optional<MetaData::Track>& trackInfo {result.track};
 	if (!trackInfo)
 	{
 		stats.errors.emplace_back(file, ScanErrorType::CannotParseFile);
@@ -680,9 +1344,16 @@ MediaScanner::scanAudioFile(const std::filesystem::path& file, bool forceScan, S
 
 	stats.scans++;
 
-	auto uniqueTransaction {_dbSession.createUniqueTransaction()};
-
-	Track::pointer track {Track::getByPath(_dbSession, file) };
+	// The index may be stale if a batch has been rolled back: fall back on the path
+	Track::pointer track;
+	if (_trackIndex)
+	{
+		auto itIndexedTrack {_trackIndex->find(file)};
+		if (itIndexedTrack != std::cend(*_trackIndex))
+			track = Track::getById(_dbSession, itIndexedTrack->second.id);
+	}
+	if (!track)
+		track = Track::getByPath(_dbSession, file);
 
 	// We estimate this is an audio file if:
 	// - we found a least one audio stream
@@ -694,8 +1365,12 @@ MediaScanner::scanAudioFile(const std::filesystem::path& file, bool forceScan, S
 		// If Track exists here, delete it!
 		if (track)
 		{
+			if (track->getRelease())
+				_releasesToUpdate.insert(track->getRelease());
 			track.remove();
 			stats.deletions++;
+			if (_trackIndex)
+				_trackIndex->erase(file);
 		}
 		stats.errors.emplace_back(ScanError {file, ScanErrorType::NoAudioTrack});
 		return;
@@ -707,8 +1382,12 @@ MediaScanner::scanAudioFile(const std::filesystem::path& file, bool forceScan, S
 		// If Track exists here, delete it!
 		if (track)
 		{
+			if (track->getRelease())
+				_releasesToUpdate.insert(track->getRelease());
 			track.remove();
 			stats.deletions++;
+			if (_trackIndex)
+				_trackIndex->erase(file);
 		}
 		stats.errors.emplace_back(ScanError {file, ScanErrorType::BadDuration});
 		return;
@@ -726,18 +1405,18 @@ MediaScanner::scanAudioFile(const std::filesystem::path& file, bool forceScan, S
 	}
 
 	// ***** Clusters
-	std::vector<Cluster::pointer> clusters {getOrCreateClusters(_dbSession, trackInfo->clusters)};
+	std::vector<Cluster::pointer> clusters {getOrCreateClusters(_dbSession, _entityCache, trackInfo->clusters)};
 
 	//  ***** Artists
-	std::vector<Artist::pointer> artists {getOrCreateArtists(_dbSession, trackInfo->artists)};
+	std::vector<Artist::pointer> artists {getOrCreateArtists(_dbSession, _entityCache, trackInfo->artists)};
 
 	//  ***** Release artists
-	std::vector<Artist::pointer> releaseArtists {getOrCreateArtists(_dbSession, trackInfo->albumArtists)};
+	std::vector<Artist::pointer> releaseArtists {getOrCreateArtists(_dbSession, _entityCache, trackInfo->albumArtists)};
 
 	//  ***** Release
 	Release::pointer release;
 	if (trackInfo->album)
-		release = getOrCreateRelease(_dbSession, *trackInfo->album);
+		release = getOrCreateRelease(_dbSession, _entityCache, *trackInfo->album);
 
 	// If file already exist, update data
 	// Otherwise, create it
@@ -765,10 +1444,17 @@ MediaScanner::scanAudioFile(const std::filesystem::path& file, bool forceScan, S
 	for (const auto& releaseArtist : releaseArtists)
 		track.modify()->addArtistLink(Database::TrackArtistLink::create(_dbSession, track, releaseArtist, Database::TrackArtistLink::Type::ReleaseArtist));
 
+	// Both the previous and the new releases have to be updated
+	if (track->getRelease())
+		_releasesToUpdate.insert(track->getRelease());
+	if (release)
+		_releasesToUpdate.insert(release);
+
 	track.modify()->setScanVersion(_scanVersion);
 	track.modify()->setRelease(release);
 	track.modify()->setClusters(clusters);
-	track.modify()->setLastWriteTime(lastWriteTime);
+	track.modify()->setLastWriteTime(result.lastWriteTime);
+	track.modify()->setFileFingerprint(result.fingerprint);
 	track.modify()->setName(title);
 	track.modify()->setDuration(trackInfo->duration);
 	track.modify()->setAddedTime(Wt::WLocalDateTime::currentServerDateTime().toUTC());
@@ -788,186 +1474,569 @@ MediaScanner::scanAudioFile(const std::filesystem::path& file, bool forceScan, S
 	track.modify()->setMBID(trackInfo->musicBrainzRecordID);
 	track.modify()->setFeatures({}); // TODO: only if MBID changed?
 	track.modify()->setHasCover(trackInfo->hasCover);
+	if (trackInfo->embeddedCover)
+		track.modify()->setEmbeddedCover(Track::EmbeddedCover {trackInfo->embeddedCover->offset, trackInfo->embeddedCover->size, trackInfo->embeddedCover->mimeType, trackInfo->embeddedCover->width, trackInfo->embeddedCover->height});
+	else
+		track.modify()->setEmbeddedCover(std::nullopt);
 	track.modify()->setCopyright(trackInfo->copyright);
 	track.modify()->setCopyrightURL(trackInfo->copyrightURL);
 	if (trackInfo->trackReplayGain)
 		track.modify()->setTrackReplayGain(*trackInfo->trackReplayGain);
 	if (trackInfo->albumReplayGain)
 		track.modify()->setReleaseReplayGain(*trackInfo->albumReplayGain);
+
+	if (_trackIndex)
+		(*_trackIndex)[file] = IndexedTrack {track.id(), result.lastWriteTime.toTime_t(), _scanVersion, result.fingerprint.has_value()};
 }
 
 void
-MediaScanner::scanMediaDirectory(const std::filesystem::path& mediaDirectory, bool forceScan, ScanStats& stats)
+MediaScanner::discoverFiles(DiscoveredFiles& discoveredFiles, ScanStats& stats)
 {
-	ScanStepStats stepStats{stats.startTime, ScanProgressStep::ScanningFiles};
-	stepStats.filesToProcess = stats.filesScanned;
+	ScanStepStats stepStats{stats.startTime, ScanProgressStep::DiscoveringFiles};
+	ScopedStepPerfRecorder stepPerfRecorder {stats, stepStats};
 	notifyInProgress(stepStats);
 
-	exploreFilesRecursive(mediaDirectory, [&](std::error_code ec, const std::filesystem::path& path)
+	discoverDirectory(_mediaDirectory, discoveredFiles, stats, stepStats);
+
+	stats.filesScanned = discoveredFiles.getFileCount();
+}
+
+void
+MediaScanner::discoverDirectory(const std::filesystem::path& directory, DiscoveredFiles& discoveredFiles, ScanStats& stats, ScanStepStats& stepStats)
+{
+	if (_abortScan)
+		return;
+
+	_directoryWalker.walk(directory, [&](DirectoryWalker::DirectoryEntries&& entries)
 	{
 		if (_abortScan)
 			return false;
 
-		if (ec)
+		for (const DirectoryWalker::Error& error : entries.errors)
 		{
-			LMS_LOG(DBUPDATER, ERROR) << "Cannot process entry '" << path.string() << "': " << ec.message();
-			stats.errors.emplace_back(ScanError {path, ScanErrorType::CannotReadFile, ec.message()});
+			LMS_LOG(DBUPDATER, ERROR) << "Cannot process entry '" << error.path.string() << "': " << error.ec.message();
+			stats.errors.emplace_back(ScanError {error.path, ScanErrorType::CannotReadFile, error.ec.message()});
+			discoveredFiles.addUnreadablePath(error.path);
 		}
-		else if (isFileSupported(path, _fileExtensions))
+
+		std::vector<std::string> fileNames;
+		for (std::string& fileName : entries.fileNames)
 		{
-			scanAudioFile(path, forceScan, stats );
+			if (isFileSupported(fileName, _fileExtensions))
+				fileNames.push_back(std::move(fileName));
+		}
 
-			stepStats.processedFiles++;
-			notifyInProgressIfNeeded(stepStats);
+		// The last write time has been taken before listing the entries: any later change will be seen by the next scan
+		std::optional<DirectoryFingerprint> fingerprint;
+		if (entries.lastWriteTime && entries.errors.empty())
+		{
+			std::vector<std::string> childrenNames;
+			childrenNames.reserve(fileNames.size() + entries.subDirectoryNames.size());
+			childrenNames.insert(std::end(childrenNames), std::cbegin(fileNames), std::cend(fileNames));
+			childrenNames.insert(std::end(childrenNames), std::cbegin(entries.subDirectoryNames), std::cend(entries.subDirectoryNames));
+
+			fingerprint = DirectoryFingerprint {*entries.lastWriteTime, entries.entryCount, computeChildrenHash(childrenNames)};
 		}
 
+		discoveredFiles.addDirectory(entries.directory, fingerprint, fileNames);
+
+		stepStats.processedFiles += fileNames.size();
+		notifyInProgressIfNeeded(stepStats);
+
 		return true;
 	});
+
+	// Directories are walked in parallel: restore the depth first order
+	discoveredFiles.sortDirectories();
 }
 
-// Check if a file exists and is still in a media directory
-static bool
-checkFile(const std::filesystem::path& p, const std::filesystem::path& mediaDirectory, const std::unordered_set<std::filesystem::path>& extensions)
+void
+MediaScanner::scanMediaDirectory(const DiscoveredFiles& discoveredFiles, bool forceScan, ScanStats& stats)
 {
-	try
+	ScanStepStats stepStats{stats.startTime, ScanProgressStep::ScanningFiles};
+	ScopedStepPerfRecorder stepPerfRecorder {stats, stepStats};
+	stepStats.filesToProcess = stats.filesScanned;
+	notifyInProgress(stepStats);
+
+	loadDirectoryFingerprints();
+	if (!forceScan || _scanNewestFirst || !_resumeLastDirectory.empty())
+		loadTrackIndex();
+
+	findResumedDirectories(discoveredFiles);
+
+	// Files of the resumed directories are all indexed, not new
+	if (_scanNewestFirst)
+		scanNewFiles(discoveredFiles, stats, stepStats);
+
+	scanDiscoveredFiles(discoveredFiles, forceScan, stats, stepStats);
+
+	writeParsedFiles(stats, stepStats);
+
+	// Only save fingerprints once all the files are written: an aborted scan must not hide unscanned files
+	if (!_abortScan)
+		saveDirectoryFingerprints(discoveredFiles, stats);
+
+	_directoryFingerprints.clear();
+	_trackIndex.reset();
+	_resumedDirectories.clear();
+	_newFilesScanned.clear();
+}
+
+void
+MediaScanner::scanNewFiles(const DiscoveredFiles& discoveredFiles, ScanStats& stats, ScanStepStats& stepStats)
+{
+	// Nothing indexed yet: all the files are new anyway
+	if (_trackIndex->empty())
+		return;
+
+	for (const DiscoveredFiles::Directory& directory : discoveredFiles.getDirectories())
 	{
-		// For each track, make sure the the file still exists
-		// and still belongs to a media directory
-		if (!std::filesystem::exists( p )
-			|| !std::filesystem::is_regular_file( p ) )
+		for (std::size_t i {}; i < directory.fileCount; ++i)
 		{
-			LMS_LOG(DBUPDATER, INFO) << "Removing '" << p.string() << "': missing";
-			return false;
+			if (_abortScan)
+				return;
+
+			std::filesystem::path file {directory.path / discoveredFiles.getFileName(directory, i)};
+			if (_trackIndex->find(file) != std::cend(*_trackIndex))
+				continue;
+
+			scanAudioFile(file, false, stats, stepStats);
+			_newFilesScanned.insert(std::move(file));
+			notifyInProgressIfNeeded(stepStats);
 		}
+	}
 
-		if (!isPathInParentPath(p, mediaDirectory))
+	// Make them available before scanning the other files
+	writeParsedFiles(stats, stepStats);
+
+	LMS_LOG(DBUPDATER, DEBUG) << "Scanned " << _newFilesScanned.size() << " new file(s) first";
+}
+
+void
+MediaScanner::scanDiscoveredFiles(const DiscoveredFiles& discoveredFiles, bool forceScan, ScanStats& stats, ScanStepStats& stepStats)
+{
+	auto lastCheckpointTime {std::chrono::steady_clock::now()};
+
+	const std::vector<DiscoveredFiles::Directory>& directories {discoveredFiles.getDirectories()};
+	for (std::size_t directoryIndex {}; directoryIndex < directories.size(); ++directoryIndex)
+	{
+		const DiscoveredFiles::Directory& directory {directories[directoryIndex]};
+
+		if (isWrittenByResumedScan(directoryIndex))
 		{
-			LMS_LOG(DBUPDATER, INFO) << "Removing '" << p.string() << "': out of media directory";
-			return false;
+			stats.skips += directory.fileCount;
+			stepStats.processedFiles += directory.fileCount;
+			notifyInProgressIfNeeded(stepStats);
+			continue;
 		}
 
-		if (!isFileSupported(p, extensions))
+		bool unchanged {};
+		if (!forceScan && _skipUnchangedDirectories && directory.fingerprint)
 		{
-			LMS_LOG(DBUPDATER, INFO) << "Removing '" << p.string() << "': file format no longer handled";
-			return false;
+			auto itFingerprint {_directoryFingerprints.find(directory.path)};
+			unchanged = (itFingerprint != std::cend(_directoryFingerprints) && itFingerprint->second == *directory.fingerprint);
 		}
 
-		return true;
+		if (unchanged)
+		{
+			// No file added, removed or renamed since the last scan: do not even stat them
+			// Files modified in place are missed, hence opt-in
+			stats.skips += directory.fileCount;
+			stepStats.processedFiles += directory.fileCount;
+			notifyInProgressIfNeeded(stepStats);
+			continue;
+		}
+
+		for (std::size_t i {}; i < directory.fileCount; ++i)
+		{
+			if (_abortScan)
+				return;
+
+			const std::filesystem::path file {directory.path / discoveredFiles.getFileName(directory, i)};
+			if (!_newFilesScanned.empty() && _newFilesScanned.find(file) != std::cend(_newFilesScanned))
+				continue;
+
+			scanAudioFile(file, forceScan, stats, stepStats);
+			notifyInProgressIfNeeded(stepStats);
+		}
+
+		if (std::chrono::steady_clock::now() - lastCheckpointTime >= scanCheckpointPeriod)
+		{
+			// The checkpoint must not cover files still being parsed
+			writeParsedFiles(stats, stepStats);
+			if (_abortScan)
+				return;
 
+			saveScanCheckpoint(ScanCheckpoint::Phase::ScanningFiles, directory.path, stats.startTime);
+			lastCheckpointTime = std::chrono::steady_clock::now();
+		}
 	}
-	catch (std::filesystem::filesystem_error& e)
+}
+
+void
+MediaScanner::updateReleaseAggregates()
+{
+	_dbSession.checkUniqueLocked();
+
+	for (const Release::pointer& release : _releasesToUpdate)
+		release.modify()->updateAggregates();
+
+	_releasesToUpdate.clear();
+}
+
+void
+MediaScanner::loadDirectoryFingerprints()
+{
+	_directoryFingerprints.clear();
+
+	auto transaction {_dbSession.createSharedTransaction()};
+
+	for (const Directory::pointer& directory : Directory::getAll(_dbSession))
 	{
-		LMS_LOG(DBUPDATER, ERROR) << "Caught exception while checking file '" << p.string() << "': " << e.what();
-		return false;
+		// Scan settings changed: all the files must be checked again
+		if (directory->getScanVersion() != _scanVersion)
+			continue;
+
+		_directoryFingerprints.emplace(directory->getPath(), DirectoryFingerprint {directory->getLastWriteTime(), directory->getEntryCount(), directory->getChildrenHash()});
 	}
+
+	LMS_LOG(DBUPDATER, DEBUG) << "Loaded " << _directoryFingerprints.size() << " directory fingerprint(s)";
 }
 
 void
-MediaScanner::removeMissingTracks(ScanStats& stats)
+MediaScanner::loadTrackIndex()
 {
-	static constexpr std::size_t batchSize {50};
+	_trackIndex.emplace();
 
-	ScanStepStats stepStats{stats.startTime, ScanProgressStep::ChekingForMissingFiles};
+	auto transaction {_dbSession.createSharedTransaction()};
+
+	_trackIndex->reserve(Track::getCount(_dbSession));
+	Track::visitAllFileInfos(_dbSession, [&](const Track::FileInfo& fileInfo)
+	{
+		_trackIndex->emplace(fileInfo.path, IndexedTrack {fileInfo.id, fileInfo.lastWriteTime.toTime_t(), fileInfo.scanVersion, fileInfo.fingerprint.has_value()});
+	});
 
-	LMS_LOG(DBUPDATER, DEBUG) << "Checking tracks to be removed...";
-	std::size_t trackCount {};
+	LMS_LOG(DBUPDATER, DEBUG) << "Loaded " << _trackIndex->size() << " track(s) in index";
+}
 
+std::optional<MediaScanner::IndexedTrack>
+MediaScanner::getIndexedTrack(const std::filesystem::path& file)
+{
+	if (_trackIndex)
 	{
-		auto transaction {_dbSession.createSharedTransaction()};
-		trackCount = Track::getCount(_dbSession);
+		auto itIndexedTrack {_trackIndex->find(file)};
+		if (itIndexedTrack == std::cend(*_trackIndex))
+			return std::nullopt;
+
+		return itIndexedTrack->second;
 	}
-	LMS_LOG(DBUPDATER, DEBUG) << trackCount << " tracks to be checked...";
 
-	stepStats.filesToProcess = trackCount;
-	notifyInProgress(stepStats);
+	// No index loaded, ask the database
+	auto transaction {_dbSession.createSharedTransaction()};
 
-	std::vector<std::pair<Database::IdType, std::filesystem::path>> trackPaths;
-	std::vector<IdType> tracksToRemove;
+	const Track::pointer track {Track::getByPath(_dbSession, file)};
+	if (!track)
+		return std::nullopt;
+
+	return IndexedTrack {track.id(), track->getLastWriteTime().toTime_t(), track->getScanVersion(), track->getFileFingerprint().has_value()};
+}
 
-	for (std::size_t i {trackCount < batchSize ? 0 : trackCount - batchSize}; ; i -= (i > batchSize ? batchSize : i))
+void
+MediaScanner::saveDirectoryFingerprints(const DiscoveredFiles& discoveredFiles, const ScanStats& stats)
+{
+	std::unordered_map<std::filesystem::path, DirectoryFingerprint> fingerprints;
+	const std::vector<DiscoveredFiles::Directory>& directories {discoveredFiles.getDirectories()};
+	for (std::size_t directoryIndex {}; directoryIndex < directories.size(); ++directoryIndex)
 	{
-		trackPaths.clear();
-		tracksToRemove.clear();
+		// Directories written by the aborted scan may have changed since: their files have to be checked again next time
+		const DiscoveredFiles::Directory& directory {directories[directoryIndex]};
+		if (directory.fingerprint && !isWrittenByResumedScan(directoryIndex))
+			fingerprints.emplace(directory.path, *directory.fingerprint);
+	}
+
+	// Directories with failed files have to be fully scanned again next time
+	for (const ScanError& error : stats.errors)
+		fingerprints.erase(error.file.parent_path());
 
+	auto uniqueTransaction {_dbSession.createUniqueTransaction()};
+
+	for (Directory::pointer& directory : Directory::getAll(_dbSession))
+	{
+		auto itFingerprint {fingerprints.find(directory->getPath())};
+		if (itFingerprint == std::cend(fingerprints))
 		{
-			auto transaction {_dbSession.createSharedTransaction()};
-			trackPaths = Track::getAllPaths(_dbSession, i, batchSize);
+			directory.remove();
+			continue;
 		}
 
-		for (const auto& [trackId, trackPath] : trackPaths)
+		const DirectoryFingerprint& fingerprint {itFingerprint->second};
+		const DirectoryFingerprint storedFingerprint {directory->getLastWriteTime(), directory->getEntryCount(), directory->getChildrenHash()};
+		if (directory->getScanVersion() != _scanVersion || storedFingerprint != fingerprint)
 		{
-			if (_abortScan)
-				return;
+			directory.modify()->setLastWriteTime(fingerprint.lastWriteTime);
+			directory.modify()->setEntryCount(fingerprint.entryCount);
+			directory.modify()->setChildrenHash(fingerprint.childrenHash);
+			directory.modify()->setScanVersion(_scanVersion);
+		}
 
-			if (!checkFile(trackPath, _mediaDirectory, _fileExtensions))
-				tracksToRemove.push_back(trackId);
+		fingerprints.erase(itFingerprint);
+	}
 
-			stepStats.processedFiles++;
-		}
+	for (const auto& [path, fingerprint] : fingerprints)
+	{
+		Directory::pointer directory {Directory::create(_dbSession, path)};
+		directory.modify()->setLastWriteTime(fingerprint.lastWriteTime);
+		directory.modify()->setEntryCount(fingerprint.entryCount);
+		directory.modify()->setChildrenHash(fingerprint.childrenHash);
+		directory.modify()->setScanVersion(_scanVersion);
+	}
+}
 
-		if (!tracksToRemove.empty())
-		{
-			auto transaction {_dbSession.createUniqueTransaction()};
+ScanCheckpoint::Phase
+MediaScanner::loadScanCheckpoint(bool& forceScan, const Wt::WDateTime& scanStartTime)
+{
+	_resumeLastDirectory.clear();
+	_resumeScanStartTime = {};
 
-			for (const IdType trackId : tracksToRemove)
-			{
-				Track::pointer track {Track::getById(_dbSession, trackId)};
-				if (track)
-				{
-					track.remove();
-					stats.deletions++;
-				}
-			}
-		}
+	auto uniqueTransaction {_dbSession.createUniqueTransaction()};
 
-		notifyInProgressIfNeeded(stepStats);
+	ScanCheckpoint::pointer checkpoint {ScanCheckpoint::get(_dbSession)};
+	if (checkpoint
+			&& checkpoint->getScanVersion() == _scanVersion
+			&& checkpoint->getMediaDirectory() == _mediaDirectory
+			&& (checkpoint->isForceScan() || !forceScan))
+	{
+		// An aborted force scan is still resumed as a force scan
+		forceScan = checkpoint->isForceScan();
+		_resumeLastDirectory = checkpoint->getLastDirectory();
+		_resumeScanStartTime = checkpoint->getScanStartTime();
 
-		if (i == 0)
-			break;
+		LMS_LOG(DBUPDATER, INFO) << "Resuming previous scan, force scan = " << forceScan << ", last written directory = '" << _resumeLastDirectory.string() << "', started at " << _resumeScanStartTime.toString();
+		return checkpoint->getPhase();
 	}
 
-	LMS_LOG(DBUPDATER, DEBUG) << trackCount << " tracks checked!";
+	// Outdated or not thorough enough: start over
+	if (checkpoint)
+		checkpoint.remove();
+
+	checkpoint = ScanCheckpoint::create(_dbSession);
+	checkpoint.modify()->setScanVersion(_scanVersion);
+	checkpoint.modify()->setMediaDirectory(_mediaDirectory);
+	checkpoint.modify()->setForceScan(forceScan);
+	checkpoint.modify()->setScanStartTime(scanStartTime);
+
+	return ScanCheckpoint::Phase::ScanningFiles;
+}
+
+void
+MediaScanner::saveScanCheckpoint(ScanCheckpoint::Phase phase, const std::filesystem::path& lastDirectory, const Wt::WDateTime& scanStartTime)
+{
+	auto uniqueTransaction {_dbSession.createUniqueTransaction()};
+
+	ScanCheckpoint::pointer checkpoint {ScanCheckpoint::get(_dbSession)};
+	if (!checkpoint)
+		return;
+
+	checkpoint.modify()->setPhase(phase);
+	checkpoint.modify()->setLastDirectory(lastDirectory);
+	// Everything up to lastDirectory has been checked by this scan, whatever the resumed one did
+	checkpoint.modify()->setScanStartTime(scanStartTime);
+
+	LMS_LOG(DBUPDATER, DEBUG) << "Saved scan checkpoint, last written directory = '" << lastDirectory.string() << "'";
 }
 
 void
-MediaScanner::removeOrphanEntries()
+MediaScanner::removeScanCheckpoint()
 {
-	LMS_LOG(DBUPDATER, DEBUG) << "Checking orphan clusters...";
+	auto uniqueTransaction {_dbSession.createUniqueTransaction()};
+
+	ScanCheckpoint::pointer checkpoint {ScanCheckpoint::get(_dbSession)};
+	if (checkpoint)
+		checkpoint.remove();
+}
+
+void
+MediaScanner::findResumedDirectories(const DiscoveredFiles& discoveredFiles)
+{
+	// Directories are scanned in the same order as the aborted scan did
+	_resumedDirectories = discoveredFiles.findWrittenDirectories(_resumeLastDirectory, _resumeScanStartTime,
+			[this](const std::filesystem::path& file) { return _trackIndex && _trackIndex->find(file) != std::cend(*_trackIndex); });
+
+	if (!_resumeLastDirectory.empty())
+		LMS_LOG(DBUPDATER, DEBUG) << std::count(std::cbegin(_resumedDirectories), std::cend(_resumedDirectories), true) << " directories already written by the resumed scan";
+}
+
+bool
+MediaScanner::isWrittenByResumedScan(std::size_t directoryIndex) const
+{
+	return directoryIndex < _resumedDirectories.size() && _resumedDirectories[directoryIndex];
+}
+
+// Check if a file has been discovered and is still in a media directory
+static bool
+checkFile(const std::filesystem::path& p, const std::filesystem::path& mediaDirectory, const std::unordered_set<std::filesystem::path>& extensions, const DiscoveredFiles& discoveredFiles)
+{
+	if (!isPathInParentPath(p, mediaDirectory))
+	{
+		LMS_LOG(DBUPDATER, INFO) << "Removing '" << p.string() << "': out of media directory";
+		return false;
+	}
+
+	if (!isFileSupported(p, extensions))
+	{
+		LMS_LOG(DBUPDATER, INFO) << "Removing '" << p.string() << "': file format no longer handled";
+		return false;
+	}
+
+	// Keep files we could not check
+	if (!discoveredFiles.contains(p) && !discoveredFiles.isUnreadable(p))
 	{
-		auto transaction {_dbSession.createUniqueTransaction()};
+		LMS_LOG(DBUPDATER, INFO) << "Removing '" << p.string() << "': missing";
+		return false;
+	}
+
+	return true;
+}
+
+void
+MediaScanner::findMissingTracks(const DiscoveredFiles& discoveredFiles, ScanStats& stats)
+{
+	// Incomplete discovery: cannot tell which files are missing
+	if (_abortScan)
+		return;
 
-		// Now process orphan Cluster (no track)
-		auto clusters {Cluster::getAllOrphans(_dbSession)};
-		for (auto& cluster : clusters)
+	ScanStepStats stepStats{stats.startTime, ScanProgressStep::ChekingForMissingFiles};
+	ScopedStepPerfRecorder stepPerfRecorder {stats, stepStats};
+
+	LMS_LOG(DBUPDATER, DEBUG) << "Checking for missing tracks...";
+	std::vector<IdType> tracksToRemove;
+
+	{
+		auto transaction {_dbSession.createSharedTransaction()};
+
+		stepStats.filesToProcess = Track::getCount(_dbSession);
+		notifyInProgress(stepStats);
+
+		// Missing tracks are the ones in the database that have not been discovered
+		// Keep the ones that can be recognized: they may have been moved
+		Track::visitAllFileInfos(_dbSession, [&](const Track::FileInfo& fileInfo)
 		{
-			LMS_LOG(DBUPDATER, DEBUG) << "Removing orphan cluster '" << cluster->getName() << "'";
-			cluster.remove();
-		}
+			if (!checkFile(fileInfo.path, _mediaDirectory, _fileExtensions, discoveredFiles))
+			{
+				if (fileInfo.fingerprint)
+					_missingTracks.emplace(fileInfo.fingerprint->contentHash, MissingTrack {fileInfo.id, fileInfo.path, fileInfo.fingerprint->size, fileInfo.scanVersion});
+				else
+					tracksToRemove.push_back(fileInfo.id);
+			}
+
+			stepStats.processedFiles++;
+			notifyInProgressIfNeeded(stepStats);
+		});
+	}
+
+	LMS_LOG(DBUPDATER, DEBUG) << stepStats.processedFiles << " tracks checked, " << tracksToRemove.size() << " to be removed, " << _missingTracks.size() << " to be removed if not moved";
+
+	removeTracks(tracksToRemove, stats);
+}
+
+std::optional<MediaScanner::MissingTrack>
+MediaScanner::popMissingTrack(const Track::FileFingerprint& fingerprint)
+{
+	auto [itBegin, itEnd] {_missingTracks.equal_range(fingerprint.contentHash)};
+	for (auto it {itBegin}; it != itEnd; ++it)
+	{
+		if (it->second.size != fingerprint.size)
+			continue;
+
+		MissingTrack missingTrack {std::move(it->second)};
+		_missingTracks.erase(it);
+
+		return missingTrack;
 	}
 
-	LMS_LOG(DBUPDATER, DEBUG) << "Checking orphan artists...";
+	return std::nullopt;
+}
+
+void
+MediaScanner::removeMissingTracks(ScanStats& stats)
+{
+	std::vector<IdType> tracksToRemove;
+	tracksToRemove.reserve(_missingTracks.size());
+	for (const auto& [contentHash, missingTrack] : _missingTracks)
+		tracksToRemove.push_back(missingTrack.id);
+
+	_missingTracks.clear();
+
+	// Aborted scan: they may have been moved in a place that has not been scanned yet
+	if (_abortScan)
+		return;
+
+	LMS_LOG(DBUPDATER, DEBUG) << tracksToRemove.size() << " missing track(s) not found elsewhere";
+	removeTracks(tracksToRemove, stats);
+}
+
+void
+MediaScanner::removeTracks(const std::vector<IdType>& trackIds, ScanStats& stats)
+{
+	static constexpr std::size_t batchSize {1000};
+
+	for (std::size_t offset {}; offset < trackIds.size(); offset += batchSize)
 	{
-		auto transaction {_dbSession.createUniqueTransaction()};
+		if (_abortScan)
+			return;
+
+		const std::size_t count {std::min(batchSize, trackIds.size() - offset)};
 
-		auto artists {Artist::getAllOrphans(_dbSession)};
-		for (auto& artist : artists)
 		{
-			LMS_LOG(DBUPDATER, DEBUG) << "Removing orphan artist '" << artist->getName() << "'";
-			artist.remove();
+			auto transaction {_dbSession.createUniqueTransaction()};
+
+			const std::vector<IdType> batchTrackIds(std::cbegin(trackIds) + offset, std::cbegin(trackIds) + offset + count);
+			const std::vector<IdType> releaseIds {Release::getIdsByTracks(_dbSession, batchTrackIds)};
+
+			Track::removeByIds(_dbSession, batchTrackIds);
+
+			// Releases left without tracks are removed later on, along with the other orphans
+			for (const IdType releaseId : releaseIds)
+			{
+				if (Release::pointer release {Release::getById(_dbSession, releaseId)})
+					release.modify()->updateAggregates();
+			}
 		}
+
+		stats.deletions += count;
 	}
+}
+
+void
+MediaScanner::removeOrphanEntries(ScanStats& stats)
+{
+	// Cached entities may be removed
+	_entityCache.clear();
 
-	LMS_LOG(DBUPDATER, DEBUG) << "Checking orphan releases...";
+	ScanStepStats stepStats{stats.startTime, ScanProgressStep::RemovingOrphanEntries};
+	ScopedStepPerfRecorder stepPerfRecorder {stats, stepStats};
+	stepStats.filesToProcess = 3; // clusters, artists and releases
+	notifyInProgress(stepStats);
+
+	auto removeOrphans {[&](const char* entityName, std::size_t (*removeFunc)(Session&))
 	{
-		auto transaction {_dbSession.createUniqueTransaction()};
+		LMS_LOG(DBUPDATER, DEBUG) << "Removing orphan " << entityName << "...";
 
-		auto releases {Release::getAllOrphans(_dbSession)};
-		for (auto& release : releases)
+		std::size_t count;
 		{
-			LMS_LOG(DBUPDATER, DEBUG) << "Removing orphan release '" << release->getName() << "'";
-			release.remove();
+			auto transaction {_dbSession.createUniqueTransaction()};
+			count = removeFunc(_dbSession);
 		}
-	}
+
+		LMS_LOG(DBUPDATER, DEBUG) << "Removed " << count << " orphan " << entityName;
+
+		stepStats.processedFiles++;
+		notifyInProgress(stepStats);
+	}};
+
+	removeOrphans("clusters", &Cluster::removeAllOrphans);
+	removeOrphans("artists", &Artist::removeAllOrphans);
+	removeOrphans("releases", &Release::removeAllOrphans);
 
 	LMS_LOG(DBUPDATER, INFO) << "Check audio files done!";
 }
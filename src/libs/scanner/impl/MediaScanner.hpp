@@ -20,8 +20,14 @@
 #pragma once
 
 #include <chrono>
+#include <cstdint>
+#include <ctime>
 #include <shared_mutex>
 #include <optional>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 #include <Wt/WDateTime.h>
 #include <Wt/WIOService.h>
@@ -30,10 +36,21 @@
 #include <boost/asio/system_timer.hpp>
 
 #include "database/Types.hpp"
+#include "database/Release.hpp"
+#include "database/ScanCheckpoint.hpp"
 #include "database/ScanSettings.hpp"
 #include "database/Session.hpp"
+#include "database/Track.hpp"
 #include "metadata/IParser.hpp"
 #include "scanner/IMediaScanner.hpp"
+#include "utils/DirectoryWalker.hpp"
+#include "DiscoveredFiles.hpp"
+#include "EntityCache.hpp"
+#include "ParserPool.hpp"
+#include "ScanThrottler.hpp"
+#ifdef LMS_SUPPORT_INOTIFY
+#include "InotifyWatcher.hpp"
+#endif
 
 class UUID;
 
@@ -62,6 +79,32 @@ class MediaScanner : public IMediaScanner
 
 	private:
 
+		struct IndexedTrack
+		{
+			Database::IdType	id;
+			std::time_t		lastWriteTime;
+			std::size_t		scanVersion;
+			bool			hasFingerprint;
+		};
+
+		// Track whose file has not been discovered: it may have been moved
+		struct MissingTrack
+		{
+			Database::IdType	id;
+			std::filesystem::path	path;
+			std::uint64_t		size;
+			std::size_t		scanVersion;
+		};
+
+		// Update of the file related info only, without parsing the file
+		struct TrackFileUpdate
+		{
+			Database::IdType			id;
+			std::filesystem::path			file;
+			Wt::WDateTime				lastWriteTime;
+			Database::Track::FileFingerprint	fingerprint;
+		};
+
 		void start();
 		void stop();
 
@@ -70,23 +113,55 @@ class MediaScanner : public IMediaScanner
 		void scheduleScan(bool force, const Wt::WDateTime& dateTime = {});
 
 		void abortScan();
+		void stopScanThread();	// _controlMutex must be held
+		void startScanThread();	// _controlMutex must be held
 
 		// Update database (scheduled callback)
 		void scan(bool force);
-
-		void scanMediaDirectory( const std::filesystem::path& mediaDirectory, bool forceScan, ScanStats& stats);
-		bool fetchTrackFeatures(Database::IdType trackId, const UUID& MBID);
+		void finishScan(ScanStats& stats);
+
+		// Watched changes handling
+		void restartWatcher();
+		void onWatchedChange(const std::filesystem::path& path);
+		void scheduleWatchedChangesScan();
+		void scanWatchedChanges();
+
+		void discoverFiles(DiscoveredFiles& discoveredFiles, ScanStats& stats);
+		void discoverDirectory(const std::filesystem::path& directory, DiscoveredFiles& discoveredFiles, ScanStats& stats, ScanStepStats& stepStats);
+		void scanMediaDirectory(const DiscoveredFiles& discoveredFiles, bool forceScan, ScanStats& stats);
+		void scanNewFiles(const DiscoveredFiles& discoveredFiles, ScanStats& stats, ScanStepStats& stepStats);
+		void scanDiscoveredFiles(const DiscoveredFiles& discoveredFiles, bool forceScan, ScanStats& stats, ScanStepStats& stepStats);
 		void fetchTrackFeatures(ScanStats& stats);
 
 		// Helpers
+		std::unique_ptr<ParserPool> createParserPool();
 		void refreshScanSettings();
+		void applyScannerPriority();
 
-		void countAllFiles(ScanStats& stats);
+		void findMissingTracks(const DiscoveredFiles& discoveredFiles, ScanStats& stats);
 		void removeMissingTracks(ScanStats& stats);
-		void removeOrphanEntries();
+		std::optional<MissingTrack> popMissingTrack(const Database::Track::FileFingerprint& fingerprint);
+		void removeTracks(const std::vector<Database::IdType>& trackIds, ScanStats& stats);
+		void removeOrphanEntries(ScanStats& stats);
 		void checkDuplicatedAudioFiles(ScanStats& stats);
-		void scanAudioFile(const std::filesystem::path& file, bool forceScan, ScanStats& stats);
-		Database::IdType doScanAudioFile(const std::filesystem::path& file, ScanStats& stats);
+		void findMissingTracks(const std::filesystem::path& path, ScanStats& stats);
+		void scanAudioFile(const std::filesystem::path& file, bool forceScan, ScanStats& stats, ScanStepStats& stepStats);
+		void writeParsedFiles(ScanStats& stats, ScanStepStats& stepStats);
+		void processNextParseResult(ScanStats& stats, ScanStepStats& stepStats);
+		void flushWriteBatch(ScanStats& stats);
+		void queueTrackFileUpdate(const TrackFileUpdate& update, ScanStats& stats);
+		void flushTrackFileUpdates(ScanStats& stats);
+		void writeTrack(const ParserPool::Result& result, ScanStats& stats);
+		void updateReleaseAggregates();
+		void loadDirectoryFingerprints();
+		void loadTrackIndex();
+		std::optional<IndexedTrack> getIndexedTrack(const std::filesystem::path& file);
+		void saveDirectoryFingerprints(const DiscoveredFiles& discoveredFiles, const ScanStats& stats);
+		Database::ScanCheckpoint::Phase loadScanCheckpoint(bool& forceScan, const Wt::WDateTime& scanStartTime);
+		void saveScanCheckpoint(Database::ScanCheckpoint::Phase phase, const std::filesystem::path& lastDirectory, const Wt::WDateTime& scanStartTime);
+		void removeScanCheckpoint();
+		void findResumedDirectories(const DiscoveredFiles& discoveredFiles);
+		bool isWrittenByResumedScan(std::size_t directoryIndex) const;
 		void notifyInProgressIfNeeded(const ScanStepStats& stats);
 		void notifyInProgress(const ScanStepStats& stats);
 
@@ -100,7 +175,21 @@ class MediaScanner : public IMediaScanner
 		std::chrono::system_clock::time_point	_lastScanInProgressEmit {};
 		Wt::Signal<Wt::WDateTime>				_sigScheduled;
 		Database::Session						_dbSession;
-		std::unique_ptr<MetaData::IParser>		_metadataParser;
+		std::unique_ptr<ParserPool>			_parserPool;
+		std::vector<ParserPool::Result>			_writeBatch;
+		std::chrono::steady_clock::time_point		_writeBatchStartTime;
+		std::vector<TrackFileUpdate>			_trackFileUpdates;	// written before the parsed files
+		std::unordered_multimap<std::uint64_t, MissingTrack>	_missingTracks;	// by content hash, removed at the end of the scan if not moved
+		std::unordered_map<std::filesystem::path, DirectoryFingerprint>	_directoryFingerprints;		// from the last scan, using the current scan version
+		std::optional<std::unordered_map<std::filesystem::path, IndexedTrack>>	_trackIndex;	// only loaded during incremental full scans
+		DirectoryWalker					_directoryWalker;
+		ScanThrottler					_scanThrottler;
+		EntityCache					_entityCache;	// entities resolved during the current scan
+		std::filesystem::path				_resumeLastDirectory;	// files up to this directory were written by an aborted scan
+		Wt::WDateTime					_resumeScanStartTime;	// directories modified since then have to be scanned again
+		std::vector<bool>				_resumedDirectories;	// discovered directories written by the aborted scan
+		std::unordered_set<std::filesystem::path>	_newFilesScanned;	// already scanned before the other files
+		std::set<Database::Release::pointer>		_releasesToUpdate;	// touched in the current write transaction
 
 		mutable std::shared_mutex			_statusMutex;
 		State								_curState {State::NotScheduled};
@@ -108,6 +197,16 @@ class MediaScanner : public IMediaScanner
 		std::optional<ScanStepStats> 		_currentScanStepStats;
 		Wt::WDateTime						_nextScheduledScan;
 
+		// Watched changes
+		const bool				_watchEnabled;
+		const std::chrono::seconds		_watchDebounceDelay;
+		boost::asio::system_timer		_watchTimer {_ioService};
+		std::set<std::filesystem::path>		_watchedChanges;
+		std::optional<std::chrono::steady_clock::time_point>	_watchedChangesPendingSince;	// oldest change not scanned yet
+#ifdef LMS_SUPPORT_INOTIFY
+		std::unique_ptr<InotifyWatcher>		_watcher;
+#endif
+
 		// Current scan settings
 		std::size_t				_scanVersion {};
 		Wt::WTime				_startTime;
@@ -115,6 +214,12 @@ class MediaScanner : public IMediaScanner
 		std::unordered_set<std::filesystem::path> _fileExtensions;
 		std::filesystem::path			_mediaDirectory;
 		Database::ScanSettings::RecommendationEngineType _recommendationEngineType;
+		std::size_t				_writeBatchSize {1};
+		std::chrono::milliseconds		_writeBatchMaxDuration {};
+		Database::ScanSettings::ScannerPriority	_scannerPriority {Database::ScanSettings::defaultScannerPriority};
+		bool					_scanNewestFirst {Database::ScanSettings::defaultScanNewestFirst};
+		bool					_skipUnchangedDirectories {Database::ScanSettings::defaultSkipUnchangedDirectories};
+		std::set<std::string>			_clusterTypeNames;
 
 
 }; // class MediaScanner
@@ -19,6 +19,8 @@
 
 #include "scanner/MediaScannerStats.hpp"
 
+#include <algorithm>
+
 namespace Scanner {
 
 ScanError::ScanError(const std::filesystem::path& _file, ScanErrorType _error, const std::string& _systemError)
@@ -43,7 +45,49 @@ ScanStats::nbChanges() const
 unsigned
 ScanStepStats::progress() const
 {
-	return (processedFiles / static_cast<float>(filesToProcess ? filesToProcess : 1)) * 100;
+	// filesToProcess is only an estimation
+	return std::min(100.f, (processedFiles / static_cast<float>(filesToProcess ? filesToProcess : 1)) * 100);
+}
+
+void
+LatencyHistogram::add(std::chrono::microseconds latency)
+{
+	std::size_t bucket {};
+	while (bucket < bucketCount - 1 && latency.count() >= (1LL << bucket))
+		bucket++;
+
+	buckets[bucket]++;
+	count++;
+	total += latency;
+	max = std::max(max, latency);
+}
+
+std::chrono::microseconds
+LatencyHistogram::getAverage() const
+{
+	return count ? total / static_cast<std::chrono::microseconds::rep>(count) : std::chrono::microseconds {};
+}
+
+std::chrono::microseconds
+LatencyHistogram::getPercentile(unsigned percentile) const
+{
+	const std::size_t threshold {(count * std::min(percentile, 100U) + 99) / 100};
+
+	std::size_t cumulatedCount {};
+	for (std::size_t bucket {}; bucket < bucketCount; ++bucket)
+	{
+		cumulatedCount += buckets[bucket];
+		if (cumulatedCount >= threshold && cumulatedCount > 0)
+			return bucket == bucketCount - 1 ? max : std::min(max, std::chrono::microseconds {1LL << bucket});
+	}
+
+	return {};
+}
+
+float
+ScanStepPerfStats::getFilesPerSecond() const
+{
+	return duration.count() ? processedFiles * 1000.f / duration.count() : 0;
 }
 
 } // namespace Scanner
@@ -0,0 +1,201 @@
+/*
+ * Copyright (C) 2020 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ParserPool.hpp"
+
+#include <cassert>
+
+#include "utils/Exception.hpp"
+#include "utils/Logger.hpp"
+#include "FileFingerprint.hpp"
+#include "ThreadPriority.hpp"
+
+namespace Scanner {
+
+ParserPool::ParserPool(std::size_t threadCount, ParserFactory parserFactory, std::size_t maxPendingCount)
+: _maxPendingCount {maxPendingCount}
+{
+	if (threadCount == 0)
+		throw LmsException {"Invalid parser thread count"};
+
+	if (maxPendingCount < threadCount)
+		throw LmsException {"Invalid parser max pending count"};
+
+	LMS_LOG(DBUPDATER, INFO) << "Using " << threadCount << " thread(s) to parse files";
+
+	for (std::size_t i {}; i < threadCount; ++i)
+		_threads.emplace_back(&ParserPool::worker, this, parserFactory());
+}
+
+ParserPool::~ParserPool()
+{
+	{
+		std::unique_lock lock {_mutex};
+		_quit = true;
+	}
+	_jobsCondition.notify_all();
+
+	for (std::thread& thread : _threads)
+		thread.join();
+}
+
+void
+ParserPool::setClusterTypeNames(const std::set<std::string>& clusterTypeNames)
+{
+	std::unique_lock lock {_mutex};
+
+	_clusterTypeNames = clusterTypeNames;
+	_clusterTypeNamesVersion++;
+}
+
+void
+ParserPool::setThreadPriority(Database::ScanSettings::ScannerPriority priority)
+{
+	std::unique_lock lock {_mutex};
+
+	if (_threadPriority == priority)
+		return;
+
+	_threadPriority = priority;
+	_threadPriorityVersion++;
+}
+
+void
+ParserPool::push(const std::filesystem::path& file, const Wt::WDateTime& lastWriteTime)
+{
+	{
+		std::unique_lock lock {_mutex};
+
+		assert(_pendingCount < _maxPendingCount);
+
+		_jobs.push_back(Job {file, lastWriteTime});
+		_pendingCount++;
+	}
+	_jobsCondition.notify_one();
+}
+
+bool
+ParserPool::isFull() const
+{
+	std::unique_lock lock {_mutex};
+
+	return _pendingCount >= _maxPendingCount;
+}
+
+bool
+ParserPool::isEmpty() const
+{
+	std::unique_lock lock {_mutex};
+
+	return _pendingCount == 0;
+}
+
+std::optional<ParserPool::Result>
+ParserPool::popResult()
+{
+	std::unique_lock lock {_mutex};
+
+	if (_pendingCount == 0)
+		return std::nullopt;
+
+	_resultsCondition.wait(lock, [this] { return !_results.empty(); });
+
+	Result result {std::move(_results.front())};
+	_results.pop_front();
+	_pendingCount--;
+
+	return result;
+}
+
+void
+ParserPool::clear()
+{
+	std::unique_lock lock {_mutex};
+
+	_jobs.clear();
+	_resultsCondition.wait(lock, [this] { return _busyCount == 0; });
+
+	_results.clear();
+	_pendingCount = 0;
+}
+
+void
+ParserPool::worker(std::unique_ptr<MetaData::IParser> parser)
+{
+	std::size_t clusterTypeNamesVersion {};
+	std::size_t threadPriorityVersion {};
+
+	while (true)
+	{
+		Job job;
+
+		{
+			std::unique_lock lock {_mutex};
+
+			_jobsCondition.wait(lock, [this] { return _quit || !_jobs.empty(); });
+			if (_quit)
+				return;
+
+			job = std::move(_jobs.front());
+			_jobs.pop_front();
+			_busyCount++;
+
+			if (clusterTypeNamesVersion != _clusterTypeNamesVersion)
+			{
+				parser->setClusterTypeNames(_clusterTypeNames);
+				clusterTypeNamesVersion = _clusterTypeNamesVersion;
+			}
+
+			if (threadPriorityVersion != _threadPriorityVersion)
+			{
+				setCurrentThreadPriority(_threadPriority);
+				threadPriorityVersion = _threadPriorityVersion;
+			}
+		}
+
+		const auto parseStart {std::chrono::steady_clock::now()};
+
+		std::optional<MetaData::Track> track;
+		try
+		{
+			track = parser->parse(job.file);
+		}
+		catch (std::exception& e)
+		{
+			LMS_LOG(DBUPDATER, ERROR) << "Caught exception while parsing file '" << job.file.string() << "': " << e.what();
+		}
+
+		const auto parseDuration {std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - parseStart)};
+
+		std::optional<Database::Track::FileFingerprint> fingerprint;
+		if (track)
+			fingerprint = computeFileFingerprint(job.file);
+
+		{
+			std::unique_lock lock {_mutex};
+
+			_results.push_back(Result {std::move(job.file), job.lastWriteTime, std::move(track), fingerprint, parseDuration});
+			_busyCount--;
+		}
+		_resultsCondition.notify_all();
+	}
+}
+
+} // namespace Scanner
+
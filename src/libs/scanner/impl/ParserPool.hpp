@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2020 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <Wt/WDateTime.h>
+
+#include "database/ScanSettings.hpp"
+#include "database/Track.hpp"
+#include "metadata/IParser.hpp"
+
+namespace Scanner {
+
+// Parses audio files using a pool of worker threads
+// Parsed results are consumed by a single thread, using popResult
+// The number of files pushed and not yet consumed is bounded by maxPendingCount
+class ParserPool
+{
+	public:
+		using ParserFactory = std::function<std::unique_ptr<MetaData::IParser>()>;
+
+		struct Result
+		{
+			std::filesystem::path		file;
+			Wt::WDateTime			lastWriteTime;
+			std::optional<MetaData::Track>	track;	// not set if parsing failed
+			std::optional<Database::Track::FileFingerprint>	fingerprint;	// not set if the file cannot be read
+			std::chrono::microseconds	parseDuration {};
+		};
+
+		ParserPool(std::size_t threadCount, ParserFactory parserFactory, std::size_t maxPendingCount);
+		~ParserPool();
+
+		ParserPool(const ParserPool&) = delete;
+		ParserPool(ParserPool&&) = delete;
+		ParserPool& operator=(const ParserPool&) = delete;
+		ParserPool& operator=(ParserPool&&) = delete;
+
+		std::size_t getThreadCount() const { return _threads.size(); }
+
+		void setClusterTypeNames(const std::set<std::string>& clusterTypeNames);
+		void setThreadPriority(Database::ScanSettings::ScannerPriority priority); // applied by each worker on its next job
+
+		// Caller must make sure the pool is not full before pushing
+		void push(const std::filesystem::path& file, const Wt::WDateTime& lastWriteTime);
+		bool isFull() const;
+		bool isEmpty() const; // nothing pending
+
+		// Wait for the next parsed file
+		// Returns std::nullopt if there is nothing pending
+		std::optional<Result> popResult();
+
+		// Drop pending jobs and results, wait for the jobs in progress to complete
+		void clear();
+
+	private:
+		struct Job
+		{
+			std::filesystem::path	file;
+			Wt::WDateTime		lastWriteTime;
+		};
+
+		void worker(std::unique_ptr<MetaData::IParser> parser);
+
+		const std::size_t		_maxPendingCount;
+
+		mutable std::mutex		_mutex;
+		std::condition_variable		_jobsCondition;
+		std::condition_variable		_resultsCondition;
+		bool				_quit {};
+		std::deque<Job>			_jobs;
+		std::deque<Result>		_results;
+		std::size_t			_pendingCount {};	// pushed but not popped yet
+		std::size_t			_busyCount {};		// jobs being parsed right now
+		std::set<std::string>		_clusterTypeNames;
+		std::size_t			_clusterTypeNamesVersion {};
+		Database::ScanSettings::ScannerPriority	_threadPriority {Database::ScanSettings::ScannerPriority::Normal};
+		std::size_t			_threadPriorityVersion {};
+		std::vector<std::thread>	_threads;
+};
+
+} // namespace Scanner
+
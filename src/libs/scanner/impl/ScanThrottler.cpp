@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2020 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "ScanThrottler.hpp"
+
+#include <algorithm>
+#include <thread>
+
+#include "utils/Logger.hpp"
+#include "utils/StreamingActivity.hpp"
+
+namespace Scanner {
+
+namespace {
+
+// Short enough to react quickly to aborts and to the end of the streams
+constexpr std::chrono::milliseconds maxSleepDuration {100};
+
+}
+
+void
+ScanThrottler::waitForNextFile(const std::atomic<bool>& abort)
+{
+	while (true)
+	{
+		const std::size_t maxFilesPerSecond {getCurrentMaxFilesPerSecond()};
+		const auto now {std::chrono::steady_clock::now()};
+
+		if (maxFilesPerSecond == 0 || abort)
+		{
+			_lastFileTime = now;
+			return;
+		}
+
+		const auto nextFileTime {_lastFileTime + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::seconds {1}) / maxFilesPerSecond};
+		if (now >= nextFileTime)
+		{
+			_lastFileTime = now;
+			return;
+		}
+
+		std::this_thread::sleep_for(std::min<std::chrono::steady_clock::duration>(nextFileTime - now, maxSleepDuration));
+	}
+}
+
+std::size_t
+ScanThrottler::getCurrentMaxFilesPerSecond()
+{
+	const bool backOff {_backOffWhenStreaming && StreamingActivity::isActive()};
+	if (backOff != _backingOff)
+	{
+		LMS_LOG(DBUPDATER, DEBUG) << (backOff ? "Streaming in progress, slowing down scan" : "No more streaming, resuming scan at full speed");
+		_backingOff = backOff;
+	}
+
+	if (!backOff)
+		return _maxFilesPerSecond;
+
+	return _maxFilesPerSecond == 0 ? backOffMaxFilesPerSecond : std::min(_maxFilesPerSecond, backOffMaxFilesPerSecond);
+}
+
+} // namespace Scanner
+
@@ -0,0 +1,53 @@
+/*
+ * Copyright (C) 2020 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+
+namespace Scanner {
+
+// Paces the files read by the scanner
+// While audio is being streamed or downloaded, the scanner may back off to a few files per second
+class ScanThrottler
+{
+	public:
+		static inline constexpr std::size_t backOffMaxFilesPerSecond {5};
+
+		void setMaxFilesPerSecond(std::size_t maxFilesPerSecond) { _maxFilesPerSecond = maxFilesPerSecond; } // 0 means unlimited
+		void setBackOffWhenStreaming(bool backOff) { _backOffWhenStreaming = backOff; }
+
+		// Wait until the next file can be read
+		// Returns as soon as abort is set
+		void waitForNextFile(const std::atomic<bool>& abort);
+
+	private:
+		std::size_t getCurrentMaxFilesPerSecond();
+
+		std::size_t				_maxFilesPerSecond {};
+		bool					_backOffWhenStreaming {};
+		bool					_backingOff {};
+		std::chrono::steady_clock::time_point	_lastFileTime {};
+};
+
+} // namespace Scanner
+
@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2020 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "ThreadPriority.hpp"
+
+#ifdef LMS_SUPPORT_THREAD_PRIORITY
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#endif
+
+#include "utils/Logger.hpp"
+
+namespace Scanner {
+
+#ifdef LMS_SUPPORT_THREAD_PRIORITY
+namespace {
+
+// From linux/ioprio.h, not exposed by the libc
+constexpr int ioPrioClassShift {13};
+constexpr int ioPrioClassNone {0};
+constexpr int ioPrioClassBestEffort {2};
+constexpr int ioPrioClassIdle {3};
+constexpr int ioPrioWhoProcess {1};	// a single thread, on Linux
+
+constexpr int lowestNiceValue {19};
+
+pid_t
+getCurrentThreadId()
+{
+	return static_cast<pid_t>(::syscall(SYS_gettid));
+}
+
+// Nice value of the process when the scanner started, used for the normal priority
+int
+getInitialNiceValue()
+{
+	static const int niceValue {::getpriority(PRIO_PROCESS, getCurrentThreadId())};
+	return niceValue;
+}
+
+void
+setNiceValue(int niceValue)
+{
+	const pid_t threadId {getCurrentThreadId()};
+
+	errno = 0;
+	const int currentNiceValue {::getpriority(PRIO_PROCESS, threadId)};
+	if (errno == 0 && currentNiceValue == niceValue)
+		return;
+
+	if (::setpriority(PRIO_PROCESS, threadId, niceValue) != 0)
+		LMS_LOG(DBUPDATER, WARNING) << "Cannot set scanner thread nice value to " << niceValue << ": " << std::strerror(errno);
+}
+
+void
+setIoPriority(int ioClass, int ioLevel)
+{
+	if (::syscall(SYS_ioprio_set, ioPrioWhoProcess, getCurrentThreadId(), (ioClass << ioPrioClassShift) | ioLevel) != 0)
+		LMS_LOG(DBUPDATER, WARNING) << "Cannot set scanner thread I/O priority: " << std::strerror(errno);
+}
+
+} // namespace
+#endif
+
+void
+setCurrentThreadPriority(Database::ScanSettings::ScannerPriority priority)
+{
+	using ScannerPriority = Database::ScanSettings::ScannerPriority;
+
+#ifdef LMS_SUPPORT_THREAD_PRIORITY
+	const int initialNiceValue {getInitialNiceValue()};
+
+	switch (priority)
+	{
+		case ScannerPriority::Normal:
+			setNiceValue(initialNiceValue);
+			setIoPriority(ioPrioClassNone, 0); // derived from the nice value
+			break;
+
+		case ScannerPriority::Low:
+			setNiceValue(lowestNiceValue);
+			setIoPriority(ioPrioClassBestEffort, 7);
+			break;
+
+		case ScannerPriority::Idle:
+			setNiceValue(lowestNiceValue);
+			setIoPriority(ioPrioClassIdle, 0);
+			break;
+	}
+#else
+	if (priority != ScannerPriority::Normal)
+		LMS_LOG(DBUPDATER, DEBUG) << "Scanner thread priority not supported on this platform";
+#endif
+}
+
+} // namespace Scanner
+
@@ -0,0 +1,34 @@
+/*
+ * Copyright (C) 2020 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include "database/ScanSettings.hpp"
+
+namespace Scanner {
+
+// Sets the CPU (nice) and I/O priorities of the calling thread only
+// Threads created afterwards by the calling thread inherit them
+// Without CAP_SYS_NICE, a lowered priority cannot be raised back: use a new thread instead
+// Only supported on Linux, no-op elsewhere
+void setCurrentThreadPriority(Database::ScanSettings::ScannerPriority priority);
+
+} // namespace Scanner
+
@@ -21,6 +21,8 @@
 
 #include <Wt/WDateTime.h>
 
+#include <array>
+#include <chrono>
 #include <filesystem>
 #include <vector>
 
@@ -32,6 +34,7 @@ namespace Scanner {
 		CannotParseFile,	// cannot parse file
 		NoAudioTrack,		// no audio track found
 		BadDuration,		// bad duration
+		CannotUpdateDatabase,	// cannot write file info in database
 	};
 
 	enum class DuplicateReason
@@ -58,12 +61,13 @@ namespace Scanner {
 
 	enum class ScanProgressStep : unsigned
 	{
-		ChekingForMissingFiles = 0,
-		DiscoveringFiles,
+		DiscoveringFiles = 0,
+		ChekingForMissingFiles,
 		ScanningFiles,
+		RemovingOrphanEntries,
 		FetchingTrackFeatures,
 	};
-	static inline constexpr unsigned ScanProgressStepCount {4};
+	static inline constexpr unsigned ScanProgressStepCount {5};
 
 	// reduced scan stats
 	struct ScanStepStats
@@ -78,6 +82,41 @@ namespace Scanner {
 		unsigned		progress() const;
 	};
 
+	// Latencies are stored in power of two buckets (in microseconds)
+	struct LatencyHistogram
+	{
+		static inline constexpr std::size_t bucketCount {24}; // last bucket gets everything above ~8s
+
+		std::array<std::size_t, bucketCount>	buckets {};
+		std::size_t				count {};
+		std::chrono::microseconds		total {};
+		std::chrono::microseconds		max {};
+
+		void				add(std::chrono::microseconds latency);
+		std::chrono::microseconds	getAverage() const;
+		std::chrono::microseconds	getPercentile(unsigned percentile) const; // upper bound of the matching bucket
+	};
+
+	struct ScanStepPerfStats
+	{
+		std::chrono::milliseconds	duration {};	// wall time
+		std::size_t			processedFiles {};
+
+		float		getFilesPerSecond() const;
+	};
+
+	struct ScanPerfStats
+	{
+		std::array<ScanStepPerfStats, ScanProgressStepCount>	steps;
+
+		LatencyHistogram	parseLatency;		// per parsed file
+		LatencyHistogram	dbWriteLatency;		// per write transaction
+		LatencyHistogram	dbLockWaitLatency;	// time spent waiting for the write transactions to start
+
+		const ScanStepPerfStats& getStep(ScanProgressStep step) const { return steps[static_cast<std::size_t>(step)]; }
+		ScanStepPerfStats& getStep(ScanProgressStep step) { return steps[static_cast<std::size_t>(step)]; }
+	};
+
 	struct ScanStats
 	{
 		Wt::WDateTime	startTime;
@@ -97,6 +136,8 @@ namespace Scanner {
 		std::vector<ScanError>		errors;
 		std::vector<ScanDuplicate>	duplicates;
 
+		ScanPerfStats			perf;
+
 		std::size_t	nbFiles() const;
 		std::size_t	nbChanges() const;
 	};
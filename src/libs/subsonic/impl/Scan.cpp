@@ -45,6 +45,39 @@ namespace API::Subsonic::Scan
 			statusResponse.setAttribute("count", count);
 		}
 
+		// Non standard: performance of the last complete scan
+		if (scanStatus.lastCompleteScanStats)
+		{
+			const ScanPerfStats& perf {scanStatus.lastCompleteScanStats->perf};
+
+			for (std::size_t step {}; step < ScanProgressStepCount; ++step)
+			{
+				Response::Node& stepNode {statusResponse.createArrayChild("lmsScanStep")};
+
+				stepNode.setAttribute("step", step + 1);
+				stepNode.setAttribute("durationMs", perf.steps[step].duration.count());
+				stepNode.setAttribute("processedFiles", perf.steps[step].processedFiles);
+				stepNode.setAttribute("filesPerSecond", static_cast<std::size_t>(perf.steps[step].getFilesPerSecond()));
+			}
+
+			auto addLatencyNode {[&](std::string_view name, const LatencyHistogram& histogram)
+			{
+				Response::Node& latencyNode {statusResponse.createArrayChild("lmsScanLatency")};
+
+				latencyNode.setAttribute("name", name);
+				latencyNode.setAttribute("count", histogram.count);
+				latencyNode.setAttribute("averageUs", histogram.getAverage().count());
+				latencyNode.setAttribute("p50Us", histogram.getPercentile(50).count());
+				latencyNode.setAttribute("p95Us", histogram.getPercentile(95).count());
+				latencyNode.setAttribute("p99Us", histogram.getPercentile(99).count());
+				latencyNode.setAttribute("maxUs", histogram.max.count());
+			}};
+
+			addLatencyNode("parse", perf.parseLatency);
+			addLatencyNode("dbWrite", perf.dbWriteLatency);
+			addLatencyNode("dbLockWait", perf.dbLockWaitLatency);
+		}
+
 		return statusResponse;
 	}
 
@@ -239,9 +239,7 @@ getTrackPath(const Track::pointer& track)
 	const auto release {track->getRelease()};
 	if (release)
 	{
-		auto artists {release->getReleaseArtists()};
-		if (artists.empty())
-			artists = release->getArtists();
+		auto artists {release->getPrimaryArtists()};
 
 		if (artists.size() > 1)
 			path = "Various Artists/";
@@ -395,9 +393,7 @@ releaseToResponseNode(const Release::pointer& release, Session& dbSession, const
 	if (releaseYear)
 		albumNode.setAttribute("year", *releaseYear);
 
-	auto artists {release->getReleaseArtists()};
-	if (artists.empty())
-		artists = release->getArtists();
+	auto artists {release->getPrimaryArtists()};
 
 	if (artists.empty() && !id3)
 	{
@@ -1381,7 +1377,7 @@ handleSearchRequestCommon(RequestContext& context, bool id3)
 
 	bool more;
 	{
-		auto artists {Artist::getByFilter(context.dbSession, {}, keywords, std::nullopt, Artist::SortMethod::BySortName, Range {artistOffset, artistCount}, more)};
+		auto artists {Artist::getByFilter(context.dbSession, {}, keywords, std::nullopt, Artist::SortMethod::ByRelevance, Range {artistOffset, artistCount}, more)};
 		for (const Artist::pointer& artist : artists)
 			searchResult2Node.addArrayChild("artist", artistToResponseNode(user, artist, id3));
 	}
@@ -0,0 +1,336 @@
+/*
+ * Copyright (C) 2020 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "utils/DirectoryWalker.hpp"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <thread>
+
+#include "utils/Exception.hpp"
+#include "utils/Logger.hpp"
+
+namespace {
+
+DirectoryWalker::DirectoryEntries
+listEntries(const std::filesystem::path& directory, const struct stat* sb, std::vector<std::string>* symlinkedSubDirectoryNames = nullptr)
+{
+	DirectoryWalker::DirectoryEntries entries;
+	entries.directory = directory;
+	if (sb)
+		entries.lastWriteTime = Wt::WDateTime::fromTime_t(sb->st_mtime);
+
+	std::error_code ec;
+	std::filesystem::directory_iterator itPath {directory, std::filesystem::directory_options::follow_directory_symlink, ec};
+	const std::filesystem::directory_iterator itEnd;
+
+	while (!ec && itPath != itEnd)
+	{
+		const std::filesystem::path& path {itPath->path()};
+		entries.entryCount++;
+
+		std::error_code entryEc;
+		if (itPath->is_regular_file(entryEc))
+			entries.fileNames.push_back(path.filename().string());
+		else if (!entryEc && itPath->is_directory(entryEc))
+		{
+			entries.subDirectoryNames.push_back(path.filename().string());
+			if (symlinkedSubDirectoryNames && itPath->is_symlink(entryEc))
+				symlinkedSubDirectoryNames->push_back(path.filename().string());
+		}
+
+		if (entryEc)
+			entries.errors.push_back(DirectoryWalker::Error {path, entryEc});
+
+		itPath.increment(ec);
+	}
+
+	if (ec)
+		entries.errors.push_back(DirectoryWalker::Error {directory, ec});
+
+	std::sort(std::begin(entries.fileNames), std::end(entries.fileNames));
+	std::sort(std::begin(entries.subDirectoryNames), std::end(entries.subDirectoryNames));
+	if (symlinkedSubDirectoryNames)
+		std::sort(std::begin(*symlinkedSubDirectoryNames), std::end(*symlinkedSubDirectoryNames));
+
+	return entries;
+}
+
+} // namespace
+
+DirectoryWalker::DirectoryWalker(std::size_t threadCount)
+: _threadCount {threadCount}
+, _queues(threadCount)
+{
+	if (threadCount == 0)
+		throw LmsException {"Invalid directory walker thread count"};
+}
+
+DirectoryWalker::DirectoryEntries
+DirectoryWalker::listDirectory(const std::filesystem::path& directory)
+{
+	struct stat sb {};
+	const bool statOk {stat(directory.c_str(), &sb) == 0};
+
+	return listEntries(directory, statOk ? &sb : nullptr);
+}
+
+bool
+DirectoryWalker::walk(const std::filesystem::path& root, const Callback& callback)
+{
+	_stop = false;
+	_queuedCount = 0;
+	_pendingCount = 0;
+	_results.clear();
+	_exploredDirectories.clear();
+	_symlinkedDirectories.clear();
+	for (WorkerQueue& queue : _queues)
+		queue.directories.clear();
+
+	pushDirectory(0, QueuedDirectory {root});
+
+	std::vector<std::thread> threads;
+	for (std::size_t i {}; i < _threadCount; ++i)
+		threads.emplace_back(&DirectoryWalker::worker, this, i);
+
+	auto stopThreads {[&]
+	{
+		{
+			std::unique_lock lock {_mutex};
+			_stop = true;
+		}
+		_workCondition.notify_all();
+
+		for (std::thread& thread : threads)
+			thread.join();
+	}};
+
+	bool complete {true};
+	try
+	{
+		while (true)
+		{
+			std::unique_lock lock {_mutex};
+
+			_resultsCondition.wait(lock, [this] { return !_results.empty() || _pendingCount == 0; });
+			if (_results.empty())
+			{
+				lock.unlock();
+
+				// Nothing left to explore but the directories behind symbolic links
+				if (!pushSymlinkedDirectories())
+					break;
+
+				continue;
+			}
+
+			DirectoryEntries entries {std::move(_results.front())};
+			_results.pop_front();
+			lock.unlock();
+
+			if (!callback(std::move(entries)))
+			{
+				complete = false;
+				break;
+			}
+		}
+	}
+	catch (...)
+	{
+		stopThreads();
+		throw;
+	}
+
+	stopThreads();
+
+	_results.clear();
+	_exploredDirectories.clear();
+	_symlinkedDirectories.clear();
+
+	return complete;
+}
+
+void
+DirectoryWalker::worker(std::size_t index)
+{
+	while (!_stop)
+	{
+		if (std::optional<QueuedDirectory> directory {popDirectory(index)})
+		{
+			explore(index, *directory);
+			continue;
+		}
+
+		// Directories behind symbolic links may be queued once the others are explored
+		std::unique_lock lock {_mutex};
+		_workCondition.wait(lock, [this] { return _stop || _queuedCount > 0; });
+	}
+}
+
+void
+DirectoryWalker::explore(std::size_t index, const QueuedDirectory& directory)
+{
+	struct stat sb {};
+	const bool statOk {stat(directory.path.c_str(), &sb) == 0};
+
+	if (statOk && !directory.claimed)
+	{
+		const DirectoryId id {static_cast<std::uintmax_t>(sb.st_dev), static_cast<std::uintmax_t>(sb.st_ino)};
+
+		std::unique_lock lock {_mutex};
+		if (!_exploredDirectories.insert(id).second)
+		{
+			LMS_LOG(UTILS, INFO) << "Skipping '" << directory.path.string() << "': already explored";
+			lock.unlock();
+
+			onDirectoryDone();
+			return;
+		}
+	}
+
+	std::vector<std::string> symlinkedSubDirectoryNames;
+	DirectoryEntries entries {listEntries(directory.path, statOk ? &sb : nullptr, &symlinkedSubDirectoryNames)};
+
+	// Queue in reverse order so that this thread explores the sub directories in order
+	for (auto it {std::crbegin(entries.subDirectoryNames)}; it != std::crend(entries.subDirectoryNames); ++it)
+	{
+		if (!std::binary_search(std::cbegin(symlinkedSubDirectoryNames), std::cend(symlinkedSubDirectoryNames), *it))
+			pushDirectory(index, QueuedDirectory {directory.path / *it});
+	}
+
+	{
+		std::unique_lock lock {_mutex};
+		for (const std::string& subDirectoryName : symlinkedSubDirectoryNames)
+			_symlinkedDirectories.push_back(directory.path / subDirectoryName);
+
+		_results.push_back(std::move(entries));
+	}
+	_resultsCondition.notify_one();
+
+	onDirectoryDone();
+}
+
+void
+DirectoryWalker::pushDirectory(std::size_t index, QueuedDirectory directory)
+{
+	// Count it first: the walk must not be seen as complete once another thread has explored it
+	{
+		std::unique_lock lock {_mutex};
+		_queuedCount++;
+		_pendingCount++;
+	}
+
+	{
+		std::unique_lock lock {_queues[index].mutex};
+		_queues[index].directories.push_back(std::move(directory));
+	}
+	_workCondition.notify_one();
+}
+
+std::optional<DirectoryWalker::QueuedDirectory>
+DirectoryWalker::popDirectory(std::size_t index)
+{
+	std::optional<QueuedDirectory> directory;
+
+	// Own queue first, newest directory: keeps exploring the same sub tree
+	{
+		std::unique_lock lock {_queues[index].mutex};
+		if (!_queues[index].directories.empty())
+		{
+			directory = std::move(_queues[index].directories.back());
+			_queues[index].directories.pop_back();
+		}
+	}
+
+	// Then steal the oldest directory of another thread: likely the biggest sub tree
+	for (std::size_t i {1}; !directory && i < _threadCount; ++i)
+	{
+		WorkerQueue& queue {_queues[(index + i) % _threadCount]};
+
+		std::unique_lock lock {queue.mutex};
+		if (!queue.directories.empty())
+		{
+			directory = std::move(queue.directories.front());
+			queue.directories.pop_front();
+		}
+	}
+
+	if (directory)
+	{
+		std::unique_lock lock {_mutex};
+		_queuedCount--;
+	}
+
+	return directory;
+}
+
+void
+DirectoryWalker::onDirectoryDone()
+{
+	bool walkComplete {};
+	{
+		std::unique_lock lock {_mutex};
+		walkComplete = (--_pendingCount == 0);
+	}
+
+	if (walkComplete)
+		_resultsCondition.notify_all();
+}
+
+bool
+DirectoryWalker::pushSymlinkedDirectories()
+{
+	std::vector<std::filesystem::path> directories;
+	{
+		std::unique_lock lock {_mutex};
+		directories.swap(_symlinkedDirectories);
+	}
+
+	// Claimed by increasing path before any of them is explored: the smallest path to a directory wins
+	std::sort(std::begin(directories), std::end(directories));
+
+	std::vector<QueuedDirectory> claimedDirectories;
+	for (std::filesystem::path& directory : directories)
+	{
+		struct stat sb {};
+		const bool statOk {stat(directory.c_str(), &sb) == 0};
+		if (statOk)
+		{
+			const DirectoryId id {static_cast<std::uintmax_t>(sb.st_dev), static_cast<std::uintmax_t>(sb.st_ino)};
+
+			std::unique_lock lock {_mutex};
+			if (!_exploredDirectories.insert(id).second)
+			{
+				LMS_LOG(UTILS, INFO) << "Skipping '" << directory.string() << "': already explored (symbolic link loop?)";
+				continue;
+			}
+		}
+
+		claimedDirectories.push_back(QueuedDirectory {std::move(directory), statOk});
+	}
+
+	// Spread them over the threads, stealing will balance the sub trees
+	for (std::size_t i {}; i < claimedDirectories.size(); ++i)
+		pushDirectory(i % _threadCount, std::move(claimedDirectories[i]));
+
+	return !claimedDirectories.empty();
+}
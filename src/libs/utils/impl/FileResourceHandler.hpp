@@ -21,6 +21,7 @@
 
 #include <filesystem>
 #include "utils/IResourceHandler.hpp"
+#include "utils/StreamingActivity.hpp"
 
 class FileResourceHandler final : public IResourceHandler
 {
@@ -38,6 +39,7 @@ class FileResourceHandler final : public IResourceHandler
 		::uint64_t		_beyondLastByte {};
 		::uint64_t		_offset {};
 		bool			_isFinished {};
+		StreamingActivity::ScopedStream	_streamingActivity;
 
 };
 
@@ -0,0 +1,40 @@
+/*
+ * Copyright (C) 2020 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "utils/StreamingActivity.hpp"
+
+std::atomic<std::size_t> StreamingActivity::_activeStreamCount {};
+
+StreamingActivity::ScopedStream::ScopedStream()
+{
+	_activeStreamCount++;
+}
+
+StreamingActivity::ScopedStream::~ScopedStream()
+{
+	_activeStreamCount--;
+}
+
+std::size_t
+StreamingActivity::getActiveStreamCount()
+{
+	return _activeStreamCount.load();
+}
+
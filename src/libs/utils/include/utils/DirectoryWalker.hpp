@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2020 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include <Wt/WDateTime.h>
+
+// Explores a directory tree using a pool of threads
+// Each thread explores its own directories depth first and queues the sub directories it finds
+// Idle threads steal the oldest queued directories from the other threads
+// This mostly helps on network file systems, where listing a directory is bound by round trips
+// Symbolic links to directories are followed, but a directory is never explored twice (symlink loops, bind mounts)
+// Directories behind symbolic links are explored once all the others are, by increasing path: the path that wins does not depend on timings
+class DirectoryWalker
+{
+	public:
+		struct Error
+		{
+			std::filesystem::path	path;
+			std::error_code		ec;
+		};
+
+		// Entries of a single directory
+		struct DirectoryEntries
+		{
+			std::filesystem::path		directory;
+			std::optional<Wt::WDateTime>	lastWriteTime;		// taken before listing the entries, not set on error
+			std::size_t			entryCount {};		// all the entries, whatever their type
+			std::vector<std::string>	fileNames;		// regular files, sorted
+			std::vector<std::string>	subDirectoryNames;	// sorted
+			std::vector<Error>		errors;			// if not empty, the listing is incomplete
+		};
+
+		// Called from the thread that called walk, in no particular directory order
+		// Return false to stop the walk
+		using Callback = std::function<bool(DirectoryEntries&& entries)>;
+
+		DirectoryWalker(std::size_t threadCount);
+
+		DirectoryWalker(const DirectoryWalker&) = delete;
+		DirectoryWalker(DirectoryWalker&&) = delete;
+		DirectoryWalker& operator=(const DirectoryWalker&) = delete;
+		DirectoryWalker& operator=(DirectoryWalker&&) = delete;
+
+		// Returns false if the walk has been stopped by the callback
+		bool walk(const std::filesystem::path& root, const Callback& callback);
+
+		// List a single directory, from the calling thread
+		static DirectoryEntries listDirectory(const std::filesystem::path& directory);
+
+	private:
+		using DirectoryId = std::pair<std::uintmax_t, std::uintmax_t>; // device, inode
+
+		struct QueuedDirectory
+		{
+			std::filesystem::path	path;
+			bool			claimed {};	// already in the explored directories
+		};
+
+		struct WorkerQueue
+		{
+			std::mutex			mutex;
+			std::deque<QueuedDirectory>	directories;
+		};
+
+		void worker(std::size_t index);
+		void explore(std::size_t index, const QueuedDirectory& directory);
+		void pushDirectory(std::size_t index, QueuedDirectory directory);
+		std::optional<QueuedDirectory> popDirectory(std::size_t index);
+		void onDirectoryDone();
+		bool pushSymlinkedDirectories();
+
+		const std::size_t		_threadCount;
+
+		// Current walk
+		std::vector<WorkerQueue>	_queues;	// one per thread
+		std::mutex			_mutex;
+		std::condition_variable		_workCondition;
+		std::condition_variable		_resultsCondition;
+		std::atomic<bool>		_stop {};
+		std::size_t			_queuedCount {};	// directories waiting in the queues
+		std::size_t			_pendingCount {};	// directories queued or being explored
+		std::deque<DirectoryEntries>	_results;
+		std::set<DirectoryId>		_exploredDirectories;
+		std::vector<std::filesystem::path>	_symlinkedDirectories;	// explored once the queues are empty
+};
+
@@ -0,0 +1,50 @@
+/*
+ * Copyright (C) 2020 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+// Counts the audio streams and downloads being served
+// Background jobs (such as the media scanner) use it to leave the disk to the users
+class StreamingActivity
+{
+	public:
+		// Counted as an active stream during its lifetime
+		class ScopedStream
+		{
+			public:
+				ScopedStream();
+				~ScopedStream();
+
+				ScopedStream(const ScopedStream&) = delete;
+				ScopedStream(ScopedStream&&) = delete;
+				ScopedStream& operator=(const ScopedStream&) = delete;
+				ScopedStream& operator=(ScopedStream&&) = delete;
+		};
+
+		static std::size_t getActiveStreamCount();
+		static bool isActive() { return getActiveStreamCount() > 0; }
+
+	private:
+		static std::atomic<std::size_t> _activeStreamCount;
+};
+
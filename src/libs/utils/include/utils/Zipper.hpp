@@ -27,6 +27,7 @@
 
 #include "Exception.hpp"
 #include "utils/Crc32Calculator.hpp"
+#include "utils/StreamingActivity.hpp"
 
 namespace Zip
 {
@@ -93,6 +94,7 @@ namespace Zip
 			std::size_t _currentZipOffset {};
 			std::size_t _centralDirectoryOffset {};
 			std::size_t _centralDirectorySize {};
+			StreamingActivity::ScopedStream _streamingActivity;
 	};
 
 } // namespace Zip
@@ -156,7 +156,19 @@ int main(int argc, char* argv[])
 		Av::Transcoder::init();
 
 		// Initializing a connection pool to the database that will be shared along services
-		Database::Db database {config->getPath("working-dir") / "lms.db"};
+		Database::Db::Parameters dbParameters;
+		dbParameters.concurrencyMode = config->getBool("db-concurrent-readers", false) ? Database::Db::ConcurrencyMode::Concurrent : Database::Db::ConcurrencyMode::Serialized;
+		dbParameters.connectionCount = config->getULong("db-connection-count", dbParameters.connectionCount);
+		dbParameters.mmapSize = config->getULong("db-mmap-size", 0) * 1024 * 1024;
+		dbParameters.cacheSize = config->getULong("db-cache-size", dbParameters.cacheSize);
+		{
+			const std::string tempStore {config->getString("db-temp-store", "default", {"default", "file", "memory"})};
+			if (tempStore == "file")
+				dbParameters.tempStore = Database::Db::TempStore::File;
+			else if (tempStore == "memory")
+				dbParameters.tempStore = Database::Db::TempStore::Memory;
+		}
+		Database::Db database {config->getPath("working-dir") / "lms.db", dbParameters};
 		{
 			Database::Session session {database};
 			session.prepareTables();
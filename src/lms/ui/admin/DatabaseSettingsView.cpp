@@ -19,8 +19,10 @@
 
 #include "DatabaseSettingsView.hpp"
 
+#include <Wt/WCheckBox.h>
 #include <Wt/WComboBox.h>
 #include <Wt/WFormModel.h>
+#include <Wt/WIntValidator.h>
 #include <Wt/WLineEdit.h>
 #include <Wt/WPushButton.h>
 #include <Wt/WString.h>
@@ -51,6 +53,11 @@ class DatabaseSettingsModel : public Wt::WFormModel
 		static const Field UpdateStartTimeField;
 		static const Field RecommendationEngineTypeField;
 		static const Field TagsField;
+		static const Field ScannerPriorityField;
+		static const Field MaxFilesPerSecondField;
+		static const Field BackOffWhenStreamingField;
+		static const Field ScanNewestFirstField;
+		static const Field SkipUnchangedDirectoriesField;
 
 		DatabaseSettingsModel()
 			: Wt::WFormModel()
@@ -62,6 +69,11 @@ class DatabaseSettingsModel : public Wt::WFormModel
 			addField(UpdateStartTimeField);
 			addField(RecommendationEngineTypeField);
 			addField(TagsField);
+			addField(ScannerPriorityField);
+			addField(MaxFilesPerSecondField);
+			addField(BackOffWhenStreamingField);
+			addField(ScanNewestFirstField);
+			addField(SkipUnchangedDirectoriesField);
 
 			auto dirValidator {std::make_shared<DirectoryValidator>()};
 			dirValidator->setMandatory(true);
@@ -71,6 +83,8 @@ class DatabaseSettingsModel : public Wt::WFormModel
 			setValidator(UpdateStartTimeField, createMandatoryValidator());
 			setValidator(RecommendationEngineTypeField, createMandatoryValidator());
 			setValidator(TagsField, createTagsValidator());
+			setValidator(ScannerPriorityField, createMandatoryValidator());
+			setValidator(MaxFilesPerSecondField, createMaxFilesPerSecondValidator());
 
 			// populate the model with initial data
 			loadData();
@@ -79,6 +93,7 @@ class DatabaseSettingsModel : public Wt::WFormModel
 		std::shared_ptr<Wt::WAbstractItemModel> updatePeriodModel() { return _updatePeriodModel; }
 		std::shared_ptr<Wt::WAbstractItemModel> updateStartTimeModel() { return _updateStartTimeModel; }
 		std::shared_ptr<Wt::WAbstractItemModel> recommendationEngineTypeModel() { return _recommendationEngineTypeModel; }
+		std::shared_ptr<Wt::WAbstractItemModel> scannerPriorityModel() { return _scannerPriorityModel; }
 
 		void loadData()
 		{
@@ -107,6 +122,15 @@ class DatabaseSettingsModel : public Wt::WFormModel
 				std::transform(clusterTypes.begin(), clusterTypes.end(), std::back_inserter(names),  [](auto clusterType) { return clusterType->getName(); });
 				setValue(TagsField, StringUtils::joinStrings(names, " "));
 			}
+
+			auto scannerPriorityRow {_scannerPriorityModel->getRowFromValue(scanSettings->getScannerPriority())};
+			if (scannerPriorityRow)
+				setValue(ScannerPriorityField, _scannerPriorityModel->getString(*scannerPriorityRow));
+
+			setValue(MaxFilesPerSecondField, std::to_string(scanSettings->getMaxFilesPerSecond()));
+			setValue(BackOffWhenStreamingField, scanSettings->getBackOffWhenStreaming());
+			setValue(ScanNewestFirstField, scanSettings->getScanNewestFirst());
+			setValue(SkipUnchangedDirectoriesField, scanSettings->getSkipUnchangedDirectories());
 		}
 
 		void saveData()
@@ -131,6 +155,18 @@ class DatabaseSettingsModel : public Wt::WFormModel
 
 			auto clusterTypes {StringUtils::splitString(valueText(TagsField).toUTF8(), " ")};
 			scanSettings.modify()->setClusterTypes(LmsApp->getDbSession(), std::set<std::string>(clusterTypes.begin(), clusterTypes.end()));
+
+			auto scannerPriorityRow {_scannerPriorityModel->getRowFromString(valueText(ScannerPriorityField))};
+			if (scannerPriorityRow)
+				scanSettings.modify()->setScannerPriority(_scannerPriorityModel->getValue(*scannerPriorityRow));
+
+			const auto maxFilesPerSecond {StringUtils::readAs<std::size_t>(valueText(MaxFilesPerSecondField).toUTF8())};
+			if (maxFilesPerSecond)
+				scanSettings.modify()->setMaxFilesPerSecond(*maxFilesPerSecond);
+
+			scanSettings.modify()->setBackOffWhenStreaming(Wt::asNumber(value(BackOffWhenStreamingField)));
+			scanSettings.modify()->setScanNewestFirst(Wt::asNumber(value(ScanNewestFirstField)));
+			scanSettings.modify()->setSkipUnchangedDirectories(Wt::asNumber(value(SkipUnchangedDirectoriesField)));
 		}
 
 	private:
@@ -141,6 +177,13 @@ class DatabaseSettingsModel : public Wt::WFormModel
 			return v;
 		}
 
+		static std::shared_ptr<Wt::WValidator> createMaxFilesPerSecondValidator()
+		{
+			auto v = std::make_shared<Wt::WIntValidator>(0, 10000);
+			v->setMandatory(true);
+			return v;
+		}
+
 		void initializeModels()
 		{
 			_updatePeriodModel = std::make_shared<ValueStringModel<ScanSettings::UpdatePeriod>>();
@@ -159,11 +202,17 @@ class DatabaseSettingsModel : public Wt::WFormModel
 			_recommendationEngineTypeModel = std::make_shared<ValueStringModel<ScanSettings::RecommendationEngineType>>();
 			_recommendationEngineTypeModel->add(Wt::WString::tr("Lms.Admin.Database.recommendation-engine-type.clusters"), ScanSettings::RecommendationEngineType::Clusters);
 			_recommendationEngineTypeModel->add(Wt::WString::tr("Lms.Admin.Database.recommendation-engine-type.features"), ScanSettings::RecommendationEngineType::Features);
+
+			_scannerPriorityModel = std::make_shared<ValueStringModel<ScanSettings::ScannerPriority>>();
+			_scannerPriorityModel->add(Wt::WString::tr("Lms.Admin.Database.scanner-priority.normal"), ScanSettings::ScannerPriority::Normal);
+			_scannerPriorityModel->add(Wt::WString::tr("Lms.Admin.Database.scanner-priority.low"), ScanSettings::ScannerPriority::Low);
+			_scannerPriorityModel->add(Wt::WString::tr("Lms.Admin.Database.scanner-priority.idle"), ScanSettings::ScannerPriority::Idle);
 		}
 
 		std::shared_ptr<ValueStringModel<ScanSettings::UpdatePeriod>>		_updatePeriodModel;
 		std::shared_ptr<ValueStringModel<Wt::WTime>>				_updateStartTimeModel;
 		std::shared_ptr<ValueStringModel<ScanSettings::RecommendationEngineType>>	_recommendationEngineTypeModel;
+		std::shared_ptr<ValueStringModel<ScanSettings::ScannerPriority>>	_scannerPriorityModel;
 
 };
 
@@ -172,6 +221,11 @@ const Wt::WFormModel::Field DatabaseSettingsModel::UpdatePeriodField			= "update
 const Wt::WFormModel::Field DatabaseSettingsModel::UpdateStartTimeField			= "update-start-time";
 const Wt::WFormModel::Field DatabaseSettingsModel::RecommendationEngineTypeField	= "recommendation-engine-type";
 const Wt::WFormModel::Field DatabaseSettingsModel::TagsField				= "tags";
+const Wt::WFormModel::Field DatabaseSettingsModel::ScannerPriorityField			= "scanner-priority";
+const Wt::WFormModel::Field DatabaseSettingsModel::MaxFilesPerSecondField		= "max-files-per-second";
+const Wt::WFormModel::Field DatabaseSettingsModel::BackOffWhenStreamingField		= "back-off-when-streaming";
+const Wt::WFormModel::Field DatabaseSettingsModel::ScanNewestFirstField			= "scan-newest-first";
+const Wt::WFormModel::Field DatabaseSettingsModel::SkipUnchangedDirectoriesField		= "skip-unchanged-directories";
 
 DatabaseSettingsView::DatabaseSettingsView()
 {
@@ -215,6 +269,23 @@ DatabaseSettingsView::refreshView()
 	// Tags
 	t->setFormWidget(DatabaseSettingsModel::TagsField, std::make_unique<Wt::WLineEdit>());
 
+	// Scanner priority
+	auto scannerPriority {std::make_unique<Wt::WComboBox>()};
+	scannerPriority->setModel(model->scannerPriorityModel());
+	t->setFormWidget(DatabaseSettingsModel::ScannerPriorityField, std::move(scannerPriority));
+
+	// Max files per second
+	t->setFormWidget(DatabaseSettingsModel::MaxFilesPerSecondField, std::make_unique<Wt::WLineEdit>());
+
+	// Back off when streaming
+	t->setFormWidget(DatabaseSettingsModel::BackOffWhenStreamingField, std::make_unique<Wt::WCheckBox>());
+
+	// Scan newest first
+	t->setFormWidget(DatabaseSettingsModel::ScanNewestFirstField, std::make_unique<Wt::WCheckBox>());
+
+	// Skip unchanged directories
+	t->setFormWidget(DatabaseSettingsModel::SkipUnchangedDirectoriesField, std::make_unique<Wt::WCheckBox>());
+
 	// Buttons
 	Wt::WPushButton *saveBtn = t->bindWidget("apply-btn", std::make_unique<Wt::WPushButton>(Wt::WString::tr("Lms.apply")));
 	Wt::WPushButton *discardBtn = t->bindWidget("discard-btn", std::make_unique<Wt::WPushButton>(Wt::WString::tr("Lms.discard")));
@@ -84,10 +84,41 @@ class ReportResource : public Wt::WResource
 
 			for (const auto& duplicate : _stats.duplicates)
 				response.out() << duplicate.file.string() << " - " << duplicateReasonToWString(duplicate.reason).toUTF8() << std::endl;
+
+			response.out() << std::endl;
+
+			response.out() << Wt::WString::tr("Lms.Admin.ScannerController.perf-header").toUTF8() << std::endl;
+
+			for (std::size_t step {}; step < Scanner::ScanProgressStepCount; ++step)
+			{
+				const Scanner::ScanStepPerfStats& stepPerf {_stats.perf.steps[step]};
+
+				response.out() << Wt::WString::tr("Lms.Admin.ScannerController.perf-step")
+					.arg(step + 1)
+					.arg(stepPerf.duration.count())
+					.arg(stepPerf.processedFiles)
+					.arg(static_cast<int>(stepPerf.getFilesPerSecond())).toUTF8() << std::endl;
+			}
+
+			writeLatency(response, "Lms.Admin.ScannerController.parse-latency", _stats.perf.parseLatency);
+			writeLatency(response, "Lms.Admin.ScannerController.db-write-latency", _stats.perf.dbWriteLatency);
+			writeLatency(response, "Lms.Admin.ScannerController.db-lock-wait-latency", _stats.perf.dbLockWaitLatency);
 		}
 
 	private:
 
+		static void writeLatency(Wt::Http::Response& response, const char* nameKey, const Scanner::LatencyHistogram& histogram)
+		{
+			response.out() << Wt::WString::tr("Lms.Admin.ScannerController.perf-latency")
+				.arg(Wt::WString::tr(nameKey))
+				.arg(histogram.getAverage().count())
+				.arg(histogram.getPercentile(50).count())
+				.arg(histogram.getPercentile(95).count())
+				.arg(histogram.getPercentile(99).count())
+				.arg(histogram.max.count())
+				.arg(histogram.count).toUTF8() << std::endl;
+		}
+
 		static Wt::WString errorTypeToWString(Scanner::ScanErrorType error)
 		{
 			switch (error)
@@ -96,6 +127,7 @@ class ReportResource : public Wt::WResource
 				case Scanner::ScanErrorType::CannotParseFile: return Wt::WString::tr("Lms.Admin.ScannerController.cannot-parse-file");
 				case Scanner::ScanErrorType::NoAudioTrack: return Wt::WString::tr("Lms.Admin.ScannerController.no-audio-track");
 				case Scanner::ScanErrorType::BadDuration: return Wt::WString::tr("Lms.Admin.ScannerController.bad-duration");
+				case Scanner::ScanErrorType::CannotUpdateDatabase: return Wt::WString::tr("Lms.Admin.ScannerController.cannot-update-database");
 			}
 			return "?";
 		}
@@ -216,6 +248,11 @@ ScannerController::refreshContents()
 						.arg(status.currentScanStepStats->progress()));
 					break;
 
+				case Scanner::ScanProgressStep::RemovingOrphanEntries:
+					bindString("step-status", Wt::WString::tr("Lms.Admin.ScannerController.step-removing-orphan-entries")
+						.arg(status.currentScanStepStats->progress()));
+					break;
+
 				case Scanner::ScanProgressStep::FetchingTrackFeatures:
 					bindString("step-status", Wt::WString::tr("Lms.Admin.ScannerController.step-fetching-track-features")
 						.arg(status.currentScanStepStats->processedFiles)
@@ -89,6 +89,7 @@ Artists::refreshView()
 {
 	_container->clear();
 	_randomArtists.clear();
+	_lastArtistId.reset();
 	addSome();
 }
 
@@ -224,9 +225,10 @@ Artists::addSome()
 	auto transaction {LmsApp->getDbSession().createSharedTransaction()};
 
 	bool moreResults {};
-	for (const Artist::pointer& artist : getArtists(Range {static_cast<std::size_t>(_container->count()), batchSize}, moreResults))
+	for (const Artist::pointer& artist : getArtists(Range {static_cast<std::size_t>(_container->count()), batchSize, _lastArtistId}, moreResults))
 	{
 		_container->addWidget(ArtistListHelpers::createEntry(artist));
+		_lastArtistId = artist.id();
 	}
 
 	if (moreResults)
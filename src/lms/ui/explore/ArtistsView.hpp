@@ -20,6 +20,7 @@
 #pragma once
 
 #include <memory>
+#include <optional>
 #include <vector>
 
 #include <Wt/WComboBox.h>
@@ -75,6 +76,7 @@ class Artists : public Wt::WTemplate
 
 		Mode _mode {defaultMode};
 		std::vector<Database::IdType> _randomArtists;
+		std::optional<Database::IdType> _lastArtistId;	// last one displayed, to resume the listing from it
 		Filters* _filters {};
 		Wt::WTemplate* _loadingIndicator {};
 		Wt::WContainerWidget* _container {};
@@ -49,9 +49,7 @@ namespace UserInterface::ReleaseListHelpers
 		cover->setAttributeValue("onload", LmsApp->javaScriptClass() + ".onLoadCover(this)");
 		anchor->setImage(std::move(cover));
 
-		auto artists = release->getReleaseArtists();
-		if (artists.empty())
-			artists = release->getArtists();
+		auto artists = release->getPrimaryArtists();
 
 		bool isSameArtist {(std::find(std::cbegin(artists), std::cend(artists), artist) != artists.end())};
 
@@ -109,9 +109,7 @@ Release::refreshView()
 	{
 		std::vector<Wt::Dbo::ptr<Database::Artist>> artists;
 
-		artists = release->getReleaseArtists();
-		if (artists.empty())
-			artists = release->getArtists();
+		artists = release->getPrimaryArtists();
 
 		if (artists.size() > 1)
 		{
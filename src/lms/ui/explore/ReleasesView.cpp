@@ -105,6 +105,7 @@ Releases::refreshView()
 {
 	_container->clear();
 	_randomReleases.clear();
+	_lastReleaseId.reset();
 	addSome();
 }
 
@@ -141,11 +142,12 @@ Releases::addSome()
 	bool moreResults {};
 
 	auto transaction {LmsApp->getDbSession().createSharedTransaction()};
-	const auto releases {getReleases(Range {static_cast<std::size_t>(_container->count()), batchSize}, moreResults)};
+	const auto releases {getReleases(Range {static_cast<std::size_t>(_container->count()), batchSize, _lastReleaseId}, moreResults)};
 
 	for (const Release::pointer& release : releases)
 	{
 		_container->addWidget(ReleaseListHelpers::createEntry(release));
+		_lastReleaseId = release.id();
 	}
 
 	if (moreResults)
@@ -80,6 +80,7 @@ class Releases : public Wt::WTemplate
 		Mode _mode {defaultMode};
 		Filters* _filters {};
 		std::vector<Database::IdType> _randomReleases;
+		std::optional<Database::IdType> _lastReleaseId;	// last one displayed, to resume the listing from it
 		Wt::WContainerWidget* _container {};
 		Wt::WTemplate* _loadingIndicator {};
 };
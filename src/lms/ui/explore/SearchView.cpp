@@ -77,7 +77,7 @@ namespace UserInterface
 								_filters->getClusterIds(),
 								_keywords,
 								std::nullopt,
-								Database::Artist::SortMethod::BySortName,
+								Database::Artist::SortMethod::ByRelevance,
 								Database::Range {0, maxEntries}, more)};
 
 		if (!artists.empty())
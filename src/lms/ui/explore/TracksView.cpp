@@ -111,6 +111,7 @@ Tracks::refreshView()
 {
 	_tracksContainer->clear();
 	_randomTracks.clear();
+	_lastTrackId.reset();
 	addSome();
 }
 
@@ -234,9 +235,10 @@ Tracks::addSome()
 	auto transaction {LmsApp->getDbSession().createSharedTransaction()};
 
 	bool moreResults;
-	for (const Track::pointer& track : getTracks(Range {static_cast<std::size_t>(_tracksContainer->count()), batchSize}, moreResults))
+	for (const Track::pointer& track : getTracks(Range {static_cast<std::size_t>(_tracksContainer->count()), batchSize, _lastTrackId}, moreResults))
 	{
 		_tracksContainer->addWidget(TrackListHelpers::createEntry(track, tracksAction));
+		_lastTrackId = track.id();
 	}
 
 	if (moreResults)
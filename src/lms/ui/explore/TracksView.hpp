@@ -78,6 +78,7 @@ class Tracks : public Wt::WTemplate
 		Mode _mode {defaultMode};
 		Filters* _filters {};
 		std::vector<Database::IdType> _randomTracks;
+		std::optional<Database::IdType> _lastTrackId;	// last one displayed, to resume the listing from it
 		Wt::WContainerWidget* _tracksContainer {};
 		Wt::WTemplate* _loadingIndicator {};
 };
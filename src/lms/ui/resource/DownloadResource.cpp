@@ -96,9 +96,7 @@ getReleaseArtistPathName(Database::Release::pointer release)
 
 	std::vector<Wt::Dbo::ptr<Database::Artist>> artists;
 
-	artists = release->getReleaseArtists();
-	if (artists.empty())
-		artists = release->getArtists();
+	artists = release->getPrimaryArtists();
 
 	if (artists.size() > 1)
 		releaseArtistName = Wt::WString::tr("Lms.Explore.various-artists").toUTF8();
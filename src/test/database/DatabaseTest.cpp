@@ -17,21 +17,26 @@
  * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
 #include <cstdlib>
 
 #include <filesystem>
 #include <list>
+#include <thread>
 
 #include "database/Artist.hpp"
 #include "database/Cluster.hpp"
 #include "database/Db.hpp"
+#include "database/Directory.hpp"
 #include "database/Release.hpp"
+#include "database/ScanCheckpoint.hpp"
 #include "database/Session.hpp"
 #include "database/Track.hpp"
 #include "database/TrackBookmark.hpp"
 #include "database/TrackList.hpp"
 #include "database/User.hpp"
 
+#include "utils/Exception.hpp"
 #include "utils/StreamLogger.hpp"
 
 using namespace Database;
@@ -135,7 +140,9 @@ class ScopedEntity
 using ScopedArtist = ScopedEntity<Artist>;
 using ScopedCluster = ScopedEntity<Cluster>;
 using ScopedClusterType = ScopedEntity<ClusterType>;
+using ScopedDirectory = ScopedEntity<Directory>;
 using ScopedRelease = ScopedEntity<Release>;
+using ScopedScanCheckpoint = ScopedEntity<ScanCheckpoint>;
 using ScopedTrack = ScopedEntity<Track>;
 using ScopedTrackBookmark = ScopedEntity<TrackBookmark>;
 using ScopedTrackList = ScopedEntity<TrackList>;
@@ -175,6 +182,185 @@ testSingleTrack(Session& session)
 	}
 }
 
+static
+void
+testMultiTracksByDirectory(Session& session)
+{
+	ScopedTrack track1 {session, "/music/MyArtist/MyRelease/MyTrack1.mp3"};
+	ScopedTrack track2 {session, "/music/MyArtist/MyRelease/CD1/MyTrack2.mp3"};
+	ScopedTrack track3 {session, "/music/MyArtist/MyRelease2/MyTrack3.mp3"};
+	ScopedTrack track4 {session, "/music/MyArtist/MyRelease.mp3"};
+
+	{
+		auto transaction {session.createSharedTransaction()};
+
+		const auto tracks {Track::getByDirectory(session, "/music/MyArtist/MyRelease")};
+		CHECK(tracks.size() == 2);
+		CHECK(std::any_of(std::cbegin(tracks), std::cend(tracks), [&](const Track::pointer& track) { return track == track1.get(); }));
+		CHECK(std::any_of(std::cbegin(tracks), std::cend(tracks), [&](const Track::pointer& track) { return track == track2.get(); }));
+
+		CHECK(Track::getByDirectory(session, "/music").size() == 4);
+		CHECK(Track::getByDirectory(session, "/music/MyArtist/MyRelease/MyTrack1.mp3").empty());
+		CHECK(Track::getByDirectory(session, "/other").empty());
+	}
+}
+
+static
+void
+testMultiTracksFileInfos(Session& session)
+{
+	ScopedTrack track1 {session, "/music/MyTrack1.mp3"};
+	ScopedTrack track2 {session, "/music/MyTrack2.mp3"};
+
+	{
+		auto transaction {session.createUniqueTransaction()};
+
+		track1.get().modify()->setLastWriteTime(Wt::WDateTime::fromTime_t(1000));
+		track1.get().modify()->setScanVersion(3);
+		track1.get().modify()->setFileFingerprint(Track::FileFingerprint {4096, 0xFEDCBA9876543210ULL});
+	}
+
+	{
+		auto transaction {session.createSharedTransaction()};
+
+		std::vector<Track::FileInfo> fileInfos;
+		Track::visitAllFileInfos(session, [&](const Track::FileInfo& fileInfo) { fileInfos.push_back(fileInfo); });
+		CHECK(fileInfos.size() == 2);
+
+		auto itFileInfo1 {std::find_if(std::cbegin(fileInfos), std::cend(fileInfos), [&](const Track::FileInfo& fileInfo) { return fileInfo.id == track1.getId(); })};
+		CHECK(itFileInfo1 != std::cend(fileInfos));
+		CHECK(itFileInfo1->path == "/music/MyTrack1.mp3");
+		CHECK(itFileInfo1->lastWriteTime.toTime_t() == 1000);
+		CHECK(itFileInfo1->scanVersion == 3);
+		CHECK(itFileInfo1->fingerprint);
+		CHECK(itFileInfo1->fingerprint->size == 4096);
+		CHECK(itFileInfo1->fingerprint->contentHash == 0xFEDCBA9876543210ULL);
+
+		auto itFileInfo2 {std::find_if(std::cbegin(fileInfos), std::cend(fileInfos), [&](const Track::FileInfo& fileInfo) { return fileInfo.id == track2.getId(); })};
+		CHECK(itFileInfo2 != std::cend(fileInfos));
+		CHECK(itFileInfo2->path == "/music/MyTrack2.mp3");
+		CHECK(itFileInfo2->scanVersion == 0);
+		CHECK(!itFileInfo2->fingerprint);
+	}
+}
+
+static
+void
+testSingleTrackMove(Session& session)
+{
+	ScopedTrack track {session, "/music/MyTrack.mp3"};
+
+	{
+		auto transaction {session.createUniqueTransaction()};
+
+		track.get().modify()->setFileFingerprint(Track::FileFingerprint {4096, 42});
+	}
+
+	{
+		auto transaction {session.createUniqueTransaction()};
+
+		track.get().modify()->setPath("/music/MyDirectory/MyTrack.mp3");
+		track.get().modify()->setFileFingerprint(Track::FileFingerprint {8192, 43});
+	}
+
+	{
+		auto transaction {session.createSharedTransaction()};
+
+		CHECK(!Track::getByPath(session, "/music/MyTrack.mp3"));
+		CHECK(Track::getByPath(session, "/music/MyDirectory/MyTrack.mp3") == track.get());
+		CHECK((track->getFileFingerprint() == Track::FileFingerprint {8192, 43}));
+	}
+
+	{
+		auto transaction {session.createUniqueTransaction()};
+
+		track.get().modify()->setFileFingerprint(std::nullopt);
+	}
+
+	{
+		auto transaction {session.createSharedTransaction()};
+
+		CHECK(!track->getFileFingerprint());
+	}
+}
+
+static
+void
+testSingleTrackEmbeddedCover(Session& session)
+{
+	ScopedTrack track {session, "/music/MyTrack.mp3"};
+
+	{
+		auto transaction {session.createSharedTransaction()};
+
+		CHECK(!track->getEmbeddedCover());
+	}
+
+	{
+		auto transaction {session.createUniqueTransaction()};
+
+		track.get().modify()->setEmbeddedCover(Track::EmbeddedCover {5000000000ULL, 65536, "image/jpeg", 500, 400});
+	}
+
+	{
+		auto transaction {session.createSharedTransaction()};
+
+		const std::optional<Track::EmbeddedCover> embeddedCover {track->getEmbeddedCover()};
+		CHECK(embeddedCover);
+		CHECK(embeddedCover->offset == 5000000000ULL);
+		CHECK(embeddedCover->size == 65536);
+		CHECK(embeddedCover->mimeType == "image/jpeg");
+		CHECK(embeddedCover->width == 500);
+		CHECK(embeddedCover->height == 400);
+	}
+
+	{
+		auto transaction {session.createUniqueTransaction()};
+
+		track.get().modify()->setEmbeddedCover(std::nullopt);
+	}
+
+	{
+		auto transaction {session.createSharedTransaction()};
+
+		CHECK(!track->getEmbeddedCover());
+	}
+}
+
+static
+void
+testMultiTracksRemoveByIds(Session& session)
+{
+	ScopedTrack track1 {session, "/music/MyTrack1.mp3"};
+	IdType trackId2;
+	IdType trackId3;
+
+	{
+		auto transaction {session.createUniqueTransaction()};
+
+		trackId2 = Track::create(session, "/music/MyTrack2.mp3").id();
+		trackId3 = Track::create(session, "/music/MyTrack3.mp3").id();
+	}
+
+	{
+		auto transaction {session.createUniqueTransaction()};
+
+		Track::removeByIds(session, {});
+		CHECK(Track::getCount(session) == 3);
+
+		Track::removeByIds(session, {trackId2, trackId3});
+	}
+
+	{
+		auto transaction {session.createSharedTransaction()};
+
+		CHECK(Track::getCount(session) == 1);
+		CHECK(Track::getById(session, track1.getId()));
+		CHECK(!Track::getById(session, trackId2));
+		CHECK(!Track::getById(session, trackId3));
+	}
+}
+
 static
 void
 testSingleArtist(Session& session)
@@ -255,6 +441,51 @@ testSingleCluster(Session& session)
 	}
 }
 
+static
+void
+testRemoveAllOrphans(Session& session)
+{
+	ScopedClusterType clusterType {session, "MyType"};
+	ScopedCluster cluster {session, clusterType.lockAndGet(), "MyCluster"};
+	ScopedArtist artist {session, "MyArtist"};
+	ScopedRelease release {session, "MyRelease"};
+	ScopedTrack track {session, "MyTrack"};
+
+	{
+		auto transaction {session.createUniqueTransaction()};
+
+		TrackArtistLink::create(session, track.get(), artist.get(), TrackArtistLink::Type::Artist);
+		// Link without artist: must not prevent the orphans from being removed
+		TrackArtistLink::create(session, track.get(), Artist::pointer {}, TrackArtistLink::Type::Composer);
+		track.get().modify()->setRelease(release.get());
+		track.get().modify()->setClusters({cluster.get()});
+
+		Artist::create(session, "MyOrphanArtist");
+		Release::create(session, "MyOrphanRelease");
+		Cluster::create(session, clusterType.get(), "MyOrphanCluster");
+	}
+
+	{
+		auto transaction {session.createUniqueTransaction()};
+
+		CHECK(Cluster::removeAllOrphans(session) == 1);
+		CHECK(Artist::removeAllOrphans(session) == 1);
+		CHECK(Release::removeAllOrphans(session) == 1);
+
+		CHECK(Cluster::removeAllOrphans(session) == 0);
+		CHECK(Artist::removeAllOrphans(session) == 0);
+		CHECK(Release::removeAllOrphans(session) == 0);
+	}
+
+	{
+		auto transaction {session.createSharedTransaction()};
+
+		CHECK(Cluster::getAll(session).size() == 1);
+		CHECK(Artist::getAll(session).size() == 1);
+		CHECK(Release::getCount(session) == 1);
+	}
+}
+
 static
 void
 testSingleTrackSingleArtist(Session& session)
@@ -431,6 +662,59 @@ testSingleArtistSearchByName(Session& session)
 	}
 }
 
+static
+void
+testFullTextSearch(Session& session)
+{
+	ScopedRelease release {session, "Déjà Vu"};
+	ScopedTrack track {session, "MyTrack"};
+
+	{
+		auto transaction {session.createUniqueTransaction()};
+
+		track.get().modify()->setName("Café Tacvba");
+		track.get().modify()->setRelease(release.get());
+	}
+
+	{
+		auto transaction {session.createSharedTransaction()};
+
+		bool more {};
+		CHECK(Track::getByFilter(session, {}, {"CAF", "tac"}, std::nullopt, more).size() == 1);
+		CHECK(Track::getByFilter(session, {}, {"cafe", "vu"}, std::nullopt, more).empty());
+
+		// SQLite may be built without FTS5: searches then fall back on LIKE
+		if (session.hasFullTextSearch())
+		{
+			// Diacritics insensitive, prefix matches only
+			const auto tracks {Track::getByFilter(session, {}, {"cafe"}, std::nullopt, more)};
+			CHECK(tracks.size() == 1);
+			CHECK(tracks.front().id() == track.getId());
+
+			CHECK(Track::getByFilter(session, {}, {"acvba"}, std::nullopt, more).empty());
+
+			const auto releases {Release::getByFilter(session, {}, {"deja"}, std::nullopt, more)};
+			CHECK(releases.size() == 1);
+			CHECK(releases.front().id() == release.getId());
+		}
+		else
+		{
+			// Diacritics sensitive, substring matches
+			const auto tracks {Track::getByFilter(session, {}, {"café"}, std::nullopt, more)};
+			CHECK(tracks.size() == 1);
+			CHECK(tracks.front().id() == track.getId());
+
+			CHECK(Track::getByFilter(session, {}, {"cafe"}, std::nullopt, more).empty());
+			CHECK(Track::getByFilter(session, {}, {"acvba"}, std::nullopt, more).size() == 1);
+
+			const auto releases {Release::getByFilter(session, {}, {"déjà"}, std::nullopt, more)};
+			CHECK(releases.size() == 1);
+			CHECK(releases.front().id() == release.getId());
+			CHECK(Release::getByFilter(session, {}, {"deja"}, std::nullopt, more).empty());
+		}
+	}
+}
+
 static
 void
 testMultiArtistsSortMethod(Session& session)
@@ -473,6 +757,7 @@ testSingleTrackSingleRelease(Session& session)
 			auto transaction {session.createUniqueTransaction()};
 
 			track.get().modify()->setRelease(release.get());
+			release.get().modify()->updateAggregates();
 		}
 
 		{
@@ -521,6 +806,7 @@ testMultiTracksSingleReleaseTotalDiscTrack(Session& session)
 		auto transaction {session.createUniqueTransaction()};
 
 		track1.get().modify()->setRelease(release1.get());
+		release1.get().modify()->updateAggregates();
 	}
 
 	{
@@ -535,6 +821,7 @@ testMultiTracksSingleReleaseTotalDiscTrack(Session& session)
 
 		track1.get().modify()->setTotalTrack(36);
 		track1.get().modify()->setTotalDisc(6);
+		release1.get().modify()->updateAggregates();
 	}
 
 	{
@@ -551,6 +838,7 @@ testMultiTracksSingleReleaseTotalDiscTrack(Session& session)
 		track2.get().modify()->setRelease(release1.get());
 		track2.get().modify()->setTotalTrack(37);
 		track2.get().modify()->setTotalDisc(67);
+		release1.get().modify()->updateAggregates();
 	}
 
 	{
@@ -575,6 +863,7 @@ testMultiTracksSingleReleaseTotalDiscTrack(Session& session)
 		track3.get().modify()->setRelease(release2.get());
 		track3.get().modify()->setTotalTrack(7);
 		track3.get().modify()->setTotalDisc(5);
+		release2.get().modify()->updateAggregates();
 	}
 	{
 		auto transaction {session.createSharedTransaction()};
@@ -586,6 +875,128 @@ testMultiTracksSingleReleaseTotalDiscTrack(Session& session)
 	}
 }
 
+static
+void
+testReleaseKeysetPagination(Session& session)
+{
+	// Same names on purpose: the id is used to break ties
+	ScopedRelease release1 {session, "b"};
+	ScopedRelease release2 {session, "A"};
+	ScopedRelease release3 {session, "B"};
+	ScopedRelease release4 {session, "a"};
+	ScopedTrack track1 {session, "MyTrack1"};
+	ScopedTrack track2 {session, "MyTrack2"};
+	ScopedTrack track3 {session, "MyTrack3"};
+	ScopedTrack track4 {session, "MyTrack4"};
+
+	{
+		auto transaction {session.createUniqueTransaction()};
+
+		track1.get().modify()->setRelease(release1.get());
+		track2.get().modify()->setRelease(release2.get());
+		track3.get().modify()->setRelease(release3.get());
+		track4.get().modify()->setRelease(release4.get());
+	}
+
+	{
+		auto transaction {session.createSharedTransaction()};
+
+		bool moreResults;
+		const auto allReleases {Release::getByFilter(session, {}, {}, std::nullopt, moreResults)};
+		CHECK(allReleases.size() == 4);
+
+		std::vector<Release::pointer> pagedReleases;
+		Range range {0, 3};
+		do
+		{
+			const auto releases {Release::getByFilter(session, {}, {}, range, moreResults)};
+			pagedReleases.insert(std::end(pagedReleases), std::cbegin(releases), std::cend(releases));
+
+			range.offset += releases.size();
+			range.limit = 1;
+			if (!releases.empty())
+				range.after = releases.back().id();
+		}
+		while (moreResults);
+
+		CHECK(pagedReleases == allReleases);
+	}
+}
+
+static
+void
+testReleaseAggregates(Session& session)
+{
+	ScopedArtist artist1 {session, "MyArtist1"};
+	ScopedArtist artist2 {session, "MyArtist2"};
+	ScopedRelease release {session, "MyRelease"};
+	ScopedTrack track1 {session, "MyTrack1"};
+
+	{
+		auto transaction {session.createUniqueTransaction()};
+
+		TrackArtistLink::create(session, track1.get(), artist1.get(), TrackArtistLink::Type::Artist);
+		track1.get().modify()->setRelease(release.get());
+		track1.get().modify()->setDuration(std::chrono::seconds {60});
+		track1.get().modify()->setYear(1994);
+		release.get().modify()->updateAggregates();
+	}
+
+	{
+		auto transaction {session.createSharedTransaction()};
+
+		CHECK(release->getTracksCount() == 1);
+		CHECK(release->getDuration() == std::chrono::seconds {60});
+		CHECK(release->getReleaseYear() == 1994);
+		CHECK(!release->getReleaseYear(true));
+		CHECK(release->getPrimaryArtistCount() == 1);
+
+		const auto artists {release->getPrimaryArtists()};
+		CHECK(artists.size() == 1);
+		CHECK(artists.front().id() == artist1.getId());
+	}
+
+	ScopedTrack track2 {session, "MyTrack2"};
+	{
+		auto transaction {session.createUniqueTransaction()};
+
+		TrackArtistLink::create(session, track2.get(), artist2.get(), TrackArtistLink::Type::Artist);
+		track2.get().modify()->setRelease(release.get());
+		track2.get().modify()->setDuration(std::chrono::seconds {30});
+		track2.get().modify()->setYear(1995);
+		release.get().modify()->updateAggregates();
+	}
+
+	{
+		auto transaction {session.createSharedTransaction()};
+
+		CHECK(release->getTracksCount() == 2);
+		CHECK(release->getDuration() == std::chrono::seconds {90});
+		CHECK(!release->getReleaseYear());
+		CHECK(release->getPrimaryArtistCount() == 2);
+		CHECK(release->getPrimaryArtists().size() == 2);
+	}
+
+	// Release artists take precedence over the track artists
+	{
+		auto transaction {session.createUniqueTransaction()};
+
+		TrackArtistLink::create(session, track1.get(), artist2.get(), TrackArtistLink::Type::ReleaseArtist);
+		TrackArtistLink::create(session, track2.get(), artist2.get(), TrackArtistLink::Type::ReleaseArtist);
+		release.get().modify()->updateAggregates();
+	}
+
+	{
+		auto transaction {session.createSharedTransaction()};
+
+		CHECK(release->getPrimaryArtistCount() == 1);
+
+		const auto artists {release->getPrimaryArtists()};
+		CHECK(artists.size() == 1);
+		CHECK(artists.front().id() == artist2.getId());
+	}
+}
+
 static
 void
 testSingleTrackSingleCluster(Session& session)
@@ -1870,6 +2281,150 @@ testSingleTrackSingleUserSingleBookmark(Session& session)
 	}
 }
 
+static
+void
+testSingleDirectory(Session& session)
+{
+	ScopedDirectory directory {session, "/music/MyDirectory"};
+
+	{
+		auto transaction {session.createUniqueTransaction()};
+
+		directory.get().modify()->setLastWriteTime(Wt::WDateTime::fromTime_t(1000));
+		directory.get().modify()->setEntryCount(3);
+		directory.get().modify()->setChildrenHash(0xFEDCBA9876543210ULL);
+		directory.get().modify()->setScanVersion(2);
+	}
+
+	{
+		auto transaction {session.createSharedTransaction()};
+
+		CHECK(Directory::getAll(session).size() == 1);
+		CHECK(!Directory::getByPath(session, "/music/MyOtherDirectory"));
+
+		auto dir {Directory::getByPath(session, "/music/MyDirectory")};
+		CHECK(dir);
+		CHECK(dir == directory.get());
+		CHECK(dir->getPath() == "/music/MyDirectory");
+		CHECK(dir->getLastWriteTime().toTime_t() == 1000);
+		CHECK(dir->getEntryCount() == 3);
+		CHECK(dir->getChildrenHash() == 0xFEDCBA9876543210ULL);
+		CHECK(dir->getScanVersion() == 2);
+	}
+}
+
+static
+void
+testSingleScanCheckpoint(Session& session)
+{
+	{
+		auto transaction {session.createSharedTransaction()};
+
+		CHECK(!ScanCheckpoint::get(session));
+	}
+
+	ScopedScanCheckpoint checkpoint {session};
+
+	{
+		auto transaction {session.createSharedTransaction()};
+
+		auto scanCheckpoint {ScanCheckpoint::get(session)};
+		CHECK(scanCheckpoint == checkpoint.get());
+		CHECK(scanCheckpoint->getPhase() == ScanCheckpoint::Phase::ScanningFiles);
+		CHECK(scanCheckpoint->getLastDirectory().empty());
+		CHECK(!scanCheckpoint->getScanStartTime().isValid());
+	}
+
+	{
+		auto transaction {session.createUniqueTransaction()};
+
+		checkpoint.get().modify()->setScanVersion(3);
+		checkpoint.get().modify()->setMediaDirectory("/music");
+		checkpoint.get().modify()->setForceScan(true);
+		checkpoint.get().modify()->setPhase(ScanCheckpoint::Phase::FilesScanned);
+		checkpoint.get().modify()->setLastDirectory("/music/MyDirectory");
+		checkpoint.get().modify()->setScanStartTime(Wt::WDateTime::fromTime_t(1000));
+	}
+
+	{
+		auto transaction {session.createSharedTransaction()};
+
+		auto scanCheckpoint {ScanCheckpoint::get(session)};
+		CHECK(scanCheckpoint);
+		CHECK(scanCheckpoint->getScanVersion() == 3);
+		CHECK(scanCheckpoint->getMediaDirectory() == "/music");
+		CHECK(scanCheckpoint->isForceScan());
+		CHECK(scanCheckpoint->getPhase() == ScanCheckpoint::Phase::FilesScanned);
+		CHECK(scanCheckpoint->getLastDirectory() == "/music/MyDirectory");
+		CHECK(scanCheckpoint->getScanStartTime().toTime_t() == 1000);
+	}
+}
+
+static
+void
+testConcurrentReadDuringWrite(Db& db, Session& session)
+{
+	Session otherSession {db};
+
+	{
+		auto uniqueTransaction {session.createUniqueTransaction()};
+
+		auto track {Track::create(session, "/music/MyTrack.mp3")};
+		CHECK(Track::getCount(session) == 1);
+
+		// The reader must not wait for the writer and only sees the committed changes
+		std::size_t readerTrackCount {1};
+		std::thread reader {[&]
+		{
+			auto sharedTransaction {otherSession.createSharedTransaction()};
+			readerTrackCount = Track::getCount(otherSession);
+		}};
+		reader.join();
+
+		CHECK(readerTrackCount == 0);
+
+		track.remove();
+	}
+}
+
+static
+void
+testStatementCacheReuse(Db& db, Session& session)
+{
+	ScopedTrack track {session, "/music/MyTrack.mp3"};
+
+	auto getTrackCount {[&]
+	{
+		auto transaction {session.createSharedTransaction()};
+		return Track::getCount(session);
+	}};
+
+	CHECK(getTrackCount() == 1);
+
+	const Db::StatementCacheStats stats {db.getStatementCacheStats()};
+	CHECK(getTrackCount() == 1);
+	CHECK(db.getStatementCacheStats().hits > stats.hits);
+	CHECK(db.getStatementCacheStats().misses == stats.misses);
+}
+
+static
+void
+testUniqueTransactionInSharedTransaction(Session& session)
+{
+	auto transaction {session.createSharedTransaction()};
+
+	bool thrown {};
+	try
+	{
+		auto uniqueTransaction {session.createUniqueTransaction()};
+	}
+	catch (const LmsException&)
+	{
+		thrown = true;
+	}
+	CHECK(thrown);
+}
+
 static
 void
 testDatabaseEmpty(Session& session)
@@ -1879,7 +2434,9 @@ testDatabaseEmpty(Session& session)
 	CHECK(Artist::getAll(session, Artist::SortMethod::ByName).empty());
 	CHECK(Cluster::getAll(session).empty());
 	CHECK(ClusterType::getAll(session).empty());
+	CHECK(Directory::getAll(session).empty());
 	CHECK(Release::getAll(session).empty());
+	CHECK(!ScanCheckpoint::get(session));
 	CHECK(Track::getAll(session).empty());
 	CHECK(TrackBookmark::getAll(session).empty());
 	CHECK(TrackList::getAll(session).empty());
@@ -1899,7 +2456,9 @@ int main()
 
 		std::cout << "Database test file: '" << tmpFile.string() << "'" << std::endl;
 
-		Database::Db db {tmpFile};
+		Database::Db::Parameters dbParameters;
+		dbParameters.concurrencyMode = Database::Db::ConcurrencyMode::Concurrent;
+		Database::Db db {tmpFile, dbParameters};
 		Database::Session session {db};
 		session.prepareTables();
 
@@ -1917,19 +2476,28 @@ int main()
 		RUN_TEST(testRemoveDefaultEntries);
 
 		RUN_TEST(testSingleTrack);
+		RUN_TEST(testMultiTracksByDirectory);
+		RUN_TEST(testMultiTracksFileInfos);
+		RUN_TEST(testSingleTrackMove);
+		RUN_TEST(testSingleTrackEmbeddedCover);
+		RUN_TEST(testMultiTracksRemoveByIds);
 		RUN_TEST(testSingleArtist);
 		RUN_TEST(testSingleRelease);
 		RUN_TEST(testSingleCluster);
 
+		RUN_TEST(testRemoveAllOrphans);
 		RUN_TEST(testSingleTrackSingleArtist);
 		RUN_TEST(testSingleTrackSingleArtistMultiRoles);
 		RUN_TEST(testSingleTrackMultiArtists);
 
 		RUN_TEST(testSingleArtistSearchByName);
+		RUN_TEST(testFullTextSearch);
 		RUN_TEST(testMultiArtistsSortMethod);
 
 		RUN_TEST(testSingleTrackSingleRelease);
 		RUN_TEST(testMultiTracksSingleReleaseTotalDiscTrack);
+		RUN_TEST(testReleaseAggregates);
+		RUN_TEST(testReleaseKeysetPagination);
 
 		RUN_TEST(testSingleTrackSingleCluster);
 		RUN_TEST(testMultipleTracksSingleCluster);
@@ -1965,6 +2533,15 @@ int main()
 		RUN_TEST(testMultipleTracksMultipleReleasesMultiClusters);
 
 		RUN_TEST(testSingleTrackSingleUserSingleBookmark);
+
+		RUN_TEST(testSingleDirectory);
+
+		RUN_TEST(testSingleScanCheckpoint);
+
+		RUN_TEST(testUniqueTransactionInSharedTransaction);
+
+		runTest("testConcurrentReadDuringWrite", [&db](Session& session) { testConcurrentReadDuringWrite(db, session); });
+		runTest("testStatementCacheReuse", [&db](Session& session) { testStatementCacheReuse(db, session); });
 	}
 	catch (std::exception& e)
 	{
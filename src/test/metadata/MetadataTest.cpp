@@ -0,0 +1,424 @@
+/*
+ * Copyright (C) 2020 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <optional>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <taglib/flacfile.h>
+#include <taglib/id3v2tag.h>
+#include <taglib/mpegfile.h>
+#include <taglib/tpropertymap.h>
+
+#include "metadata/NativeParser.hpp"
+#include "metadata/TagLibParser.hpp"
+#include "utils/Logger.hpp"
+#include "utils/Service.hpp"
+#include "utils/StreamLogger.hpp"
+
+#include "LibraryGenerator.hpp"
+
+#define CHECK(PRED)  \
+	do \
+	{ \
+		if (!(PRED)) \
+		{ \
+			std::string error {"Predicate FAILED '" + std::string {#PRED} + "' at " + __FUNCTION__ + "@l." + std::to_string(__LINE__)}; \
+			std::cerr << error << std::endl; \
+			throw std::runtime_error {error}; \
+		} \
+	} while (0)
+
+#define RUN_TEST(test) \
+	do \
+	{ \
+		std::cout << "Running test '" << #test << "'..." << std::endl; \
+		test(); \
+		std::cout << "Running test '" << #test << "': SUCCESS" << std::endl; \
+	} while (0)
+
+namespace {
+
+class ScopedDirectory
+{
+	public:
+		ScopedDirectory()
+		{
+			std::filesystem::create_directories(_path);
+		}
+
+		~ScopedDirectory()
+		{
+			std::error_code ec;
+			std::filesystem::remove_all(_path, ec);
+		}
+
+		ScopedDirectory(const ScopedDirectory&) = delete;
+		ScopedDirectory(ScopedDirectory&&) = delete;
+		ScopedDirectory& operator=(const ScopedDirectory&) = delete;
+		ScopedDirectory& operator=(ScopedDirectory&&) = delete;
+
+		const std::filesystem::path& getPath() const { return _path; }
+
+	private:
+		const std::filesystem::path _path {std::filesystem::temp_directory_path() / ("lms-test-metadata-" + std::to_string(std::random_device {}()))};
+};
+
+std::string
+readFile(const std::filesystem::path& file)
+{
+	std::ifstream ifs {file, std::ios_base::binary};
+	return std::string {std::istreambuf_iterator<char> {ifs}, std::istreambuf_iterator<char> {}};
+}
+
+void
+writeFile(const std::filesystem::path& file, const std::string& data)
+{
+	std::ofstream ofs {file, std::ios_base::binary};
+	ofs.write(data.data(), data.size());
+	if (!ofs)
+		throw std::runtime_error {"Cannot write file '" + file.string() + "'"};
+}
+
+std::filesystem::path
+generateFile(const std::filesystem::path& directory, LibraryGenerator::Format format, bool hasCover)
+{
+	LibraryGenerator::Parameters parameters;
+	parameters.fileCount = 1;
+	parameters.artistCount = 1;
+	parameters.genreCount = 1;
+	parameters.coverRatio = hasCover ? 1 : 0;
+	parameters.formats = {format};
+
+	const std::vector<std::filesystem::path> files {LibraryGenerator::generate(directory, parameters)};
+	CHECK(files.size() == 1);
+
+	return files.front();
+}
+
+// Values that use most of the tag mapping, with multiple values
+TagLib::PropertyMap
+createProperties()
+{
+	auto toStringList {[](std::initializer_list<const char*> values)
+	{
+		TagLib::StringList res;
+		for (const char* value : values)
+			res.append(TagLib::String {value, TagLib::String::UTF8});
+		return res;
+	}};
+
+	TagLib::PropertyMap properties;
+	properties.insert("TITLE", toStringList({"Café del Mar"}));
+	properties.insert("ARTIST", toStringList({"Artist A", "Artist B"}));
+	properties.insert("ARTISTSORT", toStringList({"A, Artist", "B, Artist"}));
+	properties.insert("MUSICBRAINZ_ARTISTID", toStringList({"11111111-1111-4111-8111-111111111111", "22222222-2222-4222-8222-222222222222"}));
+	properties.insert("ALBUMARTIST", toStringList({"Album Artist"}));
+	properties.insert("MUSICBRAINZ_ALBUMARTISTID", toStringList({"33333333-3333-4333-8333-333333333333"}));
+	properties.insert("ALBUM", toStringList({"Déjà Vu"}));
+	properties.insert("MUSICBRAINZ_ALBUMID", toStringList({"44444444-4444-4444-8444-444444444444"}));
+	properties.insert("MUSICBRAINZ_TRACKID", toStringList({"55555555-5555-4555-8555-555555555555"}));
+	properties.insert("TRACKNUMBER", toStringList({"3/12"}));
+	properties.insert("DISCNUMBER", toStringList({"1/2"}));
+	properties.insert("DISCSUBTITLE", toStringList({"Bonus"}));
+	properties.insert("DATE", toStringList({"2001-02-03"}));
+	properties.insert("ORIGINALDATE", toStringList({"1999"}));
+	properties.insert("GENRE", toStringList({"Rock", "Pop"}));
+	properties.insert("MOOD", toStringList({"Happy"}));
+	properties.insert("COPYRIGHT", toStringList({"(C) 2001 Label"}));
+	properties.insert("REPLAYGAIN_TRACK_GAIN", toStringList({"-6.54 dB"}));
+	properties.insert("REPLAYGAIN_ALBUM_GAIN", toStringList({"-5.43 dB"}));
+
+	return properties;
+}
+
+void
+setFlacProperties(const std::filesystem::path& file, const TagLib::PropertyMap& properties)
+{
+	TagLib::FLAC::File flacFile {file.c_str()};
+	CHECK(flacFile.isValid());
+
+	flacFile.setProperties(properties);
+	CHECK(flacFile.save());
+}
+
+void
+setMpegProperties(const std::filesystem::path& file, const TagLib::PropertyMap& properties, int id3v2Version)
+{
+	TagLib::MPEG::File mpegFile {file.c_str()};
+	CHECK(mpegFile.isValid());
+
+	mpegFile.ID3v2Tag(true)->setProperties(properties);
+	CHECK(mpegFile.save(TagLib::MPEG::File::ID3v2, true, id3v2Version));
+}
+
+std::string
+encodeSyncSafeU32(std::uint32_t value)
+{
+	return std::string {static_cast<char>((value >> 21) & 0x7F), static_cast<char>((value >> 14) & 0x7F), static_cast<char>((value >> 7) & 0x7F), static_cast<char>(value & 0x7F)};
+}
+
+std::string
+encodeU32BE(std::uint32_t value)
+{
+	return std::string {static_cast<char>(value >> 24), static_cast<char>(value >> 16), static_cast<char>(value >> 8), static_cast<char>(value)};
+}
+
+// Latin-1 text frame, whose size may not match its data
+std::string
+createTextFrame(unsigned majorVersion, const std::string& frameId, const std::string& text, std::optional<std::uint32_t> frameSize = std::nullopt)
+{
+	const std::string data {'\0' + text};
+	const std::uint32_t size {frameSize ? *frameSize : static_cast<std::uint32_t>(data.size())};
+
+	return frameId + (majorVersion == 4 ? encodeSyncSafeU32(size) : encodeU32BE(size)) + std::string(2, '\0') + data;
+}
+
+// Replaces the ID3v2 tag of a generated MP3 file
+void
+setId3v2Tag(const std::filesystem::path& file, unsigned majorVersion, const std::string& frames)
+{
+	const std::string content {readFile(file)};
+	CHECK(content.substr(0, 3) == "ID3");
+
+	std::uint32_t tagSize {};
+	for (std::size_t i {6}; i < 10; ++i)
+		tagSize = (tagSize << 7) | (static_cast<std::uint8_t>(content[i]) & 0x7F);
+
+	const std::string header {"ID3" + std::string {static_cast<char>(majorVersion), '\0', '\0'} + encodeSyncSafeU32(static_cast<std::uint32_t>(frames.size()))};
+	writeFile(file, header + frames + content.substr(10 + tagSize));
+}
+
+std::optional<std::string>
+toString(const std::optional<UUID>& uuid)
+{
+	return uuid ? std::make_optional(std::string {uuid->getAsString()}) : std::nullopt;
+}
+
+void
+checkSameArtists(const std::vector<MetaData::Artist>& nativeArtists, const std::vector<MetaData::Artist>& tagLibArtists)
+{
+	CHECK(nativeArtists.size() == tagLibArtists.size());
+	for (std::size_t i {}; i < nativeArtists.size(); ++i)
+	{
+		CHECK(nativeArtists[i].name == tagLibArtists[i].name);
+		CHECK(nativeArtists[i].sortName == tagLibArtists[i].sortName);
+		CHECK(toString(nativeArtists[i].musicBrainzArtistID) == toString(tagLibArtists[i].musicBrainzArtistID));
+	}
+}
+
+void
+checkSameTrack(const MetaData::Track& native, const MetaData::Track& tagLib)
+{
+	checkSameArtists(native.artists, tagLib.artists);
+	checkSameArtists(native.albumArtists, tagLib.albumArtists);
+	CHECK(native.title == tagLib.title);
+	CHECK(toString(native.musicBrainzTrackID) == toString(tagLib.musicBrainzTrackID));
+	CHECK(toString(native.musicBrainzRecordID) == toString(tagLib.musicBrainzRecordID));
+	CHECK(native.album.has_value() == tagLib.album.has_value());
+	if (native.album)
+	{
+		CHECK(native.album->name == tagLib.album->name);
+		CHECK(toString(native.album->musicBrainzAlbumID) == toString(tagLib.album->musicBrainzAlbumID));
+	}
+	CHECK(native.clusters == tagLib.clusters);
+	CHECK(native.duration == tagLib.duration);
+	CHECK(native.trackNumber == tagLib.trackNumber);
+	CHECK(native.totalTrack == tagLib.totalTrack);
+	CHECK(native.discNumber == tagLib.discNumber);
+	CHECK(native.totalDisc == tagLib.totalDisc);
+	CHECK(native.year == tagLib.year);
+	CHECK(native.originalYear == tagLib.originalYear);
+	CHECK(native.hasCover == tagLib.hasCover);
+	CHECK(native.embeddedCover.has_value() == tagLib.embeddedCover.has_value());
+	if (native.embeddedCover)
+	{
+		CHECK(native.embeddedCover->offset == tagLib.embeddedCover->offset);
+		CHECK(native.embeddedCover->size == tagLib.embeddedCover->size);
+		CHECK(native.embeddedCover->mimeType == tagLib.embeddedCover->mimeType);
+		CHECK(native.embeddedCover->width == tagLib.embeddedCover->width);
+		CHECK(native.embeddedCover->height == tagLib.embeddedCover->height);
+	}
+	CHECK(native.audioStreams.size() == tagLib.audioStreams.size());
+	for (std::size_t i {}; i < native.audioStreams.size(); ++i)
+		CHECK(native.audioStreams[i].bitRate == tagLib.audioStreams[i].bitRate);
+	CHECK(toString(native.acoustID) == toString(tagLib.acoustID));
+	CHECK(native.copyright == tagLib.copyright);
+	CHECK(native.copyrightURL == tagLib.copyrightURL);
+	CHECK(native.trackReplayGain == tagLib.trackReplayGain);
+	CHECK(native.albumReplayGain == tagLib.albumReplayGain);
+	CHECK(native.discSubtitle == tagLib.discSubtitle);
+}
+
+// The file must be read by the native readers, not by their TagLib fallback
+MetaData::Track
+parseAndCompare(const std::filesystem::path& file)
+{
+	const std::set<std::string> clusterTypeNames {"GENRE", "MOOD"};
+
+	MetaData::NativeParser nativeParser;
+	MetaData::IParser& nativeIParser {nativeParser};
+	nativeIParser.setClusterTypeNames(clusterTypeNames);
+
+	MetaData::TagLibParser tagLibParser;
+	MetaData::IParser& tagLibIParser {tagLibParser};
+	tagLibIParser.setClusterTypeNames(clusterTypeNames);
+
+	const std::optional<MetaData::Track> native {nativeIParser.parse(file)};
+	CHECK(nativeParser.getFallbackCount() == 0);
+	const std::optional<MetaData::Track> tagLib {tagLibIParser.parse(file)};
+
+	CHECK(native);
+	CHECK(tagLib);
+	checkSameTrack(*native, *tagLib);
+
+	return *native;
+}
+
+} // namespace
+
+static
+void
+testFlac()
+{
+	ScopedDirectory directory;
+
+	const std::filesystem::path file {generateFile(directory.getPath(), LibraryGenerator::Format::FLAC, true)};
+	setFlacProperties(file, createProperties());
+
+	const MetaData::Track track {parseAndCompare(file)};
+	CHECK(track.artists.size() == 2);
+	CHECK(track.clusters.at("GENRE").size() == 2);
+	CHECK(track.hasCover);
+	CHECK(track.embeddedCover);
+	CHECK(track.embeddedCover->mimeType == "image/png");
+	CHECK(track.embeddedCover->width == 1 && track.embeddedCover->height == 1);
+}
+
+static
+void
+testFlacNoCover()
+{
+	ScopedDirectory directory;
+
+	const std::filesystem::path file {generateFile(directory.getPath(), LibraryGenerator::Format::FLAC, false)};
+
+	const MetaData::Track track {parseAndCompare(file)};
+	CHECK(!track.hasCover);
+	CHECK(!track.embeddedCover);
+}
+
+static
+void
+testMpegId3v2Versions()
+{
+	for (int id3v2Version : {3, 4})
+	{
+		std::cout << "ID3v2." << id3v2Version << std::endl;
+
+		ScopedDirectory directory;
+
+		const std::filesystem::path file {generateFile(directory.getPath(), LibraryGenerator::Format::MP3, true)};
+		setMpegProperties(file, createProperties(), id3v2Version);
+		CHECK(static_cast<int>(readFile(file)[3]) == id3v2Version);
+
+		const MetaData::Track track {parseAndCompare(file)};
+		CHECK(track.title == "Café del Mar");
+		CHECK(track.hasCover);
+		CHECK(track.embeddedCover);
+		CHECK(track.embeddedCover->mimeType == "image/png");
+		CHECK(track.embeddedCover->width == 1 && track.embeddedCover->height == 1);
+	}
+}
+
+static
+void
+testMpegNoTag()
+{
+	ScopedDirectory directory;
+
+	const std::filesystem::path file {generateFile(directory.getPath(), LibraryGenerator::Format::MP3, false)};
+	{
+		TagLib::MPEG::File mpegFile {file.c_str()};
+		CHECK(mpegFile.strip());
+	}
+	CHECK(readFile(file).substr(0, 3) != "ID3");
+
+	const MetaData::Track track {parseAndCompare(file)};
+	CHECK(track.title.empty());
+	CHECK(!track.hasCover);
+}
+
+static
+void
+testMpegTruncatedFrame()
+{
+	for (unsigned majorVersion : {3, 4})
+	{
+		std::cout << "ID3v2." << majorVersion << std::endl;
+
+		ScopedDirectory directory;
+
+		const std::filesystem::path file {generateFile(directory.getPath(), LibraryGenerator::Format::MP3, false)};
+
+		// The album frame claims more data than left in the tag: it ends the parsing
+		const std::string frames {createTextFrame(majorVersion, "TIT2", "Title")
+			+ createTextFrame(majorVersion, "TPE1", "Artist")
+			+ createTextFrame(majorVersion, "TALB", "Album", 1000)};
+		setId3v2Tag(file, majorVersion, frames);
+
+		const MetaData::Track track {parseAndCompare(file)};
+		CHECK(track.title == "Title");
+		CHECK(track.artists.size() == 1);
+		CHECK(!track.album);
+	}
+}
+
+int main()
+{
+	try
+	{
+		// log to stdout
+		Service<Logger> logger {std::make_unique<StreamLogger>(std::cout)};
+
+		RUN_TEST(testFlac);
+		RUN_TEST(testFlacNoCover);
+		RUN_TEST(testMpegId3v2Versions);
+		RUN_TEST(testMpegNoTag);
+		RUN_TEST(testMpegTruncatedFrame);
+	}
+	catch (std::exception& e)
+	{
+		std::cerr << "Caught exception: " << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
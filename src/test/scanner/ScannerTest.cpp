@@ -0,0 +1,363 @@
+/*
+ * Copyright (C) 2020 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/asio.hpp>
+
+#include "utils/Logger.hpp"
+#include "utils/Service.hpp"
+#include "utils/StreamLogger.hpp"
+#include "utils/UUID.hpp"
+
+#include "AcousticBrainzUtils.hpp"
+#include "DiscoveredFiles.hpp"
+
+#define CHECK(PRED)  \
+	do \
+	{ \
+		if (!(PRED)) \
+		{ \
+			std::string error {"Predicate FAILED '" + std::string {#PRED} + "' at " + __FUNCTION__ + "@l." + std::to_string(__LINE__)}; \
+			std::cerr << error << std::endl; \
+			throw std::runtime_error {error}; \
+		} \
+	} while (0)
+
+#define RUN_TEST(test) \
+	do \
+	{ \
+		std::cout << "Running test '" << #test << "'..." << std::endl; \
+		test(); \
+		std::cout << "Running test '" << #test << "': SUCCESS" << std::endl; \
+	} while (0)
+
+namespace {
+
+// Serves canned "low-level" bulk responses on the loopback interface
+class MockAcousticBrainzServer
+{
+	public:
+		// Features of the known recordings, as raw JSON
+		MockAcousticBrainzServer(std::map<std::string, std::string> features, std::size_t rateLimitedRequestCount)
+		: _features {std::move(features)}
+		, _rateLimitedRequestCount {rateLimitedRequestCount}
+		{
+			accept();
+			_thread = std::thread {[this] { _ioService.run(); }};
+		}
+
+		~MockAcousticBrainzServer()
+		{
+			_ioService.stop();
+			_thread.join();
+		}
+
+		MockAcousticBrainzServer(const MockAcousticBrainzServer&) = delete;
+		MockAcousticBrainzServer& operator=(const MockAcousticBrainzServer&) = delete;
+
+		std::string getApiURL() const { return "http://127.0.0.1:" + std::to_string(_acceptor.local_endpoint().port()) + "/api/v1/"; }
+		std::size_t getRequestCount() const { return _requestCount; }
+		std::size_t getMaxMBIDsPerRequest() const { return _maxMBIDsPerRequest; }
+
+	private:
+		struct Connection
+		{
+			Connection(boost::asio::io_service& ioService) : socket {ioService} {}
+
+			boost::asio::ip::tcp::socket	socket;
+			boost::asio::streambuf		request;
+			std::string			response;
+		};
+
+		void accept()
+		{
+			auto connection {std::make_shared<Connection>(_ioService)};
+			_acceptor.async_accept(connection->socket, [this, connection](const boost::system::error_code& ec)
+			{
+				if (ec)
+					return;
+
+				boost::asio::async_read_until(connection->socket, connection->request, "\r\n\r\n", [this, connection](const boost::system::error_code& ec, std::size_t)
+				{
+					if (ec)
+						return;
+
+					std::istream is {&connection->request};
+					std::string method;
+					std::string target;
+					is >> method >> target;
+
+					connection->response = handleRequest(target);
+					boost::asio::async_write(connection->socket, boost::asio::buffer(connection->response), [connection](const boost::system::error_code&, std::size_t)
+					{
+						boost::system::error_code ec;
+						connection->socket.shutdown(boost::asio::ip::tcp::socket::shutdown_both, ec);
+					});
+				});
+
+				accept();
+			});
+		}
+
+		std::string handleRequest(const std::string& target)
+		{
+			_requestCount++;
+
+			if (_rateLimitedRequestCount > 0)
+			{
+				_rateLimitedRequestCount--;
+				return "HTTP/1.1 429 Too Many Requests\r\nX-RateLimit-Reset-In: 1\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+			}
+
+			static const std::string prefix {"/api/v1/low-level?recording_ids="};
+			if (target.compare(0, prefix.size(), prefix) != 0)
+				return "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+
+			std::vector<std::string> MBIDs;
+			std::string::size_type pos {prefix.size()};
+			while (pos <= target.size())
+			{
+				const std::string::size_type end {std::min(target.find(';', pos), target.size())};
+				MBIDs.push_back(target.substr(pos, end - pos));
+				pos = end + 1;
+			}
+			_maxMBIDsPerRequest = std::max(_maxMBIDsPerRequest.load(), MBIDs.size());
+
+			std::string body {"{"};
+			for (const std::string& MBID : MBIDs)
+			{
+				auto itFeatures {_features.find(MBID)};
+				if (itFeatures == std::cend(_features))
+					continue;
+
+				if (body.size() > 1)
+					body += ", ";
+				body += "\"" + MBID + "\": {\"0\": " + itFeatures->second + "}";
+			}
+			body += "}";
+
+			return "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: " + std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n" + body;
+		}
+
+		const std::map<std::string, std::string>	_features;
+		std::size_t					_rateLimitedRequestCount;
+		std::atomic<std::size_t>			_requestCount {};
+		std::atomic<std::size_t>			_maxMBIDsPerRequest {};
+		boost::asio::io_service				_ioService;
+		boost::asio::ip::tcp::acceptor			_acceptor {_ioService, boost::asio::ip::tcp::endpoint {boost::asio::ip::address_v4::loopback(), 0}};
+		std::thread					_thread;
+};
+
+UUID
+makeMBID(std::size_t index)
+{
+	std::string str {"00000000-0000-0000-0000-000000000000"};
+	const std::string suffix {std::to_string(index)};
+	str.replace(str.size() - suffix.size(), suffix.size(), suffix);
+
+	return *UUID::fromString(str);
+}
+
+} // namespace
+
+static
+void
+testExtractLowLevelFeatures()
+{
+	const UUID MBID1 {makeMBID(1)};
+	const UUID MBID2 {makeMBID(2)};
+	const UUID MBID3 {makeMBID(3)};
+
+	const std::string response {"{\"" + std::string {MBID1.getAsString()} + "\": {\"0\": {\"lowlevel\": {\"average_loudness\": 0.87, \"tags\": [\"}\", {\"a\": null}]}}},"
+		" \"" + std::string {MBID2.getAsString()} + "\": {\"1\": {}}}"};
+
+	// Stored as is: numbers must not be turned into strings
+	CHECK(AcousticBrainz::extractLowLevelFeatures(response, MBID1) == "{\"lowlevel\": {\"average_loudness\": 0.87, \"tags\": [\"}\", {\"a\": null}]}}");
+	CHECK(AcousticBrainz::extractLowLevelFeatures(response, MBID2).empty());
+	CHECK(AcousticBrainz::extractLowLevelFeatures(response, MBID3).empty());
+
+	CHECK(AcousticBrainz::extractLowLevelFeatures("", MBID1).empty());
+	CHECK(AcousticBrainz::extractLowLevelFeatures("{\"" + std::string {MBID1.getAsString()} + "\": {\"0\": {\"lowlevel\": ", MBID1).empty());
+	CHECK(AcousticBrainz::extractLowLevelFeatures("<html></html>", MBID1).empty());
+}
+
+static
+void
+testFetchLowLevelFeatures()
+{
+	constexpr std::size_t MBIDCount {7};
+	constexpr std::size_t missingMBIDIndex {3};
+
+	std::vector<UUID> MBIDs;
+	std::map<std::string, std::string> features;
+	for (std::size_t i {}; i < MBIDCount; ++i)
+	{
+		MBIDs.push_back(makeMBID(i));
+		if (i != missingMBIDIndex)
+			features.emplace(MBIDs.back().getAsString(), "{\"lowlevel\": {\"average_loudness\": " + std::to_string(i) + ".5}}");
+	}
+
+	// The first request is rate limited and has to be retried
+	MockAcousticBrainzServer server {features, 1};
+
+	AcousticBrainz::FetchParameters parameters;
+	parameters.apiURL = server.getApiURL();
+	parameters.maxMBIDsPerRequest = 2;
+	parameters.maxConcurrentRequests = 2;
+
+	std::map<std::string, std::string> fetchedFeatures;
+	std::atomic<bool> abort {};
+	AcousticBrainz::fetchLowLevelFeatures(parameters, MBIDs, [&](const UUID& MBID, const std::string& lowLevelFeatures)
+	{
+		CHECK(fetchedFeatures.emplace(MBID.getAsString(), lowLevelFeatures).second);
+	}, abort);
+
+	CHECK(fetchedFeatures.size() == MBIDCount);
+	for (std::size_t i {}; i < MBIDCount; ++i)
+	{
+		const std::string& lowLevelFeatures {fetchedFeatures[std::string {MBIDs[i].getAsString()}]};
+		if (i == missingMBIDIndex)
+			CHECK(lowLevelFeatures.empty());
+		else
+			CHECK(lowLevelFeatures == features[std::string {MBIDs[i].getAsString()}]);
+	}
+
+	CHECK(server.getMaxMBIDsPerRequest() == 2);
+	CHECK(server.getRequestCount() == (MBIDCount + 1) / 2 + 1);
+}
+
+static
+void
+testFetchLowLevelFeaturesUnreachable()
+{
+	std::string apiURL;
+	{
+		// Nothing listens there anymore
+		MockAcousticBrainzServer server {{}, 0};
+		apiURL = server.getApiURL();
+	}
+
+	AcousticBrainz::FetchParameters parameters;
+	parameters.apiURL = apiURL;
+
+	std::size_t failureCount {};
+	std::atomic<bool> abort {};
+	AcousticBrainz::fetchLowLevelFeatures(parameters, {makeMBID(1), makeMBID(2)}, [&](const UUID&, const std::string& lowLevelFeatures)
+	{
+		CHECK(lowLevelFeatures.empty());
+		failureCount++;
+	}, abort);
+
+	CHECK(failureCount == 2);
+}
+
+static
+void
+testFindWrittenDirectories()
+{
+	using namespace Scanner;
+
+	const Wt::WDateTime scanStartTime {Wt::WDateTime::fromTime_t(1000)};
+	const DirectoryFingerprint oldFingerprint {Wt::WDateTime::fromTime_t(500), 2, 0};
+	const DirectoryFingerprint newFingerprint {Wt::WDateTime::fromTime_t(1500), 2, 0};
+
+	// Written by the aborted scan, except for the files of /music/c
+	const std::set<std::filesystem::path> writtenFiles {"/music/b/1.mp3", "/music/b/2.mp3", "/music/d/1.mp3", "/music/d/2.mp3", "/music/e/1.mp3", "/music/e/2.mp3"};
+	auto isFileWritten {[&](const std::filesystem::path& file) { return writtenFiles.find(file) != std::cend(writtenFiles); }};
+
+	DiscoveredFiles discoveredFiles;
+	discoveredFiles.addDirectory("/music/e", oldFingerprint, {"1.mp3", "2.mp3"});
+	discoveredFiles.addDirectory("/music/d", oldFingerprint, {"1.mp3", "2.mp3"});
+	discoveredFiles.addDirectory("/music/a", newFingerprint, {"1.mp3", "2.mp3"});	// created after the abort
+	discoveredFiles.addDirectory("/music/c", oldFingerprint, {"1.mp3", "2.mp3"});	// moved after the abort
+	discoveredFiles.addDirectory("/music/b", oldFingerprint, {"1.mp3", "2.mp3"});
+	discoveredFiles.sortDirectories();
+
+	{
+		const std::vector<bool> written {discoveredFiles.findWrittenDirectories("/music/d", scanStartTime, isFileWritten)};
+		CHECK((written == std::vector<bool> {false, true, false, true, false}));
+	}
+
+	{
+		// Last directory removed since
+		const std::vector<bool> written {discoveredFiles.findWrittenDirectories("/music/d0", scanStartTime, isFileWritten)};
+		CHECK((written == std::vector<bool> {false, true, false, true, false}));
+	}
+
+	{
+		// Saved before the scan start time was stored
+		const std::vector<bool> written {discoveredFiles.findWrittenDirectories("/music/d", {}, isFileWritten)};
+		CHECK((written == std::vector<bool> {false, false, false, false, false}));
+	}
+
+	{
+		const std::vector<bool> written {discoveredFiles.findWrittenDirectories("", scanStartTime, isFileWritten)};
+		CHECK((written == std::vector<bool> {false, false, false, false, false}));
+	}
+
+	// The new directory comes first
+	discoveredFiles.sortDirectoriesByLastWriteTime();
+	CHECK(discoveredFiles.getDirectories().front().path == "/music/a");
+
+	{
+		const std::vector<bool> written {discoveredFiles.findWrittenDirectories("/music/c", scanStartTime, isFileWritten)};
+		CHECK((written == std::vector<bool> {false, true, false, false, false}));
+	}
+
+	{
+		// Last directory removed since: cannot tell which directories came before it
+		const std::vector<bool> written {discoveredFiles.findWrittenDirectories("/music/d0", scanStartTime, isFileWritten)};
+		CHECK((written == std::vector<bool> {false, false, false, false, false}));
+	}
+}
+
+int main()
+{
+	try
+	{
+		// log to stdout
+		Service<Logger> logger {std::make_unique<StreamLogger>(std::cout)};
+
+		RUN_TEST(testExtractLowLevelFeatures);
+		RUN_TEST(testFetchLowLevelFeatures);
+		RUN_TEST(testFetchLowLevelFeaturesUnreachable);
+		RUN_TEST(testFindWrittenDirectories);
+	}
+	catch (std::exception& e)
+	{
+		std::cerr << "Caught exception: " << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,210 @@
+/*
+ * Copyright (C) 2020 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <stdlib.h>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <boost/program_options.hpp>
+
+#include "database/Db.hpp"
+#include "database/Session.hpp"
+#include "database/Track.hpp"
+#include "database/TrackFeatures.hpp"
+#include "utils/IConfig.hpp"
+#include "utils/Service.hpp"
+#include "utils/StreamLogger.hpp"
+#include "utils/UUID.hpp"
+
+// Imports low level features from an extracted AcousticBrainz dump
+// Dump files are named '<mbid>-<submission>.json' (or '<mbid>.json'), only the first submission is used
+
+using TrackIdsByMBID = std::unordered_map<std::string, std::vector<Database::IdType>>;
+
+static
+TrackIdsByMBID
+getTracksToImport(Database::Session& session)
+{
+	TrackIdsByMBID res;
+
+	auto transaction {session.createSharedTransaction()};
+
+	for (const Database::Track::pointer& track : Database::Track::getAllWithMBIDAndMissingFeatures(session))
+		res[std::string {track->getMBID()->getAsString()}].push_back(track.id());
+
+	return res;
+}
+
+static
+std::optional<std::string>
+getDumpFileMBID(const std::filesystem::path& file)
+{
+	if (file.extension() != ".json")
+		return std::nullopt;
+
+	std::string stem {file.stem().string()};
+
+	const std::size_t dashCount {static_cast<std::size_t>(std::count(std::cbegin(stem), std::cend(stem), '-'))};
+	if (dashCount == 5)
+	{
+		// Skip submissions other than the first one
+		const std::size_t pos {stem.rfind('-')};
+		if (stem.compare(pos + 1, std::string::npos, "0") != 0)
+			return std::nullopt;
+
+		stem.resize(pos);
+	}
+
+	const std::optional<UUID> MBID {UUID::fromString(stem)};
+	if (!MBID)
+		return std::nullopt;
+
+	return std::string {MBID->getAsString()};
+}
+
+static
+std::string
+readFile(const std::filesystem::path& file)
+{
+	std::ifstream ifs {file, std::ios_base::binary};
+	if (!ifs)
+		throw std::runtime_error {"Cannot open file '" + file.string() + "'"};
+
+	std::ostringstream oss;
+	oss << ifs.rdbuf();
+
+	return oss.str();
+}
+
+static
+void
+importFeatures(Database::Session& session, const std::filesystem::path& dumpDirectory, std::size_t batchSize)
+{
+	TrackIdsByMBID tracksToImport {getTracksToImport(session)};
+	std::cout << tracksToImport.size() << " recording(s) with missing features" << std::endl;
+
+	std::size_t fileCount {};
+	std::size_t importedCount {};
+	std::vector<std::pair<Database::IdType, std::string>> featuresBatch;
+
+	auto writeFeaturesBatch {[&]
+	{
+		if (featuresBatch.empty())
+			return;
+
+		auto transaction {session.createUniqueTransaction()};
+
+		for (const auto& [trackId, lowLevelFeatures] : featuresBatch)
+		{
+			Database::Track::pointer track {Database::Track::getById(session, trackId)};
+			if (!track)
+				continue;
+
+			Database::TrackFeatures::create(session, track, lowLevelFeatures);
+			importedCount++;
+		}
+
+		featuresBatch.clear();
+		std::cout << "Processed " << fileCount << " file(s), imported features for " << importedCount << " track(s)" << std::endl;
+	}};
+
+	for (const std::filesystem::directory_entry& entry : std::filesystem::recursive_directory_iterator {dumpDirectory, std::filesystem::directory_options::skip_permission_denied})
+	{
+		if (tracksToImport.empty())
+			break;
+
+		if (!entry.is_regular_file())
+			continue;
+
+		fileCount++;
+
+		const std::optional<std::string> MBID {getDumpFileMBID(entry.path())};
+		if (!MBID)
+			continue;
+
+		auto itTracks {tracksToImport.find(*MBID)};
+		if (itTracks == std::cend(tracksToImport))
+			continue;
+
+		const std::string lowLevelFeatures {readFile(entry.path())};
+		for (const Database::IdType trackId : itTracks->second)
+			featuresBatch.emplace_back(trackId, lowLevelFeatures);
+
+		tracksToImport.erase(itTracks);
+
+		if (featuresBatch.size() >= batchSize)
+			writeFeaturesBatch();
+	}
+
+	writeFeaturesBatch();
+
+	std::cout << "Import complete: imported features for " << importedCount << " track(s), " << tracksToImport.size() << " recording(s) not found in the dump" << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+	try
+	{
+		namespace po = boost::program_options;
+
+		// log to stdout
+		Service<Logger> logger {std::make_unique<StreamLogger>(std::cout)};
+
+		po::options_description desc{"Allowed options"};
+		desc.add_options()
+		("help,h", "print usage message")
+		("conf,c", po::value<std::string>()->default_value("/etc/lms.conf"), "LMS config file")
+		("dump-dir,d", po::value<std::string>(), "Extracted AcousticBrainz low level dump directory")
+		("batch-size,b", po::value<std::size_t>()->default_value(1000), "Number of tracks written per transaction")
+		;
+
+		po::variables_map vm;
+		po::store(po::parse_command_line(argc, argv, desc), vm);
+
+		if (vm.count("help") || !vm.count("dump-dir"))
+		{
+			std::cout << desc << std::endl;
+			return vm.count("help") ? EXIT_SUCCESS : EXIT_FAILURE;
+		}
+
+		Service<IConfig> config {createConfig(vm["conf"].as<std::string>())};
+
+		Database::Db db {config->getPath("working-dir") / "lms.db"};
+		Database::Session session {db};
+
+		importFeatures(session, vm["dump-dir"].as<std::string>(), std::max<std::size_t>(vm["batch-size"].as<std::size_t>(), 1));
+	}
+	catch (std::exception& e)
+	{
+		std::cerr << "Caught exception: " << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
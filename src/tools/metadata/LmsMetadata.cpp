@@ -18,16 +18,23 @@
  */
 
 #include <chrono>
+#include <iomanip>
 #include <optional>
+#include <set>
+#include <sstream>
 #include <stdexcept>
 #include <stdlib.h>
 #include <iostream>
+#include <string_view>
+#include <vector>
 
 #include <Wt/WDate.h>
 
 #include "metadata/AvFormatParser.hpp"
+#include "metadata/NativeParser.hpp"
 #include "metadata/TagLibParser.hpp"
 #include "utils/StreamLogger.hpp"
+#include "utils/String.hpp"
 
 std::ostream& operator<<(std::ostream& os, const MetaData::Artist& artist)
 {
@@ -145,11 +152,171 @@ void parse(MetaData::IParser& parser, const std::filesystem::path& file)
 	std::cout << std::endl;
 }
 
+template <typename T>
+std::string toString(const std::optional<T>& value)
+{
+	if (!value)
+		return "<none>";
+
+	std::ostringstream oss;
+	oss << *value;
+	return oss.str();
+}
+
+std::string toString(const std::optional<UUID>& uuid)
+{
+	return uuid ? std::string {uuid->getAsString()} : "<none>";
+}
+
+std::string toString(const std::vector<MetaData::Artist>& artists)
+{
+	std::ostringstream oss;
+	for (const MetaData::Artist& artist : artists)
+		oss << "[" << artist << "]";
+	return oss.str();
+}
+
+std::string toString(const MetaData::Clusters& clusters)
+{
+	std::ostringstream oss;
+	for (const auto& [type, names] : clusters)
+	{
+		oss << type << ":";
+		for (const std::string& name : names)
+			oss << "[" << name << "]";
+		oss << " ";
+	}
+	return oss.str();
+}
+
+// Returns the description of the fields that differ
+std::vector<std::string> compareTracks(const MetaData::Track& track, const MetaData::Track& otherTrack)
+{
+	std::vector<std::string> differences;
+
+	auto compare {[&](const char* field, const std::string& value, const std::string& otherValue)
+	{
+		if (value != otherValue)
+			differences.push_back(std::string {field} + ": '" + value + "' / '" + otherValue + "'");
+	}};
+
+	compare("artists", toString(track.artists), toString(otherTrack.artists));
+	compare("album artists", toString(track.albumArtists), toString(otherTrack.albumArtists));
+	compare("title", track.title, otherTrack.title);
+	compare("MB track ID", toString(track.musicBrainzTrackID), toString(otherTrack.musicBrainzTrackID));
+	compare("MB record ID", toString(track.musicBrainzRecordID), toString(otherTrack.musicBrainzRecordID));
+	compare("album", toString(track.album), toString(otherTrack.album));
+	compare("clusters", toString(track.clusters), toString(otherTrack.clusters));
+	compare("duration", std::to_string(track.duration.count()), std::to_string(otherTrack.duration.count()));
+	compare("track number", toString(track.trackNumber), toString(otherTrack.trackNumber));
+	compare("total track", toString(track.totalTrack), toString(otherTrack.totalTrack));
+	compare("disc number", toString(track.discNumber), toString(otherTrack.discNumber));
+	compare("total disc", toString(track.totalDisc), toString(otherTrack.totalDisc));
+	compare("year", toString(track.year), toString(otherTrack.year));
+	compare("original year", toString(track.originalYear), toString(otherTrack.originalYear));
+	compare("has cover", std::to_string(track.hasCover), std::to_string(otherTrack.hasCover));
+	compare("bitrate", std::to_string(track.audioStreams.empty() ? 0 : track.audioStreams.front().bitRate), std::to_string(otherTrack.audioStreams.empty() ? 0 : otherTrack.audioStreams.front().bitRate));
+	compare("AcoustID", toString(track.acoustID), toString(otherTrack.acoustID));
+	compare("copyright", track.copyright, otherTrack.copyright);
+	compare("copyright URL", track.copyrightURL, otherTrack.copyrightURL);
+	compare("track replay gain", toString(track.trackReplayGain), toString(otherTrack.trackReplayGain));
+	compare("album replay gain", toString(track.albumReplayGain), toString(otherTrack.albumReplayGain));
+	compare("disc subtitle", track.discSubtitle, otherTrack.discSubtitle);
+
+	return differences;
+}
+
+// Parses all the FLAC, MP3 and Ogg files of a directory using both TagLib and the native parser
+// The parse order is alternated to share the benefits of the file cache
+int benchmark(const std::filesystem::path& directory)
+{
+	std::vector<std::filesystem::path> files;
+	for (const std::filesystem::directory_entry& entry : std::filesystem::recursive_directory_iterator {directory})
+	{
+		const std::string extension {StringUtils::stringToLower(entry.path().extension().string())};
+		if (entry.is_regular_file() && (extension == ".flac" || extension == ".mp3" || extension == ".ogg" || extension == ".oga" || extension == ".opus"))
+			files.push_back(entry.path());
+	}
+
+	const std::set<std::string> clusterTypeNames {"ALBUMMOOD", "MOOD", "ALBUMGROUPING", "ALBUMGENRE", "GENRE"};
+
+	MetaData::TagLibParser tagLibParser;
+	tagLibParser.setClusterTypeNames(clusterTypeNames);
+	MetaData::NativeParser nativeParser;
+	nativeParser.setClusterTypeNames(clusterTypeNames);
+
+	std::chrono::steady_clock::duration tagLibDuration {};
+	std::chrono::steady_clock::duration nativeDuration {};
+	std::size_t mismatchCount {};
+	std::size_t failureCount {};
+
+	auto timedParse {[](MetaData::IParser& parser, const std::filesystem::path& file, std::chrono::steady_clock::duration& duration)
+	{
+		const auto start {std::chrono::steady_clock::now()};
+		std::optional<MetaData::Track> track {parser.parse(file)};
+		duration += std::chrono::steady_clock::now() - start;
+
+		return track;
+	}};
+
+	for (std::size_t i {}; i < files.size(); ++i)
+	{
+		const std::filesystem::path& file {files[i]};
+
+		std::optional<MetaData::Track> tagLibTrack;
+		std::optional<MetaData::Track> nativeTrack;
+		if (i % 2 == 0)
+		{
+			tagLibTrack = timedParse(tagLibParser, file, tagLibDuration);
+			nativeTrack = timedParse(nativeParser, file, nativeDuration);
+		}
+		else
+		{
+			nativeTrack = timedParse(nativeParser, file, nativeDuration);
+			tagLibTrack = timedParse(tagLibParser, file, tagLibDuration);
+		}
+
+		if (!tagLibTrack || !nativeTrack)
+		{
+			if (tagLibTrack || nativeTrack)
+				std::cout << "File '" << file.string() << "': parsing failed using " << (tagLibTrack ? "native" : "TagLib") << std::endl;
+
+			failureCount++;
+			continue;
+		}
+
+		const std::vector<std::string> differences {compareTracks(*tagLibTrack, *nativeTrack)};
+		if (!differences.empty())
+		{
+			std::cout << "File '" << file.string() << "': mismatch (TagLib / native)" << std::endl;
+			for (const std::string& difference : differences)
+				std::cout << "\t" << difference << std::endl;
+
+			mismatchCount++;
+		}
+	}
+
+	auto toMs {[](std::chrono::steady_clock::duration duration)
+	{
+		return std::chrono::duration_cast<std::chrono::microseconds>(duration).count() / 1000.;
+	}};
+
+	std::cout << std::endl;
+	std::cout << "Files: " << files.size() << " (failures: " << failureCount << ", mismatches: " << mismatchCount << ")" << std::endl;
+	std::cout << "TagLib: " << toMs(tagLibDuration) << "ms" << std::endl;
+	std::cout << "Native: " << toMs(nativeDuration) << "ms (TagLib fallbacks: " << nativeParser.getFallbackCount() << ")" << std::endl;
+	if (nativeDuration.count() > 0)
+		std::cout << "Speedup: " << std::fixed << std::setprecision(2) << static_cast<double>(tagLibDuration.count()) / nativeDuration.count() << "x" << std::endl;
+
+	return mismatchCount == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
 int main(int argc, char *argv[])
 {
 	if (argc == 1)
 	{
 		std::cerr << "Usage: <file> [<file> ...]" << std::endl;
+		std::cerr << "       --benchmark <directory>: compare TagLib and native parsers" << std::endl;
 		return EXIT_FAILURE;
 	}
 
@@ -158,6 +325,17 @@ int main(int argc, char *argv[])
 		// log to stdout
 		Service<Logger> logger {std::make_unique<StreamLogger>(std::cout)};
 
+		if (std::string_view {argv[1]} == "--benchmark")
+		{
+			if (argc != 3)
+			{
+				std::cerr << "Usage: --benchmark <directory>" << std::endl;
+				return EXIT_FAILURE;
+			}
+
+			return benchmark(argv[2]);
+		}
+
 		for (std::size_t  i {}; i < static_cast<std::size_t>(argc - 1); ++i)
 		{
 			std::filesystem::path file {argv[i + 1]};
@@ -175,6 +353,12 @@ int main(int argc, char *argv[])
 				MetaData::TagLibParser parser;
 				parse(parser, file);
 			}
+
+			{
+				std::cout << "Using native:" << std::endl;
+				MetaData::NativeParser parser;
+				parse(parser, file);
+			}
 		}
 
 	}
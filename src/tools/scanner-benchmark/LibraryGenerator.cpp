@@ -0,0 +1,308 @@
+/*
+ * Copyright (C) 2020 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "LibraryGenerator.hpp"
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+
+#include <taglib/attachedpictureframe.h>
+#include <taglib/flacfile.h>
+#include <taglib/flacpicture.h>
+#include <taglib/id3v2tag.h>
+#include <taglib/mpegfile.h>
+#include <taglib/tpropertymap.h>
+
+namespace LibraryGenerator
+{
+
+namespace
+{
+
+// 1x1 PNG image
+constexpr std::array<unsigned char, 69> coverData
+{
+	0x89, 0x50, 0x4e, 0x47, 0x0d, 0x0a, 0x1a, 0x0a, 0x00, 0x00, 0x00, 0x0d,
+	0x49, 0x48, 0x44, 0x52, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01,
+	0x08, 0x02, 0x00, 0x00, 0x00, 0x90, 0x77, 0x53, 0xde, 0x00, 0x00, 0x00,
+	0x0c, 0x49, 0x44, 0x41, 0x54, 0x78, 0x9c, 0x63, 0x68, 0x68, 0x68, 0x00,
+	0x00, 0x03, 0x04, 0x01, 0x81, 0x4b, 0xd3, 0xd2, 0x10, 0x00, 0x00, 0x00,
+	0x00, 0x49, 0x45, 0x4e, 0x44, 0xae, 0x42, 0x60, 0x82,
+};
+
+using Bytes = std::vector<std::uint8_t>;
+
+void
+pushBigEndian(Bytes& bytes, std::uint64_t value, std::size_t byteCount)
+{
+	for (std::size_t i {byteCount}; i > 0; --i)
+		bytes.push_back(static_cast<std::uint8_t>(value >> ((i - 1) * 8)));
+}
+
+std::uint8_t
+computeCRC8(const Bytes& bytes)
+{
+	std::uint8_t crc {};
+	for (std::uint8_t byte : bytes)
+	{
+		crc ^= byte;
+		for (int i {}; i < 8; ++i)
+			crc = (crc & 0x80) ? static_cast<std::uint8_t>((crc << 1) ^ 0x07) : static_cast<std::uint8_t>(crc << 1);
+	}
+	return crc;
+}
+
+std::uint16_t
+computeCRC16(const Bytes& bytes)
+{
+	std::uint16_t crc {};
+	for (std::uint8_t byte : bytes)
+	{
+		crc ^= static_cast<std::uint16_t>(byte << 8);
+		for (int i {}; i < 8; ++i)
+			crc = (crc & 0x8000) ? static_cast<std::uint16_t>((crc << 1) ^ 0x8005) : static_cast<std::uint16_t>(crc << 1);
+	}
+	return crc;
+}
+
+// ~2 seconds of mono 16 bits silence, using constant subframes
+Bytes
+createFLACData()
+{
+	constexpr std::uint64_t blockSize {4096};
+	constexpr std::uint64_t sampleRate {44100};
+	constexpr std::uint64_t frameCount {22};
+
+	Bytes bytes {'f', 'L', 'a', 'C'};
+
+	// STREAMINFO, last metadata block (TagLib adds the other ones)
+	bytes.push_back(0x80);
+	pushBigEndian(bytes, 34, 3);
+	pushBigEndian(bytes, blockSize, 2);	// min block size
+	pushBigEndian(bytes, blockSize, 2);	// max block size
+	pushBigEndian(bytes, 0, 3);		// min frame size (unknown)
+	pushBigEndian(bytes, 0, 3);		// max frame size (unknown)
+	pushBigEndian(bytes, (sampleRate << 44) | (0ULL << 41) /* 1 channel */ | (15ULL << 36) /* 16 bits */ | (blockSize * frameCount), 8);
+	bytes.insert(std::end(bytes), 16, 0);	// MD5 (unknown)
+
+	for (std::uint64_t frameIndex {}; frameIndex < frameCount; ++frameIndex)
+	{
+		// sync + fixed blocking, 4096 samples + 44.1kHz, mono + 16 bits, frame number (< 128: single byte)
+		Bytes frame {0xFF, 0xF8, 0xC9, 0x08, static_cast<std::uint8_t>(frameIndex)};
+		frame.push_back(computeCRC8(frame));
+
+		// Constant subframe, value 0
+		frame.push_back(0x00);
+		pushBigEndian(frame, 0, 2);
+
+		pushBigEndian(frame, computeCRC16(frame), 2);
+
+		bytes.insert(std::end(bytes), std::cbegin(frame), std::cend(frame));
+	}
+
+	return bytes;
+}
+
+// ~2 seconds of MPEG-1 layer III silence (32kbps, 48kHz, mono)
+Bytes
+createMP3Data()
+{
+	constexpr std::size_t frameSize {96};
+	constexpr std::size_t frameCount {84};
+
+	Bytes bytes;
+	for (std::size_t i {}; i < frameCount; ++i)
+	{
+		bytes.insert(std::end(bytes), {0xFF, 0xFB, 0x14, 0xC0});
+		bytes.insert(std::end(bytes), frameSize - 4, 0);	// empty side info and main data
+	}
+
+	return bytes;
+}
+
+std::string
+generateMBID(std::mt19937_64& rng)
+{
+	static constexpr char hexDigits[] {"0123456789abcdef"};
+	std::uniform_int_distribution<std::size_t> dist {0, 15};
+
+	std::string res;
+	for (std::size_t i {}; i < 36; ++i)
+	{
+		if (i == 8 || i == 13 || i == 18 || i == 23)
+			res += '-';
+		else if (i == 14)
+			res += '4';	// version 4
+		else if (i == 19)
+			res += hexDigits[8 + dist(rng) % 4];	// variant
+		else
+			res += hexDigits[dist(rng)];
+	}
+
+	return res;
+}
+
+struct Entity
+{
+	std::string name;
+	std::string MBID;
+};
+
+void
+addProperty(TagLib::PropertyMap& properties, const std::string& key, const std::string& value)
+{
+	properties.insert(key, TagLib::StringList {TagLib::String {value, TagLib::String::UTF8}});
+}
+
+void
+writeFile(const std::filesystem::path& file, const Bytes& data)
+{
+	std::ofstream ofs {file, std::ios_base::binary};
+	ofs.write(reinterpret_cast<const char*>(data.data()), data.size());
+	if (!ofs)
+		throw std::runtime_error {"Cannot write file '" + file.string() + "'"};
+}
+
+void
+tagFile(const std::filesystem::path& file, Format format, const TagLib::PropertyMap& properties, bool hasCover)
+{
+	const TagLib::ByteVector cover {reinterpret_cast<const char*>(coverData.data()), static_cast<unsigned>(coverData.size())};
+
+	switch (format)
+	{
+		case Format::FLAC:
+		{
+			TagLib::FLAC::File flacFile {file.c_str()};
+			if (!flacFile.isValid())
+				throw std::runtime_error {"Generated file '" + file.string() + "' is not valid"};
+
+			flacFile.setProperties(properties);
+			if (hasCover)
+			{
+				auto picture {std::make_unique<TagLib::FLAC::Picture>()};
+				picture->setType(TagLib::FLAC::Picture::FrontCover);
+				picture->setMimeType("image/png");
+				picture->setWidth(1);
+				picture->setHeight(1);
+				picture->setColorDepth(24);
+				picture->setData(cover);
+				flacFile.addPicture(picture.release());
+			}
+			flacFile.save();
+			break;
+		}
+
+		case Format::MP3:
+		{
+			TagLib::MPEG::File mpegFile {file.c_str()};
+			if (!mpegFile.isValid())
+				throw std::runtime_error {"Generated file '" + file.string() + "' is not valid"};
+
+			mpegFile.ID3v2Tag(true)->setProperties(properties);
+			if (hasCover)
+			{
+				auto frame {std::make_unique<TagLib::ID3v2::AttachedPictureFrame>()};
+				frame->setType(TagLib::ID3v2::AttachedPictureFrame::FrontCover);
+				frame->setMimeType("image/png");
+				frame->setPicture(cover);
+				mpegFile.ID3v2Tag()->addFrame(frame.release());
+			}
+			mpegFile.save(TagLib::MPEG::File::ID3v2);
+			break;
+		}
+	}
+}
+
+} // namespace
+
+std::vector<std::filesystem::path>
+generate(const std::filesystem::path& directory, const Parameters& parameters)
+{
+	if (parameters.tracksPerRelease == 0 || parameters.artistCount == 0 || parameters.genreCount == 0 || parameters.formats.empty())
+		throw std::runtime_error {"Invalid generation parameters"};
+
+	std::mt19937_64 rng {parameters.seed};
+
+	std::vector<Entity> artists;
+	for (std::size_t i {}; i < parameters.artistCount; ++i)
+		artists.push_back(Entity {"Artist " + std::to_string(i), generateMBID(rng)});
+
+	// Zipf distribution: a few artists get most of the releases
+	std::vector<double> artistWeights;
+	for (std::size_t i {}; i < parameters.artistCount; ++i)
+		artistWeights.push_back(1. / std::pow(static_cast<double>(i + 1), parameters.artistSkew));
+	std::discrete_distribution<std::size_t> artistDist {std::cbegin(artistWeights), std::cend(artistWeights)};
+	std::uniform_int_distribution<std::size_t> genreDist {0, parameters.genreCount - 1};
+	std::bernoulli_distribution coverDist {parameters.coverRatio};
+
+	const Bytes flacData {createFLACData()};
+	const Bytes mp3Data {createMP3Data()};
+
+	std::vector<std::filesystem::path> files;
+	files.reserve(parameters.fileCount);
+
+	for (std::size_t releaseIndex {}; files.size() < parameters.fileCount; ++releaseIndex)
+	{
+		const Entity& artist {artists[artistDist(rng)]};
+		const Entity release {"Release " + std::to_string(releaseIndex), generateMBID(rng)};
+		const std::string genre {"Genre " + std::to_string(genreDist(rng))};
+		const Format format {parameters.formats[releaseIndex % parameters.formats.size()]};
+		const bool hasCover {coverDist(rng)};
+
+		const std::filesystem::path releaseDirectory {directory / artist.name / release.name};
+		std::filesystem::create_directories(releaseDirectory);
+
+		for (std::size_t trackIndex {}; trackIndex < parameters.tracksPerRelease && files.size() < parameters.fileCount; ++trackIndex)
+		{
+			std::ostringstream fileName;
+			fileName << std::setw(2) << std::setfill('0') << trackIndex + 1 << " - Track" << (format == Format::FLAC ? ".flac" : ".mp3");
+
+			const std::filesystem::path file {releaseDirectory / fileName.str()};
+			writeFile(file, format == Format::FLAC ? flacData : mp3Data);
+
+			TagLib::PropertyMap properties;
+			addProperty(properties, "TITLE", "Track " + std::to_string(trackIndex + 1));
+			addProperty(properties, "TRACKNUMBER", std::to_string(trackIndex + 1));
+			addProperty(properties, "ARTIST", artist.name);
+			addProperty(properties, "ALBUMARTIST", artist.name);
+			addProperty(properties, "ALBUM", release.name);
+			addProperty(properties, "GENRE", genre);
+			addProperty(properties, "DATE", std::to_string(1970 + releaseIndex % 50));
+			addProperty(properties, "MUSICBRAINZ_ARTISTID", artist.MBID);
+			addProperty(properties, "MUSICBRAINZ_ALBUMARTISTID", artist.MBID);
+			addProperty(properties, "MUSICBRAINZ_ALBUMID", release.MBID);
+			addProperty(properties, "MUSICBRAINZ_TRACKID", generateMBID(rng));
+
+			tagFile(file, format, properties, hasCover);
+
+			files.push_back(file);
+		}
+	}
+
+	return files;
+}
+
+} // namespace LibraryGenerator
@@ -0,0 +1,51 @@
+/*
+ * Copyright (C) 2020 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+// Generates a synthetic library of tiny but valid tagged audio files
+namespace LibraryGenerator
+{
+	enum class Format
+	{
+		FLAC,
+		MP3,
+	};
+
+	struct Parameters
+	{
+		std::size_t		fileCount {1000};
+		std::size_t		tracksPerRelease {10};
+		std::size_t		artistCount {100};
+		double			artistSkew {1.};	// Zipf exponent used to pick release artists, 0 means uniform
+		std::size_t		genreCount {20};
+		double			coverRatio {0.5};	// ratio of releases with embedded covers
+		std::vector<Format>	formats {Format::FLAC, Format::MP3};	// used in turn, per release
+		unsigned		seed {42};
+	};
+
+	// Returns the generated files
+	std::vector<std::filesystem::path> generate(const std::filesystem::path& directory, const Parameters& parameters);
+}
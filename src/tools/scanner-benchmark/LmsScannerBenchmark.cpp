@@ -0,0 +1,241 @@
+/*
+ * Copyright (C) 2020 Emeric Poupon
+ *
+ * This file is part of LMS.
+ *
+ * LMS is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * LMS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with LMS.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <chrono>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+
+#include <boost/program_options.hpp>
+
+#include "database/Db.hpp"
+#include "database/ScanSettings.hpp"
+#include "database/Session.hpp"
+#include "scanner/IMediaScanner.hpp"
+#include "utils/IConfig.hpp"
+#include "utils/Semaphore.hpp"
+#include "utils/Service.hpp"
+#include "utils/StreamLogger.hpp"
+
+#include "LibraryGenerator.hpp"
+
+// Only forwards warnings and errors, the scanner logs each file otherwise
+class QuietLogger final : public Logger
+{
+	public:
+		QuietLogger(std::ostream& os) : _streamLogger {os} {}
+
+		void processLog(const Log& log) override
+		{
+			if (log.getSeverity() <= Severity::WARNING)
+				_streamLogger.processLog(log);
+		}
+
+	private:
+		StreamLogger _streamLogger;
+};
+
+static
+long
+getPeakRSS()
+{
+	struct rusage usage {};
+	getrusage(RUSAGE_SELF, &usage);
+
+	return usage.ru_maxrss; // in kilobytes
+}
+
+static
+std::vector<LibraryGenerator::Format>
+parseFormats(const std::string& str)
+{
+	std::vector<LibraryGenerator::Format> formats;
+
+	std::istringstream iss {str};
+	std::string format;
+	while (std::getline(iss, format, ','))
+	{
+		if (format == "flac")
+			formats.push_back(LibraryGenerator::Format::FLAC);
+		else if (format == "mp3")
+			formats.push_back(LibraryGenerator::Format::MP3);
+		else
+			throw std::runtime_error {"Unhandled format '" + format + "'"};
+	}
+
+	return formats;
+}
+
+// Unchanged directories are skipped by incremental scans: add files rather than modifying them
+static
+void
+addFileCopies(const std::filesystem::path& directory, std::size_t count)
+{
+	std::vector<std::filesystem::path> files;
+	for (const std::filesystem::directory_entry& entry : std::filesystem::recursive_directory_iterator {directory})
+	{
+		if (files.size() == count)
+			break;
+
+		if (entry.is_regular_file())
+			files.push_back(entry.path());
+	}
+
+	for (const std::filesystem::path& file : files)
+	{
+		std::filesystem::path copy {file};
+		copy.replace_filename(file.stem().string() + " (copy)" + file.extension().string());
+
+		std::filesystem::copy_file(file, copy, std::filesystem::copy_options::overwrite_existing);
+	}
+}
+
+static
+void
+runScan(Scanner::IMediaScanner& scanner, Semaphore& scanComplete, const std::string& name, bool force)
+{
+	std::cout << "Running " << name << " scan..." << std::endl;
+
+	const auto start {std::chrono::steady_clock::now()};
+	scanner.requestImmediateScan(force);
+	scanComplete.wait();
+	const auto duration {std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start)};
+
+	const Scanner::IMediaScanner::Status status {scanner.getStatus()};
+	if (!status.lastCompleteScanStats)
+		throw std::runtime_error {"No scan stats available"};
+
+	const Scanner::ScanStats& stats {*status.lastCompleteScanStats};
+	const Scanner::ScanPerfStats& perf {stats.perf};
+
+	std::cout << std::fixed << std::setprecision(1);
+	std::cout << name << ": " << stats.nbFiles() << " files (" << stats.scans << " scanned, " << stats.errors.size() << " errors) in " << duration.count() << " ms"
+		<< ", " << (duration.count() ? stats.nbFiles() * 1000. / duration.count() : 0.) << " files/s"
+		<< ", peak RSS = " << getPeakRSS() / 1024. << " MB" << std::endl;
+
+	for (std::size_t step {}; step < Scanner::ScanProgressStepCount; ++step)
+		std::cout << "\tstep " << step + 1 << ": " << perf.steps[step].duration.count() << " ms, " << perf.steps[step].getFilesPerSecond() << " files/s" << std::endl;
+
+	std::cout << "\tparse latency: p50 = " << perf.parseLatency.getPercentile(50).count() << " us, p99 = " << perf.parseLatency.getPercentile(99).count() << " us" << std::endl;
+	std::cout << "\tdb write latency: avg = " << perf.dbWriteLatency.getAverage().count() << " us, max = " << perf.dbWriteLatency.max.count() << " us" << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+	try
+	{
+		namespace po = boost::program_options;
+
+		Service<Logger> logger {std::make_unique<QuietLogger>(std::cout)};
+
+		po::options_description desc{"Allowed options"};
+		desc.add_options()
+		("help,h", "print usage message")
+		("conf,c", po::value<std::string>()->default_value("/etc/lms.conf"), "LMS config file")
+		("library,l", po::value<std::string>(), "Library directory")
+		("db", po::value<std::string>()->default_value((std::filesystem::temp_directory_path() / "lms-scanner-benchmark.db").string()), "Database file, erased before the benchmark")
+		("generate,g", po::value<std::size_t>(), "Generate a synthetic library of this number of files first (library directory must not exist)")
+		("tracks-per-release", po::value<std::size_t>()->default_value(10), "Generation: tracks per release")
+		("artist-count", po::value<std::size_t>()->default_value(100), "Generation: number of artists")
+		("artist-skew", po::value<double>()->default_value(1.), "Generation: Zipf exponent of the release artist distribution (0 for uniform)")
+		("genre-count", po::value<std::size_t>()->default_value(20), "Generation: number of genres")
+		("cover-ratio", po::value<double>()->default_value(0.5), "Generation: ratio of releases with an embedded cover")
+		("formats", po::value<std::string>()->default_value("flac,mp3"), "Generation: comma separated list of formats (flac, mp3)")
+		("seed", po::value<unsigned>()->default_value(42), "Generation: random seed")
+		("added-count", po::value<std::size_t>()->default_value(0), "Number of files copied before the incremental scan")
+		;
+
+		po::variables_map vm;
+		po::store(po::parse_command_line(argc, argv, desc), vm);
+
+		if (vm.count("help") || !vm.count("library"))
+		{
+			std::cout << desc << std::endl;
+			return vm.count("help") ? EXIT_SUCCESS : EXIT_FAILURE;
+		}
+
+		const std::filesystem::path libraryDirectory {vm["library"].as<std::string>()};
+
+		if (vm.count("generate"))
+		{
+			if (std::filesystem::exists(libraryDirectory))
+				throw std::runtime_error {"Library directory '" + libraryDirectory.string() + "' already exists"};
+
+			LibraryGenerator::Parameters parameters;
+			parameters.fileCount = vm["generate"].as<std::size_t>();
+			parameters.tracksPerRelease = vm["tracks-per-release"].as<std::size_t>();
+			parameters.artistCount = vm["artist-count"].as<std::size_t>();
+			parameters.artistSkew = vm["artist-skew"].as<double>();
+			parameters.genreCount = vm["genre-count"].as<std::size_t>();
+			parameters.coverRatio = vm["cover-ratio"].as<double>();
+			parameters.formats = parseFormats(vm["formats"].as<std::string>());
+			parameters.seed = vm["seed"].as<unsigned>();
+
+			std::cout << "Generating " << parameters.fileCount << " files in '" << libraryDirectory.string() << "'..." << std::endl;
+			const auto files {LibraryGenerator::generate(libraryDirectory, parameters)};
+			std::cout << "Generated " << files.size() << " files" << std::endl;
+		}
+
+		Service<IConfig> config {createConfig(vm["conf"].as<std::string>())};
+
+		const std::filesystem::path dbPath {vm["db"].as<std::string>()};
+		for (const char* suffix : {"", "-wal", "-shm"})
+			std::filesystem::remove(dbPath.string() + suffix);
+
+		Database::Db db {dbPath};
+		{
+			Database::Session session {db};
+			session.prepareTables();
+
+			auto transaction {session.createUniqueTransaction()};
+
+			Database::ScanSettings::pointer scanSettings {Database::ScanSettings::get(session)};
+			scanSettings.modify()->setMediaDirectory(libraryDirectory);
+			scanSettings.modify()->setUpdatePeriod(Database::ScanSettings::UpdatePeriod::Never);
+			scanSettings.modify()->setRecommendationEngineType(Database::ScanSettings::RecommendationEngineType::Clusters);
+		}
+
+		const auto scanner {Scanner::createMediaScanner(db)};
+
+		Semaphore scanComplete;
+		scanner->scanComplete().connect([&] { scanComplete.notify(); });
+
+		runScan(*scanner, scanComplete, "full", false);
+
+		addFileCopies(libraryDirectory, vm["added-count"].as<std::size_t>());
+		runScan(*scanner, scanComplete, "incremental", false);
+
+		runScan(*scanner, scanComplete, "force", true);
+	}
+	catch (std::exception& e)
+	{
+		std::cerr << "Caught exception: " << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}